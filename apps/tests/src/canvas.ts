@@ -23,6 +23,113 @@ test('`CanvasRenderingContext2D#getImageData()`', () => {
 	assert.equal(data.data[3], 255);
 });
 
+test('`CanvasRenderingContext2D#putImageData()` round trips with `getImageData()`', () => {
+	const canvas = new OffscreenCanvas(17, 3);
+	const ctx = canvas.getContext('2d');
+	const input = new ImageData(17, 3);
+	for (let i = 0; i < input.data.length; i += 4) {
+		input.data[i] = i & 0xff;
+		input.data[i + 1] = (i * 3) & 0xff;
+		input.data[i + 2] = (i * 7) & 0xff;
+		// Mix of opaque, transparent and translucent pixels
+		input.data[i + 3] = i % 12 === 0 ? 0 : i % 8 === 0 ? 128 : 255;
+	}
+	ctx.putImageData(input, 0, 0);
+	const output = ctx.getImageData(0, 0, 17, 3);
+	for (let i = 0; i < input.data.length; i += 4) {
+		const a = input.data[i + 3];
+		assert.equal(output.data[i + 3], a);
+		for (let c = 0; c < 3; c++) {
+			const expected = a === 0 ? 0 : input.data[i + c];
+			// Translucent pixels lose precision when premultiplied
+			const tolerance = a === 255 || a === 0 ? 0 : 2;
+			assert.ok(
+				Math.abs(output.data[i + c] - expected) <= tolerance,
+				`pixel ${i / 4} channel ${c}: ${output.data[i + c]} != ${expected}`,
+			);
+		}
+	}
+});
+
+test('`OffscreenCanvas#getPixelView()` aliases the canvas pixels', () => {
+	const canvas = new OffscreenCanvas(4, 2);
+	const ctx = canvas.getContext('2d');
+	ctx.fillStyle = 'red';
+	ctx.fillRect(0, 0, 1, 1);
+
+	const pixels = canvas.getPixelView();
+	assert.equal(pixels.length, 8);
+	assert.equal(pixels[0], 0xffff0000);
+	pixels[1] = 0xff00ff00;
+	canvas.releasePixelView(pixels);
+	assert.equal(pixels.length, 0);
+
+	const data = ctx.getImageData(1, 0, 1, 1);
+	assert.equal(Array.from(data.data), [0, 255, 0, 255]);
+});
+
+test('`OffscreenCanvas#getPixelView()` blocks drawing until released', () => {
+	const canvas = new OffscreenCanvas(4, 2);
+	const ctx = canvas.getContext('2d');
+	const pixels = canvas.getPixelView();
+	assert.throws(() => canvas.getPixelView(), TypeError);
+	assert.throws(() => ctx.fillRect(0, 0, 1, 1), TypeError);
+	canvas.releasePixelView(pixels);
+
+	ctx.fillStyle = 'blue';
+	ctx.fillRect(0, 0, 1, 1);
+	const again = canvas.getPixelView();
+	assert.equal(again[0], 0xff0000ff);
+	canvas.releasePixelView(again);
+});
+
+test('`CanvasRenderingContext2D#measureText()` reuses shaped text', () => {
+	const canvas = new OffscreenCanvas(100, 50);
+	const ctx = canvas.getContext('2d');
+	ctx.font = '20px system-ui';
+	const text = `glyph cache ${Math.random()}`;
+	const before = Switch.performance.glyphCache();
+	const first = ctx.measureText(text).width;
+	ctx.fillText(text, 0, 30);
+	const second = ctx.measureText(text).width;
+	const after = Switch.performance.glyphCache();
+	assert.ok(first > 0);
+	assert.equal(second, first);
+	assert.equal(after.misses - before.misses, 1);
+	assert.equal(after.hits - before.hits, 2);
+
+	// Different font size is shaped separately
+	ctx.font = '40px system-ui';
+	assert.ok(ctx.measureText(text).width > first);
+	assert.equal(Switch.performance.glyphCache().misses - after.misses, 1);
+});
+
+test('`CanvasRenderingContext2D#textRendering` "optimizeSpeed" draws glyphs from the atlas', () => {
+	const canvas = new OffscreenCanvas(200, 50);
+	const ctx = canvas.getContext('2d');
+	assert.equal(ctx.textRendering, 'auto');
+	ctx.textRendering = 'optimizeSpeed';
+	assert.equal(ctx.textRendering, 'optimizeSpeed');
+	ctx.font = '30px system-ui';
+	ctx.fillStyle = 'red';
+
+	const before = Switch.performance.glyphAtlas();
+	ctx.fillText('Atlas', 10, 40);
+	ctx.fillText('Atlas', 10, 40);
+	const after = Switch.performance.glyphAtlas();
+	assert.ok(after.hits - before.hits >= 5);
+
+	let covered = 0;
+	const { data } = ctx.getImageData(0, 0, 200, 50);
+	for (let i = 0; i < data.length; i += 4) {
+		if (data[i + 3] === 0) continue;
+		covered++;
+		assert.equal(data[i + 1], 0);
+		assert.equal(data[i + 2], 0);
+	}
+	assert.ok(covered > 100);
+});
+
 // 2d.state.saverestore.stackdepth
 test('save()/restore() stack depth is not unreasonably limited', () => {
 	var canvas = new OffscreenCanvas(100, 50);
@@ -111,4 +218,294 @@ test('`CanvasRenderingContext2D#isPointInStroke()`', () => {
 	assert.equal(ctx.isPointInStroke(8, 8), false);
 });
 
+test('`Path2D` from SVG path data and `addPath()`', () => {
+	const canvas = new OffscreenCanvas(100, 50);
+	const ctx = canvas.getContext('2d');
+
+	const square = new Path2D('M10 10 h20 v20 h-20 z');
+	assert.equal(ctx.isPointInPath(square, 20, 20), true);
+	assert.equal(ctx.isPointInPath(square, 35, 20), false);
+
+	const path = new Path2D(square);
+	path.addPath(square, { e: 50 });
+	path.moveTo(0, 0);
+	path.lineTo(5, 0);
+	path.lineTo(0, 5);
+	assert.equal(ctx.isPointInPath(path, 20, 20), true);
+	assert.equal(ctx.isPointInPath(path, 70, 20), true);
+	assert.equal(ctx.isPointInPath(path, 45, 20), false);
+	assert.equal(ctx.isPointInPath(path, 1, 1), true);
+
+	// Using a path does not replace the context's current path
+	ctx.rect(0, 40, 10, 10);
+	ctx.fill(path);
+	assert.equal(ctx.isPointInPath(5, 45), true);
+	assert.equal(ctx.isPointInPath(20, 20), false);
+	assert.equal(ctx.getImageData(70, 20, 1, 1).data[3], 255);
+});
+
+test('`Switch.DrawCommandBuffer` executes recorded commands', () => {
+	const sprite = new OffscreenCanvas(2, 2);
+	const spriteCtx = sprite.getContext('2d');
+	spriteCtx.fillStyle = 'blue';
+	spriteCtx.fillRect(0, 0, 2, 2);
+
+	const canvas = new OffscreenCanvas(10, 10);
+	const ctx = canvas.getContext('2d');
+	const commands = new Switch.DrawCommandBuffer(16);
+	commands.setFillStyle('red');
+	commands.fillRect(0, 0, 10, 10);
+	commands.save();
+	commands.translate(4, 4);
+	commands.drawImage(sprite, 0, 0);
+	commands.restore();
+	commands.clearRect(9, 9, 1, 1);
+	for (let i = 0; i < 100; i++) {
+		commands.drawImage(sprite, 0, 8);
+	}
+	assert.ok(commands.length > 16);
+	commands.flush(ctx);
+	assert.equal(commands.length, 0);
+
+	const pixel = (x: number, y: number) =>
+		Array.from(ctx.getImageData(x, y, 1, 1).data);
+	assert.equal(pixel(0, 0), [255, 0, 0, 255]);
+	assert.equal(pixel(5, 5), [0, 0, 255, 255]);
+	assert.equal(pixel(1, 9), [0, 0, 255, 255]);
+	assert.equal(pixel(9, 9), [0, 0, 0, 0]);
+	assert.equal(ctx.getTransform().e, 0);
+	assert.equal(ctx.fillStyle, '#ff0000');
+
+	commands.arc(0, 0, -1, 0, 1);
+	assert.throws(() => commands.flush(ctx), RangeError);
+	assert.equal(commands.length, 0);
+});
+
+test('`Switch.DrawCommandBuffer` tiled flush matches untiled flush', () => {
+	// Has no pixels yet, so drawing it is skipped
+	const unloaded = new Image();
+	const record = (commands: Switch.DrawCommandBuffer) => {
+		commands.setFillStyle('white');
+		commands.fillRect(0, 0, 300, 300);
+		commands.drawImage(unloaded, 10, 10);
+		commands.drawImage(unloaded, 0, 0, 8, 8, 20, 20, 8, 8);
+		commands.save();
+		commands.translate(150, 150);
+		commands.rotate(0.3);
+		commands.setFillStyle('rgba(0, 128, 255, 0.5)');
+		commands.beginPath();
+		commands.arc(0, 0, 120, 0, Math.PI * 2);
+		commands.fill();
+		commands.setStrokeStyle('red');
+		commands.setLineWidth(7);
+		commands.strokeRect(-100, -100, 200, 200);
+		commands.restore();
+		commands.translate(10, 0);
+	};
+	const render = (tiled: boolean) => {
+		const canvas = new OffscreenCanvas(300, 300);
+		const ctx = canvas.getContext('2d');
+		const commands = new Switch.DrawCommandBuffer();
+		record(commands);
+		commands.flush(ctx, { tiled });
+		assert.equal(ctx.getTransform().e, 10);
+		assert.equal(ctx.fillStyle, '#ffffff');
+		return ctx.getImageData(0, 0, 300, 300).data;
+	};
+	const expected = render(false);
+	const actual = render(true);
+	let mismatches = 0;
+	for (let i = 0; i < expected.length; i++) {
+		if (Math.abs(expected[i] - actual[i]) > 1) mismatches++;
+	}
+	assert.equal(mismatches, 0);
+});
+
+test('`CanvasRenderingContext2D#drawImages()` blits sprite sheet regions', () => {
+	// 2x1 sprite sheet: opaque red, then half transparent blue
+	const sheet = new OffscreenCanvas(2, 1);
+	const sheetCtx = sheet.getContext('2d');
+	sheetCtx.fillStyle = 'red';
+	sheetCtx.fillRect(0, 0, 1, 1);
+	sheetCtx.fillStyle = 'rgba(0, 0, 255, 0.5)';
+	sheetCtx.fillRect(1, 0, 1, 1);
+
+	const canvas = new OffscreenCanvas(8, 8);
+	const ctx = canvas.getContext('2d');
+	ctx.fillStyle = 'white';
+	ctx.fillRect(0, 0, 8, 8);
+	ctx.translate(2, 2);
+	ctx.drawImages(sheet, [0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1]);
+	ctx.drawImages(sheet, new Float64Array([0, 0, 1, 1, 4, 4, 2, 2]));
+	ctx.resetTransform();
+
+	const pixel = (x: number, y: number) =>
+		Array.from(ctx.getImageData(x, y, 1, 1).data);
+	assert.equal(pixel(2, 2), [255, 0, 0, 255]);
+	const blended = pixel(3, 2);
+	assert.ok(Math.abs(blended[0] - 127) <= 1);
+	assert.ok(Math.abs(blended[2] - 255) <= 1);
+	assert.equal(blended[3], 255);
+	assert.equal(pixel(7, 7), [255, 0, 0, 255]);
+	assert.equal(pixel(0, 0), [255, 255, 255, 255]);
+
+	assert.throws(() => ctx.drawImages(sheet, [0, 0, 1]), RangeError);
+});
+
+test('`CanvasRenderingContext2D` skips drawing an `Image` that has not loaded', () => {
+	const img = new Image();
+	const canvas = new OffscreenCanvas(4, 4);
+	const ctx = canvas.getContext('2d');
+	ctx.fillStyle = 'white';
+	ctx.fillRect(0, 0, 4, 4);
+	ctx.drawImage(img, 0, 0, 2, 2, 0, 0, 2, 2);
+	ctx.drawImages(img, [0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 1, 1, 3, 3]);
+	assert.equal(Array.from(ctx.getImageData(0, 0, 1, 1).data), [
+		255, 255, 255, 255,
+	]);
+});
+
+// 16x8 PNG, left half red and right half blue
+const png = new Uint8Array([
+	137, 80, 78, 71, 13, 10, 26, 10, 0, 0, 0, 13, 73, 72, 68, 82, 0, 0, 0, 16, 0,
+	0, 0, 8, 8, 6, 0, 0, 0, 240, 118, 127, 151, 0, 0, 0, 24, 73, 68, 65, 84, 120,
+	218, 99, 248, 207, 192, 240, 31, 31, 38, 32, 253, 159, 97, 212, 128, 225, 96,
+	0, 0, 141, 166, 255, 1, 134, 17, 68, 195, 0, 0, 0, 0, 73, 69, 78, 68, 174,
+	66, 96, 130,
+]);
+
+test('`createImageBitmap()` decodes to `resizeWidth`', async () => {
+	const full = await createImageBitmap(new Blob([png]));
+	assert.equal(full.width, 16);
+	assert.equal(full.height, 8);
+
+	const bitmap = await createImageBitmap(new Blob([png]), { resizeWidth: 4 });
+	assert.equal(bitmap.width, 4);
+	assert.equal(bitmap.height, 2);
+
+	const canvas = new OffscreenCanvas(4, 2);
+	const ctx = canvas.getContext('2d');
+	ctx.drawImage(bitmap, 0, 0);
+	const pixel = (x: number, y: number) =>
+		Array.from(ctx.getImageData(x, y, 1, 1).data);
+	assert.equal(pixel(0, 0), [255, 0, 0, 255]);
+	assert.equal(pixel(3, 1), [0, 0, 255, 255]);
+});
+
+test('`Switch.decodeImages()` decodes a batch of images', async () => {
+	const bitmaps = await Switch.decodeImages([new Blob([png]), png.buffer], {
+		resizeWidth: 8,
+	});
+	assert.equal(bitmaps.length, 2);
+	for (const bitmap of bitmaps) {
+		assert.equal(bitmap.width, 8);
+		assert.equal(bitmap.height, 4);
+	}
+	assert.equal(await Switch.decodeImages([]), []);
+
+	let err: Error | undefined;
+	try {
+		await Switch.decodeImages([png.buffer, new ArrayBuffer(16)]);
+	} catch (e) {
+		err = e as Error;
+	}
+	assert.ok(err);
+	assert.ok(err.message.startsWith('Failed to decode image 1:'));
+});
+
+test('`Image` decodes streamed image data', async () => {
+	const url = URL.createObjectURL(new Blob([png]));
+	const img = new Image();
+	await new Promise((resolve, reject) => {
+		img.onload = resolve;
+		img.onerror = reject;
+		img.src = url;
+	});
+	URL.revokeObjectURL(url);
+	assert.equal(img.complete, true);
+	assert.equal(img.width, 16);
+	assert.equal(img.height, 8);
+
+	const canvas = new OffscreenCanvas(16, 8);
+	const ctx = canvas.getContext('2d');
+	ctx.drawImage(img, 0, 0);
+	const pixel = (x: number, y: number) =>
+		Array.from(ctx.getImageData(x, y, 1, 1).data);
+	assert.equal(pixel(0, 0), [255, 0, 0, 255]);
+	assert.equal(pixel(15, 7), [0, 0, 255, 255]);
+});
+
+test('`Image` shares decoded pixels through the image cache', async () => {
+	const url = URL.createObjectURL(new Blob([png]));
+	const load = (img: Image) =>
+		new Promise((resolve, reject) => {
+			img.onload = resolve;
+			img.onerror = reject;
+			img.src = url;
+		});
+	const first = new Image();
+	await load(first);
+	const before = Switch.performance.imageCache();
+
+	// Loaded from the cache, so the size is known right away
+	const second = new Image();
+	const loaded = load(second);
+	assert.equal(second.complete, true);
+	assert.equal(second.width, 16);
+	await loaded;
+	URL.revokeObjectURL(url);
+
+	const after = Switch.performance.imageCache();
+	assert.equal(after.hits - before.hits, 1);
+	assert.equal(after.misses, before.misses);
+	assert.ok(after.bytes >= 16 * 8 * 4);
+
+	Switch.performance.clearImageCache();
+	assert.equal(Switch.performance.imageCache().entries, 0);
+	// The pixels of the images outlive the cache entry
+	const canvas = new OffscreenCanvas(16, 8);
+	const ctx = canvas.getContext('2d');
+	ctx.drawImage(second, 0, 0);
+	assert.equal(Array.from(ctx.getImageData(15, 0, 1, 1).data), [0, 0, 255, 255]);
+});
+
+test('`Image` does not share stale pixels of a rewritten file', async () => {
+	const path = 'sdmc:/__nxjs-test-image.png';
+	const load = () =>
+		new Promise<Image>((resolve, reject) => {
+			const img = new Image();
+			img.onload = () => resolve(img);
+			img.onerror = reject;
+			img.src = path;
+		});
+	Switch.writeFileSync(path, png);
+	assert.equal((await load()).width, 16);
+
+	// 4x2 PNG, opaque green
+	const green = new Uint8Array([
+		137, 80, 78, 71, 13, 10, 26, 10, 0, 0, 0, 13, 73, 72, 68, 82, 0, 0, 0, 4, 0,
+		0, 0, 2, 8, 6, 0, 0, 0, 127, 168, 125, 99, 0, 0, 0, 14, 73, 68, 65, 84, 120,
+		218, 99, 96, 248, 143, 6, 209, 5, 0, 7, 41, 15, 241, 12, 177, 250, 151, 0, 0,
+		0, 0, 73, 69, 78, 68, 174, 66, 96, 130,
+	]);
+	Switch.writeFileSync(path, green);
+	const img = await load();
+	Switch.removeSync(path);
+	assert.equal(img.width, 4);
+	assert.equal(img.height, 2);
+});
+
+test('`Image` fires "error" for truncated image data', async () => {
+	const url = URL.createObjectURL(new Blob([png.subarray(0, 60)]));
+	const img = new Image();
+	const event = await new Promise<ErrorEvent>((resolve, reject) => {
+		img.onload = () => reject(new Error('Expected "error" event'));
+		img.onerror = resolve;
+		img.src = url;
+	});
+	URL.revokeObjectURL(url);
+	assert.equal(img.complete, false);
+	assert.ok(event.error instanceof Error);
+});
+
 test.run();
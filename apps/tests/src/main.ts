@@ -10,6 +10,7 @@ import './navigator';
 import './storage';
 import './switch';
 import './text-encoder';
+import './timers';
 import './wasm';
 import './window';
 import './url';
@@ -91,6 +91,50 @@ test('`Switch.readFile()` returns null when attempting to read a directory', asy
 	assert.equal(data, null);
 });
 
+test('`Switch.readFile()` rejects when signal is already aborted', async () => {
+	const controller = new AbortController();
+	controller.abort();
+	let err: Error | undefined;
+	try {
+		await Switch.readFile('romfs:/runtime.js', { signal: controller.signal });
+	} catch (_err) {
+		err = _err as Error;
+	}
+	assert.ok(err);
+	assert.equal(err.name, 'AbortError');
+});
+
+test('`Switch.readFile()` rejects when signal is aborted after queueing', async () => {
+	const controller = new AbortController();
+	const promise = Switch.readFile('romfs:/runtime.js', {
+		signal: controller.signal,
+	});
+	controller.abort();
+	let err: Error | undefined;
+	try {
+		await promise;
+	} catch (_err) {
+		err = _err as Error;
+	}
+	assert.ok(err);
+	assert.equal(err, controller.signal.reason);
+});
+
+test('`Switch.readFile()` rejects as soon as signal is aborted', async () => {
+	const controller = new AbortController();
+	let rejected = false;
+	Switch.readFile('romfs:/runtime.js', { signal: controller.signal }).catch(
+		() => {
+			rejected = true;
+		},
+	);
+	controller.abort();
+	// Native work only completes on a later iteration of the event loop
+	await Promise.resolve();
+	await Promise.resolve();
+	assert.ok(rejected);
+});
+
 test('`Switch.stat()` returns file information', async () => {
 	const stat = await Switch.stat(Switch.entrypoint);
 	assert.ok(stat);
@@ -141,4 +185,50 @@ test('`Switch.removeSync()` removes nested directory', async () => {
 	assert.equal(Switch.statSync(path), null);
 });
 
+test('`Switch.performance.timings()` returns frame statistics', async () => {
+	// Wait for a few frames to be measured
+	for (let i = 0; i < 3; i++) {
+		await new Promise((r) => requestAnimationFrame(r));
+	}
+	const timings = Switch.performance.timings();
+	assert.ok(timings.frames > 0);
+	for (const name of ['interval', 'busy', 'poll', 'handler'] as const) {
+		const stats = timings[name];
+		assert.ok(stats.p50 >= 0);
+		assert.ok(stats.p50 <= stats.p95);
+		assert.ok(stats.p95 <= stats.p99);
+		assert.ok(stats.p99 <= stats.max);
+	}
+});
+
+test('`Switch.performance.frameRateCap` rejects invalid values', () => {
+	assert.equal(Switch.performance.frameRateCap, 60);
+	assert.throws(() => {
+		Switch.performance.frameRateCap = -1;
+	});
+	assert.equal(Switch.performance.frameRateCap, 60);
+});
+
+test('`Switch.performance.drainBudget` resolves all Promises across iterations', async () => {
+	const previous = Switch.performance.drainBudget;
+	assert.equal(previous, 8);
+	assert.throws(() => {
+		Switch.performance.drainBudget = 0;
+	});
+	Switch.performance.drainBudget = 1;
+	try {
+		let count = 0;
+		let p = Promise.resolve();
+		for (let i = 0; i < 100000; i++) {
+			p = p.then(() => {
+				count++;
+			});
+		}
+		await p;
+		assert.equal(count, 100000);
+	} finally {
+		Switch.performance.drainBudget = previous;
+	}
+});
+
 test.run();
@@ -0,0 +1,48 @@
+import { suite } from 'uvu';
+import * as assert from 'uvu/assert';
+
+const test = suite('timers');
+
+test('`setTimeout()` invokes callbacks in deadline order', async () => {
+	const order: number[] = [];
+	await new Promise<void>((resolve) => {
+		setTimeout(() => order.push(3), 30);
+		setTimeout(() => order.push(1), 10);
+		setTimeout(() => order.push(2), 10);
+		setTimeout(resolve, 50);
+	});
+	assert.equal(order, [1, 2, 3]);
+});
+
+test('`setTimeout()` passes additional arguments', async () => {
+	const args = await new Promise<any[]>((resolve) => {
+		setTimeout((...args: any[]) => resolve(args), 0, 'a', 1);
+	});
+	assert.equal(args, ['a', 1]);
+});
+
+test('`clearTimeout()` cancels a pending timer', async () => {
+	let called = false;
+	const id = setTimeout(() => {
+		called = true;
+	}, 10);
+	clearTimeout(id);
+	await new Promise((resolve) => setTimeout(resolve, 30));
+	assert.equal(called, false);
+});
+
+test('`setInterval()` repeats until cleared', async () => {
+	let count = 0;
+	await new Promise<void>((resolve) => {
+		const id = setInterval(() => {
+			if (++count === 3) {
+				clearInterval(id);
+				resolve();
+			}
+		}, 5);
+	});
+	await new Promise((resolve) => setTimeout(resolve, 20));
+	assert.equal(count, 3);
+});
+
+test.run();
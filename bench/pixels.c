@@ -0,0 +1,636 @@
+/**
+ * Host-side correctness test and micro-benchmark for the
+ * `putImageData()` / `getImageData()` pixel conversions.
+ *
+ * Verifies that the SIMD implementations in source/pixels.c produce
+ * exactly the same output as the scalar reference implementations (for
+ * every color/alpha combination, and for random buffers of every length
+ * so that the scalar tail handling is exercised), checks the accuracy of
+ * the un-premultiply lookup table, and then measures the throughput of
+ * a full 1280x720 frame for the previous per-byte implementations, the
+ * scalar reference and the SIMD implementations.
+ *
+ * Also verifies the copy into the block linear layout of the display
+ * framebuffers against a per-byte reference, and measures the cost of
+ * presenting a full frame and a small damaged region.
+ *
+ * Also verifies the in-place premultiply used by the PNG decoder against
+ * `(c * a + 127) / 255`, and measures it against the previous division loop.
+ *
+ * Also verifies the masked blend used to draw glyphs from the glyph atlas
+ * against blending a premultiplied source pixel with `nx_blend_over()`,
+ * and the SIMD source-over blend used by the `drawImage()` fast path
+ * against its scalar reference, and the area averaging downscaler used to
+ * decode images to a smaller size against a per-pixel reference.
+ *
+ * Build and run on Linux (x86_64 uses the SSE2 implementation):
+ *
+ *    cc -O2 -o bench-pixels bench/pixels.c source/pixels.c -lm && ./bench-pixels
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../source/pixels.h"
+
+#define WIDTH 1280
+#define HEIGHT 720
+#define ITERATIONS 100
+
+static double now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The premultiply pass that was previously run after decoding PNG images in source/image.c
+static void premultiply_alpha_previous(uint8_t *image_data, int width, int height)
+{
+	for (int i = 0; i < width * height; ++i)
+	{
+		uint8_t *pixel = &image_data[i * 4];
+		uint8_t alpha = pixel[3];
+		pixel[0] = (pixel[0] * alpha) / 255;
+		pixel[1] = (pixel[1] * alpha) / 255;
+		pixel[2] = (pixel[2] * alpha) / 255;
+	}
+}
+
+// The conversion loops that were previously in source/canvas.c
+static void put_image_data_previous(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	for (size_t x = 0; x < count; ++x)
+	{
+		uint8_t r = *src++;
+		uint8_t g = *src++;
+		uint8_t b = *src++;
+		uint8_t a = *src++;
+		if (a == 0)
+		{
+			*dst++ = 0;
+			*dst++ = 0;
+			*dst++ = 0;
+			*dst++ = 0;
+		}
+		else if (a == 255)
+		{
+			*dst++ = b;
+			*dst++ = g;
+			*dst++ = r;
+			*dst++ = a;
+		}
+		else
+		{
+			float alpha = (float)a / 255;
+			*dst++ = b * alpha;
+			*dst++ = g * alpha;
+			*dst++ = r * alpha;
+			*dst++ = a;
+		}
+	}
+}
+
+static void get_image_data_previous(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	const uint32_t *row = (const uint32_t *)src;
+	for (size_t x = 0; x < count; ++x)
+	{
+		int bx = x * 4;
+		uint32_t pixel = row[x];
+		uint8_t a = pixel >> 24;
+		uint8_t r = pixel >> 16;
+		uint8_t g = pixel >> 8;
+		uint8_t b = pixel;
+		dst[bx + 3] = a;
+		if (a == 0 || a == 255)
+		{
+			dst[bx + 0] = r;
+			dst[bx + 1] = g;
+			dst[bx + 2] = b;
+		}
+		else
+		{
+			float alphaR = (float)255 / a;
+			dst[bx + 0] = (int)((float)r * alphaR);
+			dst[bx + 1] = (int)((float)g * alphaR);
+			dst[bx + 2] = (int)((float)b * alphaR);
+		}
+	}
+}
+
+static int failures = 0;
+
+static void check(int ok, const char *msg)
+{
+	if (!ok)
+	{
+		printf("FAIL: %s\n", msg);
+		failures++;
+	}
+}
+
+static void fill_random(uint8_t *buf, size_t count, int premultiplied)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint8_t *p = buf + i * 4;
+		// Bias towards fully opaque and fully transparent pixels,
+		// since those take the fast paths
+		int k = rand() % 4;
+		uint8_t a = k == 0 ? 255 : k == 1 ? 0 : rand() % 256;
+		p[3] = a;
+		for (int c = 0; c < 3; c++)
+			p[c] = premultiplied ? (a ? rand() % (a + 1) : 0) : rand() % 256;
+	}
+}
+
+static void test_exhaustive()
+{
+	// Every (color, alpha) combination, in every channel position
+	size_t count = 256 * 256;
+	uint8_t *src = malloc(count * 4);
+	uint8_t *expected = malloc(count * 4);
+	uint8_t *actual = malloc(count * 4);
+	for (int a = 0; a < 256; a++)
+	{
+		for (int c = 0; c < 256; c++)
+		{
+			uint8_t *p = src + (a * 256 + c) * 4;
+			p[0] = c;
+			p[1] = 255 - c;
+			p[2] = c ^ 0x55;
+			p[3] = a;
+		}
+	}
+	nx_rgba_to_bgra_premultiplied_scalar(expected, src, count);
+	nx_rgba_to_bgra_premultiplied(actual, src, count);
+	check(memcmp(expected, actual, count * 4) == 0, "premultiply: SIMD != scalar (exhaustive)");
+
+	// Premultiplying must be the correctly rounded value
+	int max_err = 0;
+	for (int a = 0; a < 256; a++)
+	{
+		for (int c = 0; c < 256; c++)
+		{
+			int ideal = (int)lround(c * a / 255.0);
+			int err = abs(expected[(a * 256 + c) * 4 + 2] - ideal);
+			if (err > max_err)
+				max_err = err;
+		}
+	}
+	printf("premultiply:   max error vs. c * a / 255 = %d\n", max_err);
+	check(max_err == 0, "premultiply: not correctly rounded");
+
+	// Only valid premultiplied input (color <= alpha) is checked for accuracy,
+	// but the SIMD and scalar outputs must match for every input
+	nx_bgra_premultiplied_to_rgba_scalar(expected, src, count);
+	nx_bgra_premultiplied_to_rgba(actual, src, count);
+	check(memcmp(expected, actual, count * 4) == 0, "unpremultiply: SIMD != scalar (exhaustive)");
+
+	max_err = 0;
+	for (int a = 1; a < 256; a++)
+	{
+		for (int c = 0; c <= a; c++)
+		{
+			double ideal = c * 255.0 / a;
+			double err = fabs(expected[(a * 256 + c) * 4 + 2] - ideal);
+			if (err > max_err)
+				max_err = (int)ceil(err - 1e-9);
+		}
+		check(expected[(a * 256 + a) * 4 + 2] <= 255, "unpremultiply: overflow");
+	}
+	printf("unpremultiply: max error vs. c * 255 / a = %d\n", max_err);
+	check(max_err <= 1, "unpremultiply: error greater than 1");
+
+	free(src);
+	free(expected);
+	free(actual);
+}
+
+static void test_random_lengths()
+{
+	uint8_t src[4 * 67], expected[4 * 67 + 4], actual[4 * 67 + 4];
+	for (int iter = 0; iter < 1000; iter++)
+	{
+		size_t count = iter % 67;
+		fill_random(src, count, iter & 1);
+
+		// Also check that nothing is written past the end
+		memset(expected, 0xAA, sizeof(expected));
+		memset(actual, 0xAA, sizeof(actual));
+		if (iter & 1)
+		{
+			nx_bgra_premultiplied_to_rgba_scalar(expected, src, count);
+			nx_bgra_premultiplied_to_rgba(actual, src, count);
+		}
+		else
+		{
+			nx_rgba_to_bgra_premultiplied_scalar(expected, src, count);
+			nx_rgba_to_bgra_premultiplied(actual, src, count);
+		}
+		if (memcmp(expected, actual, sizeof(expected)) != 0)
+		{
+			check(0, iter & 1 ? "unpremultiply: SIMD != scalar (random)" : "premultiply: SIMD != scalar (random)");
+			break;
+		}
+	}
+}
+
+static void test_premultiply_in_place()
+{
+	// Every (color, alpha) combination, in every channel position
+	size_t count = 256 * 256;
+	uint8_t *pixels = malloc(count * 4);
+	uint8_t *expected = malloc(count * 4);
+	for (int a = 0; a < 256; a++)
+	{
+		for (int c = 0; c < 256; c++)
+		{
+			uint8_t *p = pixels + (a * 256 + c) * 4;
+			p[0] = c;
+			p[1] = 255 - c;
+			p[2] = c ^ 0x55;
+			p[3] = a;
+			uint8_t *e = expected + (a * 256 + c) * 4;
+			for (int k = 0; k < 3; k++)
+				e[k] = (p[k] * a + 127) / 255;
+			e[3] = a;
+		}
+	}
+	uint8_t *scalar = malloc(count * 4);
+	memcpy(scalar, pixels, count * 4);
+	nx_premultiply_scalar(scalar, count);
+	check(memcmp(expected, scalar, count * 4) == 0, "premultiply in place: scalar != (c * a + 127) / 255");
+	nx_premultiply(pixels, count);
+	check(memcmp(expected, pixels, count * 4) == 0, "premultiply in place: SIMD != (c * a + 127) / 255");
+
+	// Random lengths, so that the scalar tail is exercised, and nothing is written past the end
+	uint8_t src[4 * 67], a[4 * 67 + 4], b[4 * 67 + 4];
+	for (int iter = 0; iter < 1000; iter++)
+	{
+		size_t n = iter % 67;
+		fill_random(src, n, 0);
+		memset(a, 0xAA, sizeof(a));
+		memcpy(a, src, n * 4);
+		memcpy(b, a, sizeof(b));
+		nx_premultiply_scalar(a, n);
+		nx_premultiply(b, n);
+		if (memcmp(a, b, sizeof(a)) != 0)
+		{
+			check(0, "premultiply in place: SIMD != scalar (random)");
+			break;
+		}
+	}
+
+	free(pixels);
+	free(expected);
+	free(scalar);
+}
+
+static void test_round_trip()
+{
+	// Opaque pixels must survive `putImageData()` + `getImageData()` unchanged
+	size_t count = 1000;
+	uint8_t *src = malloc(count * 4), *surface = malloc(count * 4), *out = malloc(count * 4);
+	for (size_t i = 0; i < count * 4; i++)
+		src[i] = (i % 4 == 3) ? 255 : rand() % 256;
+	nx_rgba_to_bgra_premultiplied(surface, src, count);
+	nx_bgra_premultiplied_to_rgba(out, surface, count);
+	check(memcmp(src, out, count * 4) == 0, "opaque round trip is not lossless");
+	free(src);
+	free(surface);
+	free(out);
+}
+
+// Byte offset of (bx, y) in a block linear buffer, one term per GOB/block coordinate
+static uint32_t block_linear_offset(uint32_t bx, uint32_t y, uint32_t stride, uint32_t block_height_log2)
+{
+	uint32_t block_height = 8 << block_height_log2;
+	uint32_t block_size = 512 << block_height_log2;
+	return (y / block_height) * (stride / 64) * block_size +
+		   (bx / 64) * block_size +
+		   ((y % block_height) / 8) * 512 +
+		   ((bx % 64) / 32) * 256 +
+		   ((y % 8) / 2) * 64 +
+		   ((bx % 32) / 16) * 32 +
+		   (y % 2) * 16 +
+		   (bx % 16);
+}
+
+static void test_block_linear()
+{
+	// 1280x720 rounded up to whole blocks, like libnx allocates
+	uint32_t stride = WIDTH * 4, height = 768;
+	size_t size = stride * height;
+	uint8_t *src = malloc(WIDTH * HEIGHT * 4);
+	uint8_t *expected = malloc(size);
+	uint8_t *actual = malloc(size);
+	for (size_t i = 0; i < WIDTH * HEIGHT * 4; i++)
+		src[i] = rand();
+	for (int iter = 0; iter < 200; iter++)
+	{
+		uint32_t x1 = iter ? rand() % WIDTH : 0, y1 = iter ? rand() % HEIGHT : 0;
+		uint32_t x2 = iter ? x1 + 1 + rand() % (WIDTH - x1) : WIDTH;
+		uint32_t y2 = iter ? y1 + 1 + rand() % (HEIGHT - y1) : HEIGHT;
+		memset(expected, 0xAA, size);
+		memset(actual, 0xAA, size);
+		for (uint32_t y = y1; y < y2; y++)
+			for (uint32_t bx = x1 * 4; bx < x2 * 4; bx++)
+				expected[block_linear_offset(bx, y, stride, NX_BLOCK_HEIGHT_LOG2)] = src[y * WIDTH * 4 + bx];
+		nx_copy_to_block_linear(actual, stride, NX_BLOCK_HEIGHT_LOG2, src + (y1 * WIDTH + x1) * 4, WIDTH * 4, x1, y1, x2, y2);
+		if (memcmp(expected, actual, size) != 0)
+		{
+			check(0, "block linear: copy != reference");
+			break;
+		}
+	}
+	free(src);
+	free(expected);
+	free(actual);
+}
+
+static void test_blend_mask_solid()
+{
+	uint8_t dst[67 * 4], expected[67 * 4], mask[67];
+	for (int iter = 0; iter < 2000; iter++)
+	{
+		size_t count = rand() % 68;
+		uint8_t color[4];
+		color[3] = iter % 3 == 0 ? 255 : rand();
+		for (int c = 0; c < 3; c++)
+			color[c] = color[3] ? rand() % (color[3] + 1) : 0;
+		fill_random(dst, count, 1);
+		memcpy(expected, dst, count * 4);
+		for (size_t i = 0; i < count; i++)
+		{
+			// Mostly empty or fully covered, like the coverage of glyphs
+			int r = rand() % 4;
+			mask[i] = r == 0 ? 0 : r == 1 ? 255 : rand();
+
+			uint8_t src[4];
+			for (int c = 0; c < 4; c++)
+			{
+				uint32_t t = color[c] * mask[i] + 128;
+				src[c] = (t + (t >> 8)) >> 8;
+			}
+			nx_blend_over(expected + i * 4, src, 1);
+		}
+		nx_blend_mask_solid(dst, mask, count, color);
+		if (memcmp(expected, dst, count * 4) != 0)
+		{
+			check(0, "blend mask: output != reference");
+			break;
+		}
+	}
+}
+
+static void test_blend_over()
+{
+	// Every combination of source alpha / channel and destination channel
+	uint8_t src[256 * 4], dst[256 * 4], expected[256 * 4];
+	for (int a = 0; a < 256; a++)
+	{
+		for (int c = 0; c <= a; c++)
+		{
+			for (int d = 0; d < 256; d++)
+			{
+				uint8_t px[4] = {c, c, c, a};
+				memcpy(src + d * 4, px, 4);
+				uint8_t dp[4] = {d, 255 - d, d / 2, d};
+				memcpy(dst + d * 4, dp, 4);
+			}
+			memcpy(expected, dst, sizeof(dst));
+			nx_blend_over_scalar(expected, src, 256);
+			nx_blend_over(dst, src, 256);
+			if (memcmp(expected, dst, sizeof(dst)) != 0)
+			{
+				check(0, "blend over: exhaustive output != scalar");
+				return;
+			}
+		}
+	}
+
+	// Random buffers of every length, including non-premultiplied
+	// source pixels which must also match the scalar reference
+	uint8_t rsrc[67 * 4], rdst[67 * 4], rexpected[67 * 4];
+	for (int iter = 0; iter < 2000; iter++)
+	{
+		size_t count = rand() % 68;
+		fill_random(rsrc, count, iter % 4 != 0);
+		fill_random(rdst, count, 1);
+		memcpy(rexpected, rdst, count * 4);
+		nx_blend_over_scalar(rexpected, rsrc, count);
+		nx_blend_over(rdst, rsrc, count);
+		if (memcmp(rexpected, rdst, count * 4) != 0)
+		{
+			check(0, "blend over: random output != scalar");
+			break;
+		}
+	}
+}
+
+static void test_downscale()
+{
+	for (int iter = 0; iter < 300; iter++)
+	{
+		uint32_t sw = 1 + rand() % 97, sh = 1 + rand() % 61;
+		uint32_t dw = 1 + rand() % sw, dh = 1 + rand() % sh;
+		if (iter % 10 == 0)
+			dw = sw, dh = sh;
+		uint8_t *src = malloc(sw * sh * 4);
+		uint8_t *expected = malloc(dw * dh * 4);
+		uint8_t *actual = malloc(dw * dh * 4);
+		fill_random(src, sw * sh, 1);
+
+		// Average of the source pixels which map onto each destination pixel
+		for (uint32_t dy = 0; dy < dh; dy++)
+		{
+			for (uint32_t dx = 0; dx < dw; dx++)
+			{
+				uint64_t sum[4] = {0}, count = 0;
+				for (uint32_t y = 0; y < sh; y++)
+				{
+					for (uint32_t x = 0; x < sw; x++)
+					{
+						if ((uint64_t)x * dw / sw != dx || (uint64_t)y * dh / sh != dy)
+							continue;
+						for (int c = 0; c < 4; c++)
+							sum[c] += src[(y * sw + x) * 4 + c];
+						count++;
+					}
+				}
+				for (int c = 0; c < 4; c++)
+					expected[(dy * dw + dx) * 4 + c] = (sum[c] + count / 2) / count;
+			}
+		}
+
+		int err = nx_downscale(actual, dw, dh, src, sw, sh, sw * 4);
+		int ok = !err && memcmp(expected, actual, dw * dh * 4) == 0;
+		free(src);
+		free(expected);
+		free(actual);
+		if (!ok)
+		{
+			check(0, "downscale: output != reference");
+			return;
+		}
+	}
+	check(nx_downscale(NULL, 2, 1, NULL, 1, 1, 4) == -1, "downscale: upscaling is rejected");
+}
+
+static void bench_block_linear()
+{
+	uint32_t stride = WIDTH * 4;
+	uint8_t *src = calloc(WIDTH * HEIGHT, 4);
+	uint8_t *linear = calloc(WIDTH * 768, 4);
+	uint8_t *dst = calloc(WIDTH * 768, 4);
+	double start, ms;
+
+	printf("present %dx%d:\n", WIDTH, HEIGHT);
+
+	// What libnx's linear mode does: copy into its linear buffer, then
+	// swizzle the entire linear buffer into the display buffer
+	start = now_ns();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		memcpy(linear, src, WIDTH * HEIGHT * 4);
+		nx_copy_to_block_linear(dst, stride, NX_BLOCK_HEIGHT_LOG2, linear, stride, 0, 0, WIDTH, 768);
+	}
+	ms = (now_ns() - start) / ITERATIONS / 1e6;
+	printf("  %-22s %7.3f ms/frame\n", "copy + full swizzle", ms);
+
+	start = now_ns();
+	for (int i = 0; i < ITERATIONS; i++)
+		nx_copy_to_block_linear(dst, stride, NX_BLOCK_HEIGHT_LOG2, src, stride, 0, 0, WIDTH, HEIGHT);
+	ms = (now_ns() - start) / ITERATIONS / 1e6;
+	printf("  %-22s %7.3f ms/frame\n", "direct full frame", ms);
+
+	start = now_ns();
+	for (int i = 0; i < ITERATIONS; i++)
+		nx_copy_to_block_linear(dst, stride, NX_BLOCK_HEIGHT_LOG2, src + (203 * WIDTH + 101) * 4, stride, 101, 203, 101 + 200, 203 + 50);
+	ms = (now_ns() - start) / ITERATIONS / 1e6;
+	printf("  %-22s %7.3f ms/frame\n", "direct 200x50 damage", ms);
+
+	free(src);
+	free(linear);
+	free(dst);
+}
+
+typedef void (*convert_fn)(uint8_t *dst, const uint8_t *src, size_t count);
+typedef void (*premultiply_fn)(uint8_t *pixels, size_t count);
+
+static void premultiply_previous(uint8_t *pixels, size_t count)
+{
+	premultiply_alpha_previous(pixels, count, 1);
+}
+
+static void bench_in_place(const char *name, premultiply_fn fn, uint8_t *pixels)
+{
+	// Premultiply row by row, like the PNG decoder does (the alpha
+	// channel is unchanged, so every iteration does the same work)
+	double start = now_ns();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		for (int y = 0; y < HEIGHT; y++)
+			fn(pixels + y * WIDTH * 4, WIDTH);
+	}
+	double ms = (now_ns() - start) / ITERATIONS / 1e6;
+	printf("  %-10s %7.3f ms/frame\n", name, ms);
+}
+
+static void bench(const char *name, convert_fn fn, const uint8_t *src, uint8_t *dst)
+{
+	// Convert row by row, like `putImageData()` / `getImageData()` do
+	double start = now_ns();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		for (int y = 0; y < HEIGHT; y++)
+			fn(dst + y * WIDTH * 4, src + y * WIDTH * 4, WIDTH);
+	}
+	double ms = (now_ns() - start) / ITERATIONS / 1e6;
+	printf("  %-10s %7.3f ms/frame\n", name, ms);
+}
+
+static void bench_all(const char *label, int opaque)
+{
+	size_t count = WIDTH * HEIGHT;
+	uint8_t *rgba = malloc(count * 4);
+	uint8_t *bgra = malloc(count * 4);
+	uint8_t *dst = malloc(count * 4);
+	srand(42);
+	fill_random(rgba, count, 0);
+	if (opaque)
+	{
+		for (size_t i = 0; i < count; i++)
+			rgba[i * 4 + 3] = 255;
+	}
+	nx_rgba_to_bgra_premultiplied_scalar(bgra, rgba, count);
+
+	printf("putImageData() %s %dx%d:\n", label, WIDTH, HEIGHT);
+	bench("previous", put_image_data_previous, rgba, dst);
+	bench("scalar", nx_rgba_to_bgra_premultiplied_scalar, rgba, dst);
+	bench("simd", nx_rgba_to_bgra_premultiplied, rgba, dst);
+
+	printf("getImageData() %s %dx%d:\n", label, WIDTH, HEIGHT);
+	bench("previous", get_image_data_previous, bgra, dst);
+	bench("scalar", nx_bgra_premultiplied_to_rgba_scalar, bgra, dst);
+	bench("simd", nx_bgra_premultiplied_to_rgba, bgra, dst);
+
+	printf("PNG decode premultiply %s %dx%d:\n", label, WIDTH, HEIGHT);
+	memcpy(dst, rgba, count * 4);
+	bench_in_place("previous", premultiply_previous, dst);
+	bench_in_place("scalar", nx_premultiply_scalar, dst);
+	bench_in_place("simd", nx_premultiply, dst);
+
+	printf("drawImage() blend %s %dx%d:\n", label, WIDTH, HEIGHT);
+	bench("scalar", nx_blend_over_scalar, bgra, dst);
+	bench("simd", nx_blend_over, bgra, dst);
+
+	free(rgba);
+	free(bgra);
+	free(dst);
+}
+
+static void bench_downscale()
+{
+	// A 12 megapixel photo decoded into a grid thumbnail
+	uint32_t sw = 4032, sh = 3024, dw = 320, dh = 240;
+	uint8_t *src = malloc((size_t)sw * sh * 4);
+	uint8_t *dst = malloc(dw * dh * 4);
+	fill_random(src, (size_t)sw * sh, 1);
+	double start = now_ns();
+	for (int i = 0; i < 10; i++)
+		nx_downscale(dst, dw, dh, src, sw, sh, sw * 4);
+	double ms = (now_ns() - start) / 10 / 1e6;
+	printf("downscale %ux%u -> %ux%u:\n", sw, sh, dw, dh);
+	printf("  %-10s %7.3f ms\n", "scalar", ms);
+	free(src);
+	free(dst);
+}
+
+int main(int argc, char *argv[])
+{
+	srand(1);
+	test_exhaustive();
+	test_random_lengths();
+	test_premultiply_in_place();
+	test_round_trip();
+	test_block_linear();
+	test_blend_mask_solid();
+	test_blend_over();
+	test_downscale();
+	if (failures)
+	{
+		printf("%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("all checks passed\n\n");
+
+	bench_all("mixed alpha", 0);
+	bench_all("opaque", 1);
+	bench_block_linear();
+	bench_downscale();
+	return 0;
+}
@@ -0,0 +1,157 @@
+/**
+ * Host-side micro-benchmark for the `nx_poll()` watcher subsystem.
+ *
+ * Registers a read watcher on N local UDP sockets, each connected to
+ * itself (like the wakeup socket) so that it only uses one file
+ * descriptor, then repeatedly makes a small number of them readable and measures the cost of an
+ * `nx_poll()` iteration, as well as the cost of removing and re-adding
+ * every watcher. Each iteration should cost O(ready) in user space on
+ * top of the `poll()` syscall itself, independent of the number of
+ * watchers that are registered.
+ *
+ * Build and run on Linux:
+ *
+ *    cc -O2 -o bench-poll bench/poll.c source/poll.c && ./bench-poll
+ */
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "../source/poll.h"
+
+#define ITERATIONS 1000
+#define ACTIVE_PER_ITERATION 8
+
+typedef struct
+{
+	nx_read_t req;
+	uint8_t buffer[16];
+} conn_t;
+
+static unsigned long reads_completed;
+
+static double now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void on_read(nx_poll_t *p, nx_read_t *req)
+{
+	conn_t *conn = (conn_t *)req;
+	reads_completed++;
+
+	// Re-arm the watcher for the next byte
+	nx_read(p, req, req->fd, conn->buffer, sizeof(conn->buffer), on_read);
+}
+
+// Returns a UDP socket which is connected to itself, so
+// that writing to it makes it readable
+static int self_connected_socket()
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = 0,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t addr_len = sizeof(addr);
+	if (fd < 0 ||
+		bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+		getsockname(fd, (struct sockaddr *)&addr, &addr_len) < 0 ||
+		connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		perror("socket");
+		exit(1);
+	}
+	return fd;
+}
+
+static void run(int num_conns)
+{
+	nx_poll_t p;
+	memset(&p, 0, sizeof(p));
+	nx_poll_init(&p);
+
+	conn_t *conns = calloc(num_conns, sizeof(conn_t));
+	for (int i = 0; i < num_conns; i++)
+	{
+		int fd = self_connected_socket();
+		nx_read(&p, &conns[i].req, fd, conns[i].buffer, sizeof(conns[i].buffer), on_read);
+	}
+
+	// Dispatch cost with a few active sockets per iteration
+	reads_completed = 0;
+	srand(42);
+	double start = now_ns();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		for (int j = 0; j < ACTIVE_PER_ITERATION; j++)
+		{
+			conn_t *conn = &conns[rand() % num_conns];
+			if (write(conn->req.fd, "x", 1) != 1)
+			{
+				perror("write");
+				exit(1);
+			}
+		}
+		nx_poll(&p, 0);
+	}
+	double dispatch_ns = (now_ns() - start) / ITERATIONS;
+
+	// Cost of removing and re-adding every watcher
+	start = now_ns();
+	for (int i = 0; i < num_conns; i++)
+	{
+		nx_remove_watcher(&p, (nx_watcher_t *)&conns[i].req);
+	}
+	for (int i = 0; i < num_conns; i++)
+	{
+		nx_add_watcher(&p, (nx_watcher_t *)&conns[i].req);
+	}
+	double churn_ns = (now_ns() - start) / (num_conns * 2);
+
+	printf("%6d sockets: %9.0f ns/poll iteration, %6.0f ns/watcher add+remove, %lu reads\n",
+		   num_conns, dispatch_ns, churn_ns, reads_completed);
+
+	for (int i = 0; i < num_conns; i++)
+	{
+		nx_remove_watcher(&p, (nx_watcher_t *)&conns[i].req);
+		close(conns[i].req.fd);
+	}
+	nx_remove_watcher(&p, &p.wakeup_watcher);
+	close(p.wakeup_fd);
+	free(conns);
+	free(p.poll_fds);
+	free(p.ready_fds);
+	free(p.fds);
+}
+
+int main(int argc, char *argv[])
+{
+	// Each connection uses one file descriptor
+	struct rlimit rl;
+	getrlimit(RLIMIT_NOFILE, &rl);
+	rl.rlim_cur = rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rl);
+	getrlimit(RLIMIT_NOFILE, &rl);
+
+	int sizes[] = {100, 1000, 10000};
+	for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		if (sizes[i] + 16 > rl.rlim_cur)
+		{
+			printf("%6d sockets: skipped (RLIMIT_NOFILE is %lu)\n", sizes[i], (unsigned long)rl.rlim_cur);
+			continue;
+		}
+		run(sizes[i]);
+	}
+	return 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * Host-side micro-benchmark for the async thread pool.
+ *
+ * Compares the work-stealing `nx_thread_pool_t` against the previous
+ * single-queue `thpool` (kept in this directory as the baseline) for:
+ *
+ *   - throughput: submitting a large number of tiny jobs and waiting
+ *     for all of them to complete
+ *   - wake latency: time from submitting a single job to an idle pool
+ *     until the job starts running
+ *   - priority latency: time until a latency sensitive job starts running
+ *     when it is submitted behind a backlog of bulk jobs
+ *
+ * Build and run on Linux:
+ *
+ *    cc -O2 -pthread -o bench-thread-pool bench/thread-pool.c bench/thpool.c source/thread-pool.c && ./bench-thread-pool
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include "thpool.h"
+#include "../source/thread-pool.h"
+
+#define NUM_THREADS 4
+#define TINY_JOBS 200000
+#define WAKE_SAMPLES 1000
+#define BACKLOG_JOBS 2000
+#define BULK_JOB_ITERATIONS 20000
+
+typedef struct
+{
+	nx_thread_pool_job_t job;
+	int iterations;
+	double started_ns;
+} bench_job_t;
+
+static atomic_ulong jobs_completed;
+
+static double now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void do_job(void *arg)
+{
+	bench_job_t *job = arg;
+	job->started_ns = now_ns();
+
+	// Simulate a small amount of CPU work
+	volatile unsigned long x = 0;
+	for (int i = 0; i < job->iterations; i++)
+		x += i;
+
+	atomic_fetch_add_explicit(&jobs_completed, 1, memory_order_relaxed);
+}
+
+static void init_jobs(bench_job_t *jobs, int count, int iterations)
+{
+	for (int i = 0; i < count; i++)
+	{
+		jobs[i].job.fn = do_job;
+		jobs[i].job.arg = &jobs[i];
+		jobs[i].iterations = iterations;
+		jobs[i].started_ns = 0;
+	}
+}
+
+/* ========================== THROUGHPUT ============================= */
+
+static double throughput_thpool(bench_job_t *jobs)
+{
+	threadpool pool = thpool_init(NUM_THREADS);
+	double start = now_ns();
+	for (int i = 0; i < TINY_JOBS; i++)
+		thpool_add_work(pool, do_job, &jobs[i]);
+	thpool_wait(pool);
+	double elapsed = now_ns() - start;
+	thpool_destroy(pool);
+	return elapsed;
+}
+
+static double throughput_nx(bench_job_t *jobs)
+{
+	nx_thread_pool_t *pool = nx_thread_pool_init(NUM_THREADS);
+	double start = now_ns();
+	for (int i = 0; i < TINY_JOBS; i++)
+		nx_thread_pool_add_work(pool, &jobs[i].job, NX_THREAD_POOL_PRIORITY_NORMAL);
+	nx_thread_pool_wait(pool);
+	double elapsed = now_ns() - start;
+	nx_thread_pool_destroy(pool);
+	return elapsed;
+}
+
+/* ========================== WAKE LATENCY =========================== */
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+static void print_latency(const char *name, double *samples, int count)
+{
+	qsort(samples, count, sizeof(double), compare_double);
+	printf("  %-14s p50 %8.0f ns   p99 %8.0f ns\n", name,
+		   samples[count / 2], samples[count * 99 / 100]);
+}
+
+static void wake_latency_thpool(double *samples)
+{
+	threadpool pool = thpool_init(NUM_THREADS);
+	bench_job_t job;
+	init_jobs(&job, 1, 0);
+	for (int i = 0; i < WAKE_SAMPLES; i++)
+	{
+		// Give the workers time to go back to sleep
+		usleep(200);
+		double submitted = now_ns();
+		thpool_add_work(pool, do_job, &job);
+		thpool_wait(pool);
+		samples[i] = job.started_ns - submitted;
+	}
+	thpool_destroy(pool);
+}
+
+static void wake_latency_nx(double *samples)
+{
+	nx_thread_pool_t *pool = nx_thread_pool_init(NUM_THREADS);
+	bench_job_t job;
+	init_jobs(&job, 1, 0);
+	for (int i = 0; i < WAKE_SAMPLES; i++)
+	{
+		usleep(200);
+		double submitted = now_ns();
+		nx_thread_pool_add_work(pool, &job.job, NX_THREAD_POOL_PRIORITY_NORMAL);
+		nx_thread_pool_wait(pool);
+		samples[i] = job.started_ns - submitted;
+	}
+	nx_thread_pool_destroy(pool);
+}
+
+/* ======================== PRIORITY LATENCY ========================= */
+
+static double priority_latency_thpool(bench_job_t *backlog)
+{
+	threadpool pool = thpool_init(NUM_THREADS);
+	bench_job_t urgent;
+	init_jobs(&urgent, 1, 0);
+	for (int i = 0; i < BACKLOG_JOBS; i++)
+		thpool_add_work(pool, do_job, &backlog[i]);
+	double submitted = now_ns();
+	thpool_add_work(pool, do_job, &urgent);
+	thpool_wait(pool);
+	thpool_destroy(pool);
+	return urgent.started_ns - submitted;
+}
+
+static double priority_latency_nx(bench_job_t *backlog)
+{
+	nx_thread_pool_t *pool = nx_thread_pool_init(NUM_THREADS);
+	bench_job_t urgent;
+	init_jobs(&urgent, 1, 0);
+	for (int i = 0; i < BACKLOG_JOBS; i++)
+		nx_thread_pool_add_work(pool, &backlog[i].job, NX_THREAD_POOL_PRIORITY_NORMAL);
+	double submitted = now_ns();
+	nx_thread_pool_add_work(pool, &urgent.job, NX_THREAD_POOL_PRIORITY_HIGH);
+	nx_thread_pool_wait(pool);
+	nx_thread_pool_destroy(pool);
+	return urgent.started_ns - submitted;
+}
+
+int main(int argc, char *argv[])
+{
+	bench_job_t *jobs = malloc(TINY_JOBS * sizeof(bench_job_t));
+	double *samples = malloc(WAKE_SAMPLES * sizeof(double));
+
+	printf("%d threads, %d tiny jobs:\n", NUM_THREADS, TINY_JOBS);
+	init_jobs(jobs, TINY_JOBS, 10);
+	atomic_store(&jobs_completed, 0);
+	double elapsed = throughput_thpool(jobs);
+	printf("  %-14s %8.0f ns/job (%lu completed)\n", "thpool", elapsed / TINY_JOBS, atomic_load(&jobs_completed));
+	init_jobs(jobs, TINY_JOBS, 10);
+	atomic_store(&jobs_completed, 0);
+	elapsed = throughput_nx(jobs);
+	printf("  %-14s %8.0f ns/job (%lu completed)\n", "nx_thread_pool", elapsed / TINY_JOBS, atomic_load(&jobs_completed));
+
+	printf("Wake latency of an idle pool (%d samples):\n", WAKE_SAMPLES);
+	wake_latency_thpool(samples);
+	print_latency("thpool", samples, WAKE_SAMPLES);
+	wake_latency_nx(samples);
+	print_latency("nx_thread_pool", samples, WAKE_SAMPLES);
+
+	printf("Latency of an urgent job behind %d bulk jobs:\n", BACKLOG_JOBS);
+	init_jobs(jobs, BACKLOG_JOBS, BULK_JOB_ITERATIONS);
+	printf("  %-14s %8.0f us\n", "thpool", priority_latency_thpool(jobs) / 1000);
+	init_jobs(jobs, BACKLOG_JOBS, BULK_JOB_ITERATIONS);
+	printf("  %-14s %8.0f us\n", "nx_thread_pool", priority_latency_nx(jobs) / 1000);
+
+	free(samples);
+	free(jobs);
+	return 0;
+}
@@ -5,6 +5,14 @@ APP="${1-hello-world}"
 
 # Build JS runtime
 pnpm bundle
+if [ -n "${QUICKJS_DIR-}" ]; then
+	# Precompile the runtime into QuickJS bytecode
+	pnpm bytecode
+else
+	# Bytecode left over from an earlier build would be
+	# loaded instead of the runtime that was just bundled
+	rm -f ./packages/runtime/runtime.jsbc ./romfs/runtime.jsbc
+fi
 mkdir -p romfs
 cp -v ./packages/runtime/runtime.* ./romfs/
 
@@ -0,0 +1,128 @@
+/**
+ * Host-side tool that compiles JavaScript source code into QuickJS bytecode,
+ * which nx.js loads at startup with `JS_ReadObject()` instead of parsing the
+ * source code on every launch.
+ *
+ * Must be linked against the same version of QuickJS that nx.js uses,
+ * otherwise the bytecode will be rejected at runtime (and nx.js will
+ * fall back to evaluating the source code).
+ *
+ * Usage: nxjs-bytecode [--module] <input.js> <output.jsbc> [filename]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <quickjs.h>
+
+static char *read_file(const char *filename, size_t *out_size)
+{
+	FILE *file = fopen(filename, "rb");
+	if (file == NULL)
+	{
+		return NULL;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size_t size = ftell(file);
+	rewind(file);
+
+	char *buffer = malloc(size + 1);
+	if (buffer == NULL)
+	{
+		fclose(file);
+		return NULL;
+	}
+
+	size_t result = fread(buffer, 1, size, file);
+	fclose(file);
+
+	if (result != size)
+	{
+		free(buffer);
+		return NULL;
+	}
+
+	// QuickJS requires the source code to be NULL terminated
+	buffer[size] = '\0';
+	*out_size = size;
+	return buffer;
+}
+
+int main(int argc, char *argv[])
+{
+	int eval_flags = JS_EVAL_TYPE_GLOBAL;
+	int arg = 1;
+	if (arg < argc && strcmp(argv[arg], "--module") == 0)
+	{
+		eval_flags = JS_EVAL_TYPE_MODULE;
+		arg++;
+	}
+	if (argc - arg < 2)
+	{
+		fprintf(stderr, "Usage: %s [--module] <input.js> <output.jsbc> [filename]\n", argv[0]);
+		return 2;
+	}
+	const char *input_path = argv[arg];
+	const char *output_path = argv[arg + 1];
+
+	// The filename that gets embedded into the bytecode, which is used in
+	// stack traces. Should match the path of the source file on the Switch
+	// (i.e. "romfs:/runtime.js") so that source maps continue to work.
+	const char *filename = argc - arg > 2 ? argv[arg + 2] : input_path;
+
+	size_t source_size;
+	char *source = read_file(input_path, &source_size);
+	if (source == NULL)
+	{
+		perror(input_path);
+		return 1;
+	}
+
+	JSRuntime *rt = JS_NewRuntime();
+	JSContext *ctx = JS_NewContext(rt);
+	int ret = 1;
+
+	JSValue obj = JS_Eval(ctx, source, source_size, filename, eval_flags | JS_EVAL_FLAG_COMPILE_ONLY);
+	if (JS_IsException(obj))
+	{
+		JSValue exception = JS_GetException(ctx);
+		const char *str = JS_ToCString(ctx, exception);
+		fprintf(stderr, "%s: %s\n", input_path, str);
+		JS_FreeCString(ctx, str);
+		JS_FreeValue(ctx, exception);
+		goto cleanup;
+	}
+
+	size_t bytecode_size;
+	uint8_t *bytecode = JS_WriteObject(ctx, &bytecode_size, obj, JS_WRITE_OBJ_BYTECODE);
+	JS_FreeValue(ctx, obj);
+	if (bytecode == NULL)
+	{
+		fprintf(stderr, "%s: failed to serialize bytecode\n", input_path);
+		goto cleanup;
+	}
+
+	FILE *out = fopen(output_path, "wb");
+	if (out == NULL)
+	{
+		perror(output_path);
+		js_free(ctx, bytecode);
+		goto cleanup;
+	}
+	if (fwrite(bytecode, 1, bytecode_size, out) == bytecode_size)
+	{
+		ret = 0;
+	}
+	else
+	{
+		perror(output_path);
+	}
+	fclose(out);
+	js_free(ctx, bytecode);
+
+cleanup:
+	free(source);
+	JS_FreeContext(ctx);
+	JS_FreeRuntime(rt);
+	return ret;
+}
@@ -0,0 +1,53 @@
+import os from 'os';
+import path from 'path';
+import { execFileSync } from 'child_process';
+import { fileURLToPath } from 'url';
+
+// Compiles `runtime.js` into QuickJS bytecode (`runtime.jsbc`), which is
+// loaded by nx.js at startup instead of parsing the JavaScript source.
+//
+// Requires a host build of the same QuickJS version that is linked into
+// nx.js. Set `QUICKJS_DIR` to a directory containing `quickjs.h` and `libqjs.a`.
+//
+// Additional arguments are forwarded to the compiler, so that app
+// entrypoints may be precompiled as well:
+//
+//   node bytecode.mjs --module romfs/main.js romfs/main.jsbc romfs:/main.js
+
+const __dirname = path.dirname(fileURLToPath(import.meta.url));
+
+const quickjsDir = process.env.QUICKJS_DIR;
+if (!quickjsDir) {
+	throw new Error(
+		'`QUICKJS_DIR` must be set to a host build of the QuickJS library',
+	);
+}
+
+const cc = process.env.CC || 'cc';
+const compiler = path.join(os.tmpdir(), 'nxjs-bytecode');
+execFileSync(
+	cc,
+	[
+		'-O2',
+		'-o',
+		compiler,
+		path.join(__dirname, 'bytecode.c'),
+		`-I${quickjsDir}`,
+		`-L${quickjsDir}`,
+		'-lqjs',
+		'-lm',
+		'-lpthread',
+	],
+	{ stdio: 'inherit' },
+);
+
+let args = process.argv.slice(2);
+if (args.length === 0) {
+	args = [
+		path.join(__dirname, 'runtime.js'),
+		path.join(__dirname, 'runtime.jsbc'),
+		'romfs:/runtime.js',
+	];
+}
+execFileSync(compiler, args, { stdio: 'inherit' });
+
@@ -2,6 +2,10 @@ import type {
 	Album,
 	AlbumFile,
 	Application,
+	FrameTimings,
+	GlyphAtlasStats,
+	GlyphCacheStats,
+	ImageCacheStats,
 	IRSensor,
 	NetworkInfo,
 	Profile,
@@ -17,6 +21,7 @@ import type {
 	Keys,
 	Opaque,
 	RGBA,
+	TimerOpaque,
 	VibrationValues,
 	WasmGlobalOpaque,
 	WasmInstanceOpaque,
@@ -37,11 +42,14 @@ import type { FontFace } from './font/font-face';
 import type { URL, URLSearchParams } from './polyfills/url';
 import type { DOMPoint, DOMPointInit } from './dompoint';
 import type { DOMMatrix, DOMMatrixReadOnly, DOMMatrixInit } from './dommatrix';
+import type { Path2D } from './canvas/path2d';
+import type { CanvasImageSource } from './types';
 
 type ClassOf<T> = {
 	new (...args: any[]): T;
 };
 
+type ImageDecoder = Opaque<'ImageDecoder'>;
 type SaveDataIterator = Opaque<'SaveDataIterator'>;
 type URLSearchParamsIterator = Opaque<'URLSearchParamsIterator'>;
 
@@ -66,6 +74,9 @@ export interface Init {
 	appletGetOperationMode(): number;
 	appletSetMediaPlaybackState(state: boolean): void;
 
+	// async.c
+	asyncCancel(promise: Promise<unknown>): boolean;
+
 	// battery.c
 	batteryInit(): void;
 	batteryInitClass(c: ClassOf<BatteryManager>): void;
@@ -74,11 +85,30 @@ export interface Init {
 	// canvas.c
 	canvasNew(width: number, height: number): Screen | OffscreenCanvas;
 	canvasInitClass(c: ClassOf<Screen | OffscreenCanvas>): void;
+	canvasGetPixelView(c: Screen | OffscreenCanvas): ArrayBuffer;
+	canvasReleasePixelView(
+		c: Screen | OffscreenCanvas,
+		buffer: ArrayBufferLike,
+	): void;
 	canvasContext2dNew(c: Screen): CanvasRenderingContext2D;
 	canvasContext2dNew(c: OffscreenCanvas): OffscreenCanvasRenderingContext2D;
 	canvasContext2dInitClass(
 		c: ClassOf<CanvasRenderingContext2D | OffscreenCanvasRenderingContext2D>,
 	): void;
+	canvasContext2dDrawImages(
+		ctx: CanvasRenderingContext2D | OffscreenCanvasRenderingContext2D,
+		image: CanvasImageSource,
+		buffer: ArrayBufferLike,
+		byteOffset: number,
+		length: number,
+	): void;
+	canvasContext2dFlushCommands(
+		ctx: CanvasRenderingContext2D | OffscreenCanvasRenderingContext2D,
+		buffer: ArrayBufferLike,
+		length: number,
+		images: CanvasImageSource[],
+		tiled: boolean,
+	): void;
 	canvasContext2dGetImageData(
 		ctx: CanvasRenderingContext2D | OffscreenCanvasRenderingContext2D,
 		sx: number,
@@ -137,6 +167,18 @@ export interface Init {
 	fontFaceNew(data: ArrayBuffer): FontFace;
 	getSystemFont(): ArrayBuffer;
 
+	// frame-timing.c
+	frameTimings(): FrameTimings;
+	frameSetRateCap(fps: number): void;
+	frameSetDrainBudget(ms: number): void;
+
+	// glyph-atlas.c
+	glyphAtlasStats(): GlyphAtlasStats;
+
+	// glyph-cache.c
+	glyphCacheStats(): GlyphCacheStats;
+	glyphCacheSetLimit(bytes: number): void;
+
 	// fs.c
 	mkdirSync(path: string, mode: number): number;
 	readDirSync(path: string): string[] | null;
@@ -156,11 +198,37 @@ export interface Init {
 	fsOpenSaveDataInfoReader(saveDataSpaceId: number): SaveDataIterator | null;
 	fsSaveDataInfoReaderNext(iterator: SaveDataIterator): SaveData | null;
 
+	// image-cache.c
+	imageCacheGet(img: Image, key: string): boolean;
+	imageCachePut(img: Image, key: string): void;
+	imageCacheClear(): void;
+	imageCacheStats(): ImageCacheStats;
+	imageCacheSetLimit(bytes: number): void;
+
 	// image.c
 	imageInit(c: ClassOf<Image | ImageBitmap>): void;
 	imageNew(width?: number, height?: number): Image | ImageBitmap;
-	imageDecode(img: Image, data: ArrayBuffer): Promise<void>;
+	imageDecode(
+		img: Image | ImageBitmap,
+		data: ArrayBuffer,
+		width?: number,
+		height?: number,
+	): Promise<void>;
+	imageDecodeBatch(
+		imgs: ImageBitmap[],
+		data: ArrayBuffer[],
+		width: number,
+		height: number,
+	): Promise<(Error | undefined)[]>;
 	imageClose(img: ImageBitmap): void;
+	imageDecoderNew(img: Image): ImageDecoder;
+	imageDecoderWrite(
+		decoder: ImageDecoder,
+		data: ArrayBuffer,
+		byteOffset: number,
+		length: number,
+	): Promise<void>;
+	imageDecoderClose(decoder: ImageDecoder): boolean;
 
 	// irs.c
 	irsInit(): () => void;
@@ -186,6 +254,11 @@ export interface Init {
 	onFrame(fn: (kDown: number) => void): void;
 	onExit(fn: () => void): void;
 	framebufferInit(screen: Screen): void;
+	framebufferSetOverlay(
+		overlay: OffscreenCanvas | null,
+		x: number,
+		y: number,
+	): void;
 	hidInitializeTouchScreen(): void;
 	hidGetTouchScreenStates(): Touch[] | undefined;
 	hidInitializeKeyboard(): void;
@@ -203,6 +276,10 @@ export interface Init {
 	nsAppNew(id: BigInt | ArrayBuffer | null): Application;
 	nsAppNext(index: number): bigint | null;
 
+	// path2d.c
+	path2dNew(path?: Path2D | string): Path2D;
+	path2dInitClass(c: ClassOf<Path2D>): void;
+
 	// software-keyboard.c
 	swkbdCreate(fns: {
 		onCancel: (this: VirtualKeyboard) => void;
@@ -236,6 +313,11 @@ export interface Init {
 		onAccept: (fd: number) => void,
 	): Server;
 
+	// timers.c
+	onTimer(fn: (id: number) => void): void;
+	timerNew(id: number, timeout: number, repeat: boolean): TimerOpaque;
+	timerClear(timer: TimerOpaque): void;
+
 	// tls.c
 	tlsHandshake(
 		cb: Callback<TlsContextOpaque>,
@@ -280,8 +362,6 @@ export interface Init {
 	wasmModuleImports(m: WasmModuleOpaque): any[];
 	wasmGlobalGet(g: WasmGlobalOpaque): any;
 	wasmGlobalSet(g: WasmGlobalOpaque, v: any): void;
-
-	applyPath: any;
 }
 
 export const $: Init = (globalThis as any).$;
@@ -1,5 +1,6 @@
 import { $ } from '../$';
-import { assertInternalConstructor, def } from '../utils';
+import { abortable, assertInternalConstructor, def, proto } from '../utils';
+import { Blob } from '../polyfills/blob';
 import type { ImageBitmapSource } from '../types';
 
 /**
@@ -42,6 +43,19 @@ export class ImageBitmap implements globalThis.ImageBitmap {
 $.imageInit(ImageBitmap);
 def(ImageBitmap);
 
+function resizeSize(options?: ImageBitmapOptions) {
+	const { resizeWidth = 0, resizeHeight = 0 } = options ?? {};
+	if (
+		!Number.isInteger(resizeWidth) ||
+		!Number.isInteger(resizeHeight) ||
+		resizeWidth < 0 ||
+		resizeHeight < 0
+	) {
+		throw new RangeError('Invalid `resizeWidth` or `resizeHeight`');
+	}
+	return [resizeWidth, resizeHeight];
+}
+
 export interface ImageBitmapOptions {
 	colorSpaceConversion?: ColorSpaceConversion;
 	imageOrientation?: ImageOrientation;
@@ -56,6 +70,24 @@ export interface ImageBitmapOptions {
  * a portion of that source. This function accepts a variety of different
  * image sources, and returns a `Promise` which resolves to an {@link ImageBitmap}.
  *
+ * Currently only `Blob` sources containing PNG, JPEG or WebP image data are
+ * supported. When `resizeWidth` and / or `resizeHeight` are specified, the
+ * image is decoded directly to that size (using JPEG DCT scaling, WebP's
+ * scaled decoding, or by reducing PNG rows as they are decoded), so that
+ * memory usage and decode time scale with the size that the image is
+ * displayed at, rather than with its full size. This is much more efficient
+ * than decoding at full size and then scaling with `drawImage()`, i.e. for
+ * thumbnail grids.
+ *
+ * @example
+ *
+ * ```typescript
+ * const res = await fetch('sdmc:/photos/IMG_0001.jpg');
+ * const thumbnail = await createImageBitmap(await res.blob(), {
+ *   resizeWidth: 160,
+ * });
+ * ```
+ *
  * @see https://developer.mozilla.org/docs/Web/API/createImageBitmap
  */
 export function createImageBitmap(
@@ -78,6 +110,86 @@ export async function createImageBitmap(
 	sh?: number,
 	options?: ImageBitmapOptions,
 ): Promise<ImageBitmap> {
-	throw new Error('Function not implemented');
+	if (typeof optionsOrSx === 'number') {
+		throw new Error('Cropping is not implemented');
+	}
+	if (!(image instanceof Blob)) {
+		throw new TypeError('Only `Blob` image sources are supported');
+	}
+	const [resizeWidth, resizeHeight] = resizeSize(optionsOrSx);
+	const bitmap = proto($.imageNew(), ImageBitmap);
+	await $.imageDecode(
+		bitmap,
+		await image.arrayBuffer(),
+		resizeWidth,
+		resizeHeight,
+	);
+	return bitmap;
 }
 def(createImageBitmap);
+
+export interface DecodeImagesOptions
+	extends Pick<ImageBitmapOptions, 'resizeWidth' | 'resizeHeight'> {
+	/**
+	 * Cancels the decoding of any images which have not started yet.
+	 */
+	signal?: AbortSignal;
+}
+
+/**
+ * Decodes many images at once, and resolves with an {@link ImageBitmap}
+ * for each of them, in the same order as `sources`.
+ *
+ * Calling {@link createImageBitmap | `createImageBitmap()`} for every
+ * image means a separate native request, Promise and completion callback
+ * per image. Here the whole batch is a single request, which decodes the
+ * images in parallel on every thread of the thread pool, and resolves once
+ * when all of them are done. This is intended for loading the assets of a
+ * level or a sprite sheet up front.
+ *
+ * The sources may be `Blob`s or `ArrayBuffer`s containing PNG, JPEG or WebP
+ * image data. `resizeWidth` and `resizeHeight` apply to every image (see
+ * {@link createImageBitmap | `createImageBitmap()`}). If any of the images
+ * fails to decode, then the Promise rejects, and the other images are
+ * closed.
+ *
+ * @example
+ *
+ * ```typescript
+ * const names = ['player.png', 'enemy.png', 'tiles.png'];
+ * const sources = await Promise.all(
+ *   names.map(async (name) => {
+ *     const res = await fetch(new URL(name, Switch.entrypoint));
+ *     return res.blob();
+ *   }),
+ * );
+ * const [player, enemy, tiles] = await Switch.decodeImages(sources);
+ * ```
+ */
+export async function decodeImages(
+	sources: (Blob | ArrayBuffer)[],
+	options?: DecodeImagesOptions,
+): Promise<ImageBitmap[]> {
+	const [resizeWidth, resizeHeight] = resizeSize(options);
+	const buffers = await Promise.all(
+		sources.map((source) => {
+			if (source instanceof ArrayBuffer) return source;
+			if (source instanceof Blob) return source.arrayBuffer();
+			throw new TypeError(
+				'Only `Blob` and `ArrayBuffer` sources are supported',
+			);
+		}),
+	);
+	const bitmaps = buffers.map(() => proto($.imageNew(), ImageBitmap));
+	const errors = await abortable(options?.signal, () =>
+		$.imageDecodeBatch(bitmaps, buffers, resizeWidth, resizeHeight),
+	);
+	const index = errors.findIndex((err) => err);
+	if (index !== -1) {
+		for (const bitmap of bitmaps) bitmap.close();
+		throw new Error(
+			`Failed to decode image ${index}: ${errors[index]!.message}`,
+		);
+	}
+	return bitmaps;
+}
@@ -280,6 +280,24 @@ export class OffscreenCanvasRenderingContext2D {
 	 */
 	declare textBaseline: CanvasTextBaseline;
 
+	/**
+	 * Provides information to the rendering engine about what to optimize
+	 * for when rendering text.
+	 *
+	 * When set to `"optimizeSpeed"`, {@link OffscreenCanvasRenderingContext2D.fillText | `fillText()`}
+	 * rasterizes each glyph only once (per font, size and subpixel offset)
+	 * into a glyph atlas, and subsequent text is drawn by blending glyphs
+	 * from the atlas. This is much faster for text-heavy interfaces, at the
+	 * cost of slightly different glyph rendering. Text that is transformed
+	 * by more than a translation, clipped by a non-rectangular path, or
+	 * composited with an operation other than `"source-over"` is still
+	 * drawn normally.
+	 *
+	 * @default "auto"
+	 * @see https://developer.mozilla.org/docs/Web/API/CanvasRenderingContext2D/textRendering
+	 */
+	declare textRendering: CanvasTextRendering;
+
 	/**
 	 * Starts a new path by emptying the list of sub-paths.
 	 * Call this method when you want to create a new path.
@@ -730,6 +748,36 @@ export class OffscreenCanvasRenderingContext2D {
 		stub();
 	}
 
+	/**
+	 * Draws many regions of the same image onto the canvas in a single call,
+	 * such as the sprites of a sprite sheet or the tiles of a tile map.
+	 *
+	 * `rects` contains eight numbers for each region to draw, which are the
+	 * same as the `sx`, `sy`, `sWidth`, `sHeight`, `dx`, `dy`, `dWidth` and
+	 * `dHeight` arguments of {@link drawImage | `drawImage()`}. Passing a
+	 * `Float64Array` avoids copying the rectangles.
+	 *
+	 * Regions which are drawn at their natural size onto whole pixels (with no
+	 * scaling, rotation or `globalAlpha`) are copied directly into the canvas,
+	 * which is considerably faster than going through the generic path.
+	 *
+	 * @param image The image to draw onto the canvas.
+	 * @param rects Source and destination rectangles, eight numbers per region.
+	 * @example
+	 *
+	 * ```typescript
+	 * // Draw two 16x16 tiles from a tile sheet
+	 * ctx.drawImages(tiles, [
+	 *   0, 0, 16, 16, 0, 0, 16, 16,
+	 *   16, 0, 16, 16, 16, 0, 16, 16,
+	 * ]);
+	 * ```
+	 */
+	drawImages(image: CanvasImageSource, rects: ArrayLike<number>): void {
+		const r = rects instanceof Float64Array ? rects : Float64Array.from(rects);
+		$.canvasContext2dDrawImages(this, image, r.buffer, r.byteOffset, r.length);
+	}
+
 	lineTo(x: number, y: number): void {
 		stub();
 	}
@@ -69,6 +69,43 @@ export class OffscreenCanvas
 		return i.context2d;
 	}
 
+	/**
+	 * Returns a `Uint32Array` which directly aliases the pixel buffer of the
+	 * canvas, without copying. Each element is one pixel in the canvas' native
+	 * format: `0xAARRGGBB` with premultiplied alpha. Any pending drawing is
+	 * flushed to the buffer first.
+	 *
+	 * After modifying the pixels, pass the view to
+	 * {@link releasePixelView | `releasePixelView()`}. The view is detached
+	 * once it has been released. Until then, drawing to the canvas and
+	 * calling `getPixelView()` again throw a `TypeError`.
+	 *
+	 * This is a non-standard API which avoids the copies and pixel format
+	 * conversions of `getImageData()` / `putImageData()`.
+	 *
+	 * @example
+	 *
+	 * ```typescript
+	 * const pixels = canvas.getPixelView();
+	 * for (let i = 0; i < pixels.length; i++) {
+	 *   // Invert the color of every opaque pixel
+	 *   if (pixels[i] >>> 24 === 0xff) pixels[i] ^= 0x00ffffff;
+	 * }
+	 * canvas.releasePixelView(pixels);
+	 * ```
+	 */
+	getPixelView(): Uint32Array {
+		return new Uint32Array($.canvasGetPixelView(this));
+	}
+
+	/**
+	 * Marks the pixels of the canvas as modified, and detaches a view that
+	 * was returned from {@link getPixelView | `getPixelView()`}.
+	 */
+	releasePixelView(view: Uint32Array) {
+		$.canvasReleasePixelView(this, view.buffer);
+	}
+
 	transferToImageBitmap(): ImageBitmap {
 		throw new Error('Method not implemented.');
 	}
@@ -1,4 +1,6 @@
 import { $ } from './$';
+import { abortable } from './utils';
+import type { AsyncOptions } from './fs';
 
 /**
  * Performs a DNS lookup to resolve a hostname to an array of IP addresses.
@@ -8,7 +10,10 @@ import { $ } from './$';
  * ```typescript
  * const ipAddresses = await Switch.resolveDns('example.com');
  * ```
+ *
+ * @param hostname The hostname to resolve.
+ * @param opts Optional `signal` to cancel the lookup.
  */
-export function resolveDns(hostname: string) {
-	return $.dnsResolve(hostname);
+export function resolveDns(hostname: string, opts?: AsyncOptions) {
+	return abortable(opts?.signal, () => $.dnsResolve(hostname));
 }
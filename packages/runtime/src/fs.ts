@@ -1,7 +1,17 @@
 import { $ } from './$';
-import { bufferSourceToArrayBuffer, pathToString } from './utils';
+import { abortable, bufferSourceToArrayBuffer, pathToString } from './utils';
 import { encoder } from './polyfills/text-encoder';
 import type { PathLike } from './switch';
+import type { AbortSignal } from './polyfills/abort-controller';
+
+export interface AsyncOptions {
+	/**
+	 * An `AbortSignal` which cancels the operation when aborted. If the
+	 * operation has not started yet then it is skipped entirely, and the
+	 * returned Promise rejects with the signal's `reason`.
+	 */
+	signal?: AbortSignal;
+}
 
 /**
  * Creates the directory at the provided `path`, as well as any necessary parent directories.
@@ -32,9 +42,12 @@ export function mkdirSync(path: PathLike, mode = 0o777) {
  * const buffer = await Switch.readFile('sdmc:/switch/awesome-app/state.json');
  * const gameState = JSON.parse(new TextDecoder().decode(buffer));
  * ```
+ *
+ * @param path File path to read.
+ * @param opts Optional `signal` to cancel the read.
  */
-export function readFile(path: PathLike) {
-	return $.readFile(pathToString(path));
+export function readFile(path: PathLike, opts?: AsyncOptions) {
+	return abortable(opts?.signal, () => $.readFile(pathToString(path)));
 }
 
 /**
@@ -115,7 +128,8 @@ export function statSync(path: PathLike) {
  * information about the file pointed to by `path`.
  *
  * @param path File path to retrieve file stats for.
+ * @param opts Optional `signal` to cancel the operation.
  */
-export function stat(path: PathLike) {
-	return $.stat(pathToString(path));
+export function stat(path: PathLike, opts?: AsyncOptions) {
+	return abortable(opts?.signal, () => $.stat(pathToString(path)));
 }
@@ -1,18 +1,88 @@
 import { $ } from './$';
-import { createInternal, def } from './utils';
+import { abortable, createInternal, def } from './utils';
 import { fetch } from './fetch/fetch';
+import { stat } from './fs';
 import { URL } from './polyfills/url';
 import { Event, ErrorEvent } from './polyfills/event';
 import { EventTarget } from './polyfills/event-target';
+import { AbortController } from './polyfills/abort-controller';
 import type { CanvasRenderingContext2D } from './canvas/canvas-rendering-context-2d';
 
 interface ImageInternal {
 	complete: boolean;
 	src?: URL;
+	// Aborts the in-progress load when `src` is changed
+	controller?: AbortController;
 }
 
 const _ = createInternal<Image, ImageInternal>();
 
+// Returns the key that the decoded image of `url` is cached under, or
+// `undefined` when it can not be cached. Local files may be rewritten,
+// so their key includes the size and modification time of the file,
+// which is looked up without blocking the JS thread.
+function imageCacheKey(
+	url: URL,
+	signal: AbortSignal,
+): string | Promise<string | undefined> | undefined {
+	switch (url.protocol) {
+		case 'blob:':
+		case 'data:':
+		case 'romfs:':
+			return url.href;
+		case 'file:':
+		case 'sdmc:':
+			return stat(
+				url.protocol === 'file:' ? `sdmc:${url.pathname}` : url.href,
+				{ signal },
+			).then(
+				(info) =>
+					info ? `${url.href}#${info.size}:${info.mtime}` : undefined,
+				() => undefined,
+			);
+	}
+	// Remote content may change without its URL changing
+	return undefined;
+}
+
+// Decodes each chunk of `body` as it arrives, so that the
+// encoded image never needs to be buffered in full
+async function decodeStream(
+	img: Image,
+	body: ReadableStream<Uint8Array>,
+	signal: AbortSignal,
+) {
+	const decoder = $.imageDecoderNew(img);
+	const reader = body.getReader();
+	// Stop writing to `img` as soon as a newer `src` is set,
+	// even if a chunk is still being decoded
+	const onAbort = () => $.imageDecoderClose(decoder);
+	signal.addEventListener('abort', onAbort);
+	try {
+		while (true) {
+			const { done, value } = await abortable(signal, () => reader.read());
+			if (done) break;
+			await abortable(signal, () =>
+				$.imageDecoderWrite(
+					decoder,
+					value.buffer as ArrayBuffer,
+					value.byteOffset,
+					value.byteLength,
+				),
+			);
+		}
+	} catch (err) {
+		$.imageDecoderClose(decoder);
+		reader.cancel(err).catch(() => {});
+		throw err;
+	} finally {
+		signal.removeEventListener('abort', onAbort);
+	}
+	if (!$.imageDecoderClose(decoder)) {
+		throw new Error('Image data ended unexpectedly');
+	}
+}
+
 /**
  * The `Image` class is the spiritual equivalent of the [`HTMLImageElement`](https://developer.mozilla.org/docs/Web/API/HTMLImageElement)
  * class in web browsers. You can use it to load image data from the filesytem
@@ -36,6 +106,21 @@ const _ = createInternal<Image, ImageInternal>();
  * });
  * img.src = 'romfs:/logo.png';
  * ```
+ *
+ * The image data is decoded as it is received, so the image's `width` and
+ * `height` are available, and the rows which have been decoded so far can
+ * be drawn, before the `load` event (i.e. while a large image is still
+ * downloading). Interlaced PNGs with transparency, and progressive JPEGs,
+ * only become visible once they have been received in full.
+ *
+ * Decoded images are cached by URL, so loading the same `src` again (i.e.
+ * when a screen is shown again) shares the pixels of the cached image
+ * instead of reading and decoding it again. Images from `sdmc:` and
+ * `file:` URLs are only shared while the size and modification time of the
+ * file are unchanged (which is checked asynchronously, so they are not
+ * available immediately), and images from `http:` and `https:` URLs are not
+ * cached, since their content may change. The size of the cache is set
+ * with `Switch.performance.imageCacheLimit`.
  */
 export class Image extends EventTarget {
 	declare onload: ((this: Image, ev: Event) => any) | null;
@@ -88,25 +173,54 @@ export class Image extends EventTarget {
 		const url = new URL(val, $.entrypoint);
 		const internal = _(this);
 		internal.src = url;
-		internal.complete = false;
-		fetch(url)
-			.then((res) => {
-				if (!res.ok) {
-					throw new Error(`Failed to load image: ${res.status}`);
-				}
-				return res.arrayBuffer();
-			})
-			.then((buf) => $.imageDecode(this, buf))
-			.then(
-				() => {
-					internal.complete = true;
-					this.dispatchEvent(new Event('load'));
-				},
-				(error) => {
-					internal.complete = false;
-					this.dispatchEvent(new ErrorEvent('error', { error }));
-				},
-			);
+		internal.controller?.abort();
+		const controller = new AbortController();
+		const { signal } = controller;
+		internal.controller = controller;
+
+		// A cached image is available immediately (unless its key needs
+		// to be looked up first), but the `load` event is still
+		// dispatched asynchronously
+		const key = imageCacheKey(url, signal);
+		let cacheKey = typeof key === 'string' ? key : undefined;
+		const cached = cacheKey !== undefined && $.imageCacheGet(this, cacheKey);
+		internal.complete = cached;
+		const load = cached
+			? Promise.resolve(true)
+			: (async () => {
+					if (key instanceof Promise) {
+						cacheKey = await key;
+						if (signal.aborted) return false;
+						if (cacheKey !== undefined && $.imageCacheGet(this, cacheKey)) {
+							return true;
+						}
+					}
+					const res = await fetch(url);
+					if (!res.ok) {
+						throw new Error(`Failed to load image: ${res.status}`);
+					}
+					if (!res.body) {
+						throw new Error('Failed to load image: empty response');
+					}
+					await decodeStream(this, res.body, signal);
+					return false;
+				})();
+		load.then(
+			(hit) => {
+				// A newer `src` has superseded this load
+				if (signal.aborted) return;
+				if (!hit && cacheKey !== undefined) $.imageCachePut(this, cacheKey);
+				internal.controller = undefined;
+				internal.complete = true;
+				this.dispatchEvent(new Event('load'));
+			},
+			(error) => {
+				if (signal.aborted) return;
+				internal.controller = undefined;
+				internal.complete = false;
+				this.dispatchEvent(new ErrorEvent('error', { error }));
+			},
+		);
 	}
 
 	// Compat with HTML DOM interface
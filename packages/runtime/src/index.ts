@@ -5,7 +5,6 @@ import {
 	setInterval,
 	clearTimeout,
 	clearInterval,
-	processTimers,
 } from './timers';
 import { callRafCallbacks } from './raf';
 import { console } from './console';
@@ -154,6 +153,7 @@ export type * from './ambientlightsensor';
 
 import { dispatchTouchEvents } from './touchscreen';
 import { dispatchKeyboardEvents } from './keyboard';
+import { updatePerformanceOverlay } from './switch/performance';
 
 $.onError((e) => {
 	const ev = new ErrorEvent('error', {
@@ -184,7 +184,6 @@ const btnPlus = 1 << 10; ///< Plus button
 let previousButtons = 0;
 
 $.onFrame((kDown) => {
-	processTimers();
 	callRafCallbacks();
 
 	const buttonsDown = ~previousButtons & kDown;
@@ -212,6 +211,8 @@ $.onFrame((kDown) => {
 
 	dispatchKeyboardEvents(globalThis);
 	dispatchTouchEvents(screen);
+
+	updatePerformanceOverlay();
 });
 
 $.onExit(() => {
@@ -7,6 +7,7 @@ export type Opaque<T> = { __type: T };
 export type WasmModuleOpaque = Opaque<'WasmModuleOpaque'>;
 export type WasmInstanceOpaque = Opaque<'WasmInstanceOpaque'>;
 export type WasmGlobalOpaque = Opaque<'WasmGlobalOpaque'>;
+export type TimerOpaque = Opaque<'TimerOpaque'>;
 
 export type Callback<T> = (err: Error | null, result: T) => void;
 
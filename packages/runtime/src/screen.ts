@@ -5,6 +5,7 @@ import { INTERNAL_SYMBOL } from './internal';
 import { CanvasRenderingContext2D } from './canvas/canvas-rendering-context-2d';
 import { initTouchscreen } from './touchscreen';
 import type { TouchEvent } from './polyfills/event';
+import type { OffscreenCanvas } from './canvas/offscreen-canvas';
 
 interface ScreenInternal {
 	context2d?: CanvasRenderingContext2D;
@@ -64,6 +65,25 @@ export class Screen extends EventTarget implements globalThis.Screen {
 	 */
 	declare readonly height: number;
 
+	/**
+	 * Returns a `Uint32Array` which directly aliases the pixel buffer of the
+	 * screen. The modified pixels are displayed on the next frame after the
+	 * view has been released.
+	 *
+	 * @see {@link OffscreenCanvas.getPixelView | `OffscreenCanvas.getPixelView()`}
+	 */
+	getPixelView(): Uint32Array {
+		return new Uint32Array($.canvasGetPixelView(this));
+	}
+
+	/**
+	 * Marks the pixels of the screen as modified, and detaches a view that
+	 * was returned from {@link getPixelView | `getPixelView()`}.
+	 */
+	releasePixelView(view: Uint32Array) {
+		$.canvasReleasePixelView(this, view.buffer);
+	}
+
 	getContext(contextId: '2d'): CanvasRenderingContext2D {
 		if (contextId !== '2d') {
 			throw new TypeError('Only "2d" rendering context is supported');
@@ -21,6 +21,18 @@ export * from './switch/ns';
 export * from './switch/irsensor';
 export * from './switch/profile';
 export * from './switch/album';
+export { FramePerformance, performance } from './switch/performance';
+export { DrawCommandBuffer } from './switch/draw-command-buffer';
+export type { DrawCommandBufferFlushOptions } from './switch/draw-command-buffer';
+export { decodeImages } from './canvas/image-bitmap';
+export type { DecodeImagesOptions } from './canvas/image-bitmap';
+export type {
+	FrameTimings,
+	FrameTimingStats,
+	GlyphAtlasStats,
+	GlyphCacheStats,
+	ImageCacheStats,
+} from './switch/performance';
 export { Socket, Server };
 
 export type PathLike = string | URL;
@@ -0,0 +1,508 @@
+import colorRgba = require('color-rgba');
+import { $ } from '../$';
+import { createInternal } from '../utils';
+import type { CanvasImageSource } from '../types';
+import type { CanvasRenderingContext2D } from '../canvas/canvas-rendering-context-2d';
+import type { OffscreenCanvasRenderingContext2D } from '../canvas/offscreen-canvas-rendering-context-2d';
+
+// Keep in sync with `draw_command_t` in `source/canvas.c`
+enum Command {
+	Save,
+	Restore,
+	BeginPath,
+	ClosePath,
+	MoveTo,
+	LineTo,
+	BezierCurveTo,
+	QuadraticCurveTo,
+	Arc,
+	Rect,
+	Fill,
+	Stroke,
+	FillRect,
+	StrokeRect,
+	ClearRect,
+	Translate,
+	Rotate,
+	Scale,
+	Transform,
+	SetTransform,
+	ResetTransform,
+	SetGlobalAlpha,
+	SetFillColor,
+	SetStrokeColor,
+	SetLineWidth,
+	DrawImage,
+	DrawImageScaled,
+	DrawImageSubrect,
+}
+
+interface DrawCommandBufferInternal {
+	data: Float64Array;
+	length: number;
+	images: CanvasImageSource[];
+	imageIndices: Map<CanvasImageSource, number>;
+}
+
+const _ = createInternal<DrawCommandBuffer, DrawCommandBufferInternal>();
+
+// Returns the offset in the buffer to write a command with `count` values (including the opcode) to
+function reserve(i: DrawCommandBufferInternal, count: number) {
+	const offset = i.length;
+	if (offset + count > i.data.length) {
+		const data = new Float64Array(
+			Math.max(i.data.length * 2, offset + count),
+		);
+		data.set(i.data.subarray(0, offset));
+		i.data = data;
+	}
+	i.length = offset + count;
+	return offset;
+}
+
+function imageIndex(i: DrawCommandBufferInternal, image: CanvasImageSource) {
+	let index = i.imageIndices.get(image);
+	if (typeof index === 'undefined') {
+		index = i.images.push(image) - 1;
+		i.imageIndices.set(image, index);
+	}
+	return index;
+}
+
+function writeRect(
+	i: DrawCommandBufferInternal,
+	command: Command,
+	x: number,
+	y: number,
+	width: number,
+	height: number,
+) {
+	const o = reserve(i, 5);
+	const d = i.data;
+	d[o] = command;
+	d[o + 1] = x;
+	d[o + 2] = y;
+	d[o + 3] = width;
+	d[o + 4] = height;
+}
+
+function writeMatrix(
+	i: DrawCommandBufferInternal,
+	command: Command,
+	a: number,
+	b: number,
+	c: number,
+	d: number,
+	e: number,
+	f: number,
+) {
+	const o = reserve(i, 7);
+	const data = i.data;
+	data[o] = command;
+	data[o + 1] = a;
+	data[o + 2] = b;
+	data[o + 3] = c;
+	data[o + 4] = d;
+	data[o + 5] = e;
+	data[o + 6] = f;
+}
+
+function writeColor(
+	i: DrawCommandBufferInternal,
+	command: Command,
+	color: string,
+) {
+	const parsed = colorRgba(color);
+	if (!parsed || parsed.length !== 4) {
+		return;
+	}
+	const o = reserve(i, 5);
+	const d = i.data;
+	d[o] = command;
+	d[o + 1] = parsed[0];
+	d[o + 2] = parsed[1];
+	d[o + 3] = parsed[2];
+	d[o + 4] = parsed[3];
+}
+
+export interface DrawCommandBufferFlushOptions {
+	/**
+	 * Splits the canvas into horizontal bands, and draws the commands in
+	 * every band in parallel on the thread pool. This is intended for
+	 * generating large images (i.e. map tiles or collages) on an
+	 * `OffscreenCanvas`, where drawing is limited by a single CPU core.
+	 *
+	 * Every band replays all of the commands, so this only pays off when
+	 * the commands are expensive to rasterize compared to recording them.
+	 * The commands are executed normally (on the calling thread) if the
+	 * canvas is too small to split, the clip is not made of rectangles,
+	 * the canvas draws itself, or the commands `restore()` state which
+	 * was saved before they were recorded.
+	 *
+	 * @default false
+	 */
+	tiled?: boolean;
+}
+
+/**
+ * Records canvas drawing operations into a `Float64Array` so that they
+ * can be executed on a 2D rendering context with a single native call.
+ *
+ * Every method of a `CanvasRenderingContext2D` is a separate call into
+ * native code, which converts and validates its arguments each time. When
+ * drawing thousands of shapes or sprites per frame (i.e. particle
+ * systems), that overhead can be larger than the cost of the drawing
+ * itself. Recording the operations is pure JavaScript, and
+ * {@link DrawCommandBuffer.flush | `flush()`} then executes the whole
+ * batch at once.
+ *
+ * The methods behave the same as the context methods of the same name.
+ * Colors are parsed when they are recorded, so reusing the same color
+ * string in a loop is cheap.
+ *
+ * @example
+ *
+ * ```typescript
+ * const ctx = screen.getContext('2d');
+ * const commands = new Switch.DrawCommandBuffer();
+ *
+ * function draw() {
+ *   commands.clearRect(0, 0, screen.width, screen.height);
+ *   for (const p of particles) {
+ *     commands.drawImage(sprite, p.x, p.y);
+ *   }
+ *   commands.flush(ctx);
+ *   requestAnimationFrame(draw);
+ * }
+ * ```
+ */
+export class DrawCommandBuffer {
+	/**
+	 * @param capacity Initial number of values (opcodes and arguments) that the buffer can hold before it needs to grow.
+	 */
+	constructor(capacity = 4096) {
+		_.set(this, {
+			data: new Float64Array(Math.max(capacity, 16)),
+			length: 0,
+			images: [],
+			imageIndices: new Map(),
+		});
+	}
+
+	/**
+	 * Number of values (opcodes and arguments) currently recorded.
+	 */
+	get length(): number {
+		return _(this).length;
+	}
+
+	/**
+	 * Executes the recorded commands on `ctx`, and then clears the buffer.
+	 * All drawing has completed by the time this method returns.
+	 *
+	 * If a command is invalid (i.e. a negative `arc()` radius), then an
+	 * error is thrown without drawing anything, and the buffer is still
+	 * cleared.
+	 */
+	flush(
+		ctx: CanvasRenderingContext2D | OffscreenCanvasRenderingContext2D,
+		options?: DrawCommandBufferFlushOptions,
+	) {
+		const i = _(this);
+		try {
+			$.canvasContext2dFlushCommands(
+				ctx,
+				i.data.buffer,
+				i.length,
+				i.images,
+				options?.tiled ?? false,
+			);
+		} finally {
+			this.reset();
+		}
+	}
+
+	/**
+	 * Discards the recorded commands without executing them.
+	 */
+	reset() {
+		const i = _(this);
+		i.length = 0;
+		if (i.images.length) {
+			i.images = [];
+			i.imageIndices.clear();
+		}
+	}
+
+	save() {
+		const i = _(this);
+		i.data[reserve(i, 1)] = Command.Save;
+	}
+
+	restore() {
+		const i = _(this);
+		i.data[reserve(i, 1)] = Command.Restore;
+	}
+
+	beginPath() {
+		const i = _(this);
+		i.data[reserve(i, 1)] = Command.BeginPath;
+	}
+
+	closePath() {
+		const i = _(this);
+		i.data[reserve(i, 1)] = Command.ClosePath;
+	}
+
+	moveTo(x: number, y: number) {
+		const i = _(this);
+		const o = reserve(i, 3);
+		const d = i.data;
+		d[o] = Command.MoveTo;
+		d[o + 1] = x;
+		d[o + 2] = y;
+	}
+
+	lineTo(x: number, y: number) {
+		const i = _(this);
+		const o = reserve(i, 3);
+		const d = i.data;
+		d[o] = Command.LineTo;
+		d[o + 1] = x;
+		d[o + 2] = y;
+	}
+
+	bezierCurveTo(
+		cp1x: number,
+		cp1y: number,
+		cp2x: number,
+		cp2y: number,
+		x: number,
+		y: number,
+	) {
+		const i = _(this);
+		const o = reserve(i, 7);
+		const d = i.data;
+		d[o] = Command.BezierCurveTo;
+		d[o + 1] = cp1x;
+		d[o + 2] = cp1y;
+		d[o + 3] = cp2x;
+		d[o + 4] = cp2y;
+		d[o + 5] = x;
+		d[o + 6] = y;
+	}
+
+	quadraticCurveTo(cpx: number, cpy: number, x: number, y: number) {
+		const i = _(this);
+		const o = reserve(i, 5);
+		const d = i.data;
+		d[o] = Command.QuadraticCurveTo;
+		d[o + 1] = cpx;
+		d[o + 2] = cpy;
+		d[o + 3] = x;
+		d[o + 4] = y;
+	}
+
+	arc(
+		x: number,
+		y: number,
+		radius: number,
+		startAngle: number,
+		endAngle: number,
+		counterclockwise = false,
+	) {
+		const i = _(this);
+		const o = reserve(i, 7);
+		const d = i.data;
+		d[o] = Command.Arc;
+		d[o + 1] = x;
+		d[o + 2] = y;
+		d[o + 3] = radius;
+		d[o + 4] = startAngle;
+		d[o + 5] = endAngle;
+		d[o + 6] = counterclockwise ? 1 : 0;
+	}
+
+	rect(x: number, y: number, width: number, height: number) {
+		writeRect(_(this), Command.Rect, x, y, width, height);
+	}
+
+	/**
+	 * Fills the current path with the current fill color.
+	 */
+	fill() {
+		const i = _(this);
+		i.data[reserve(i, 1)] = Command.Fill;
+	}
+
+	/**
+	 * Strokes the current path with the current stroke color.
+	 */
+	stroke() {
+		const i = _(this);
+		i.data[reserve(i, 1)] = Command.Stroke;
+	}
+
+	fillRect(x: number, y: number, width: number, height: number) {
+		writeRect(_(this), Command.FillRect, x, y, width, height);
+	}
+
+	strokeRect(x: number, y: number, width: number, height: number) {
+		writeRect(_(this), Command.StrokeRect, x, y, width, height);
+	}
+
+	clearRect(x: number, y: number, width: number, height: number) {
+		writeRect(_(this), Command.ClearRect, x, y, width, height);
+	}
+
+	translate(x: number, y: number) {
+		const i = _(this);
+		const o = reserve(i, 3);
+		const d = i.data;
+		d[o] = Command.Translate;
+		d[o + 1] = x;
+		d[o + 2] = y;
+	}
+
+	rotate(angle: number) {
+		const i = _(this);
+		const o = reserve(i, 2);
+		i.data[o] = Command.Rotate;
+		i.data[o + 1] = angle;
+	}
+
+	scale(x: number, y: number) {
+		const i = _(this);
+		const o = reserve(i, 3);
+		const d = i.data;
+		d[o] = Command.Scale;
+		d[o + 1] = x;
+		d[o + 2] = y;
+	}
+
+	transform(a: number, b: number, c: number, d: number, e: number, f: number) {
+		writeMatrix(_(this), Command.Transform, a, b, c, d, e, f);
+	}
+
+	setTransform(
+		a: number,
+		b: number,
+		c: number,
+		d: number,
+		e: number,
+		f: number,
+	) {
+		writeMatrix(_(this), Command.SetTransform, a, b, c, d, e, f);
+	}
+
+	resetTransform() {
+		const i = _(this);
+		i.data[reserve(i, 1)] = Command.ResetTransform;
+	}
+
+	/**
+	 * Sets the `globalAlpha` of the context.
+	 */
+	setGlobalAlpha(alpha: number) {
+		const i = _(this);
+		const o = reserve(i, 2);
+		i.data[o] = Command.SetGlobalAlpha;
+		i.data[o + 1] = alpha;
+	}
+
+	/**
+	 * Sets the `fillStyle` of the context to a CSS color. Invalid colors are ignored.
+	 */
+	setFillStyle(color: string) {
+		writeColor(_(this), Command.SetFillColor, color);
+	}
+
+	/**
+	 * Sets the `strokeStyle` of the context to a CSS color. Invalid colors are ignored.
+	 */
+	setStrokeStyle(color: string) {
+		writeColor(_(this), Command.SetStrokeColor, color);
+	}
+
+	/**
+	 * Sets the `lineWidth` of the context.
+	 */
+	setLineWidth(width: number) {
+		const i = _(this);
+		const o = reserve(i, 2);
+		i.data[o] = Command.SetLineWidth;
+		i.data[o + 1] = width;
+	}
+
+	drawImage(image: CanvasImageSource, dx: number, dy: number): void;
+	drawImage(
+		image: CanvasImageSource,
+		dx: number,
+		dy: number,
+		dWidth: number,
+		dHeight: number,
+	): void;
+	drawImage(
+		image: CanvasImageSource,
+		sx: number,
+		sy: number,
+		sWidth: number,
+		sHeight: number,
+		dx: number,
+		dy: number,
+		dWidth: number,
+		dHeight: number,
+	): void;
+	drawImage(
+		image: CanvasImageSource,
+		dxOrSx: number,
+		dyOrSy: number,
+		dwOrSw?: number,
+		dhOrSh?: number,
+		dx?: number,
+		dy?: number,
+		dw?: number,
+		dh?: number,
+	): void {
+		const i = _(this);
+		const index = imageIndex(i, image);
+		let o: number;
+		let d: Float64Array;
+		switch (arguments.length) {
+			case 3:
+				o = reserve(i, 4);
+				d = i.data;
+				d[o] = Command.DrawImage;
+				d[o + 1] = index;
+				d[o + 2] = dxOrSx;
+				d[o + 3] = dyOrSy;
+				break;
+			case 5:
+				o = reserve(i, 6);
+				d = i.data;
+				d[o] = Command.DrawImageScaled;
+				d[o + 1] = index;
+				d[o + 2] = dxOrSx;
+				d[o + 3] = dyOrSy;
+				d[o + 4] = dwOrSw!;
+				d[o + 5] = dhOrSh!;
+				break;
+			case 9:
+				o = reserve(i, 10);
+				d = i.data;
+				d[o] = Command.DrawImageSubrect;
+				d[o + 1] = index;
+				d[o + 2] = dxOrSx;
+				d[o + 3] = dyOrSy;
+				d[o + 4] = dwOrSw!;
+				d[o + 5] = dhOrSh!;
+				d[o + 6] = dx!;
+				d[o + 7] = dy!;
+				d[o + 8] = dw!;
+				d[o + 9] = dh!;
+				break;
+			default:
+				throw new TypeError('Invalid arguments');
+		}
+	}
+}
@@ -0,0 +1,351 @@
+import { $ } from '../$';
+import { screen } from '../screen';
+import { OffscreenCanvas } from '../canvas/offscreen-canvas';
+
+/**
+ * Statistics of one measurement over the most recent frames.
+ * All values are in milliseconds.
+ */
+export interface FrameTimingStats {
+	/**
+	 * Value for the most recently completed frame.
+	 */
+	last: number;
+	mean: number;
+	p50: number;
+	p95: number;
+	p99: number;
+	max: number;
+}
+
+/**
+ * Timing statistics of the most recent frames (up to 240 frames),
+ * with a breakdown of the phases of each iteration of the event loop.
+ */
+export interface FrameTimings {
+	/**
+	 * Total number of frames since the application started.
+	 */
+	frames: number;
+	/**
+	 * Time between the end of each frame and the end of the previous frame.
+	 */
+	interval: FrameTimingStats;
+	/**
+	 * Time spent doing work during each frame, which is the sum of
+	 * every phase except for `poll`.
+	 */
+	busy: FrameTimingStats;
+	/**
+	 * Time spent waiting for and handling file descriptor (network)
+	 * activity. This includes the time spent idle waiting for the next frame.
+	 */
+	poll: FrameTimingStats;
+	/**
+	 * Time spent invoking `setTimeout()` / `setInterval()` callbacks.
+	 */
+	timers: FrameTimingStats;
+	/**
+	 * Time spent resolving completed asynchronous operations
+	 * (file system reads, image decoding, etc.).
+	 */
+	async: FrameTimingStats;
+	/**
+	 * Time spent running Promise reactions (microtasks).
+	 */
+	jobs: FrameTimingStats;
+	/**
+	 * Time spent in the frame handler, which runs the
+	 * `requestAnimationFrame()` callbacks and dispatches input events.
+	 */
+	handler: FrameTimingStats;
+	/**
+	 * Time spent sending the frame to the display.
+	 */
+	present: FrameTimingStats;
+}
+
+/**
+ * Statistics of the cache of shaped text, which is shared by
+ * `fillText()`, `strokeText()` and `measureText()`.
+ */
+export interface GlyphCacheStats {
+	/**
+	 * Number of times the shaped glyphs of a string were found in the cache.
+	 */
+	hits: number;
+	/**
+	 * Number of times a string had to be shaped.
+	 */
+	misses: number;
+	/**
+	 * Number of shaped strings currently in the cache.
+	 */
+	entries: number;
+	/**
+	 * Total size (in bytes) of the shaped strings in the cache.
+	 */
+	bytes: number;
+	/**
+	 * Maximum total size (in bytes) of the cache.
+	 */
+	limit: number;
+}
+
+/**
+ * Statistics of the glyph atlas, which is used to draw text when
+ * the `textRendering` of a context is set to `"optimizeSpeed"`.
+ */
+export interface GlyphAtlasStats {
+	/**
+	 * Number of glyphs which were drawn from the atlas.
+	 */
+	hits: number;
+	/**
+	 * Number of glyphs which had to be rasterized into the atlas.
+	 */
+	misses: number;
+	/**
+	 * Number of glyphs currently in the atlas.
+	 */
+	glyphs: number;
+	/**
+	 * Number of times the atlas was full and had to be cleared.
+	 */
+	resets: number;
+}
+
+/**
+ * Statistics of the cache of decoded images, which is used
+ * when setting the `src` of an `Image`.
+ */
+export interface ImageCacheStats {
+	/**
+	 * Number of images which were loaded from the cache.
+	 */
+	hits: number;
+	/**
+	 * Number of images which had to be read and decoded.
+	 */
+	misses: number;
+	/**
+	 * Number of decoded images currently in the cache.
+	 */
+	entries: number;
+	/**
+	 * Total size (in bytes) of the pixels of the images in the cache.
+	 */
+	bytes: number;
+	/**
+	 * Maximum total size (in bytes) of the cache.
+	 */
+	limit: number;
+}
+
+const OVERLAY_WIDTH = 320;
+const OVERLAY_HEIGHT = 192;
+const OVERLAY_UPDATE_INTERVAL = 500;
+const OVERLAY_PHASES = [
+	'busy',
+	'poll',
+	'timers',
+	'async',
+	'jobs',
+	'handler',
+	'present',
+] as const;
+
+let frameRateCap = 60;
+let drainBudget = 8;
+let glyphCacheLimit = 1024 * 1024;
+let imageCacheLimit = 32 * 1024 * 1024;
+let overlay: OffscreenCanvas | null = null;
+let overlayUpdated = 0;
+
+/**
+ * Frame pacing and frame time instrumentation of the event loop.
+ *
+ * @example
+ *
+ * ```typescript
+ * const { interval, busy, jobs } = Switch.performance.timings();
+ * console.log(`p95 frame time: ${interval.p95}ms (busy ${busy.p95}ms)`);
+ * if (jobs.max > 8) console.log('Promise jobs caused a long frame');
+ * ```
+ */
+export class FramePerformance {
+	/**
+	 * Returns timing statistics for the most recent frames.
+	 */
+	timings(): FrameTimings {
+		return $.frameTimings();
+	}
+
+	/**
+	 * The maximum number of frames per second. Set to `0` or
+	 * `Infinity` to run frames as fast as possible, which is then
+	 * limited by the display's vsync while drawing. Frames which
+	 * draw nothing still wait for the display's refresh interval.
+	 *
+	 * @default 60
+	 */
+	get frameRateCap() {
+		return frameRateCap;
+	}
+
+	set frameRateCap(fps: number) {
+		$.frameSetRateCap(fps);
+		frameRateCap = fps;
+	}
+
+	/**
+	 * The maximum time (in milliseconds) spent resolving completed
+	 * asynchronous operations, and the maximum time spent running Promise
+	 * jobs (microtasks), in each iteration of the event loop. Work that
+	 * does not fit is continued in the next iteration, and draining also
+	 * stops early when the next frame is due, so that a burst of Promise
+	 * resolutions does not cause dropped frames.
+	 *
+	 * Set to `Infinity` to always drain everything before the next frame.
+	 *
+	 * @default 8
+	 */
+	get drainBudget() {
+		return drainBudget;
+	}
+
+	set drainBudget(ms: number) {
+		$.frameSetDrainBudget(ms);
+		drainBudget = ms;
+	}
+
+	/**
+	 * Returns the statistics of the cache of shaped text.
+	 */
+	glyphCache(): GlyphCacheStats {
+		return $.glyphCacheStats();
+	}
+
+	/**
+	 * Returns the statistics of the glyph atlas.
+	 */
+	glyphAtlas(): GlyphAtlasStats {
+		return $.glyphAtlasStats();
+	}
+
+	/**
+	 * The maximum total size (in bytes) of the cache of shaped text.
+	 * When the limit is exceeded, the least recently drawn strings are
+	 * evicted.
+	 *
+	 * @default 1048576
+	 */
+	get glyphCacheLimit() {
+		return glyphCacheLimit;
+	}
+
+	set glyphCacheLimit(bytes: number) {
+		$.glyphCacheSetLimit(bytes);
+		glyphCacheLimit = bytes;
+	}
+
+	/**
+	 * Returns the statistics of the cache of decoded images.
+	 */
+	imageCache(): ImageCacheStats {
+		return $.imageCacheStats();
+	}
+
+	/**
+	 * The maximum total size (in bytes) of the cache of decoded images.
+	 * When the limit is exceeded, the least recently loaded images are
+	 * evicted. Images which are still in use keep their pixels after
+	 * being evicted, so this does not limit the memory of the images
+	 * which the application holds on to. Set to `0` to disable the cache.
+	 *
+	 * @default 33554432
+	 */
+	get imageCacheLimit() {
+		return imageCacheLimit;
+	}
+
+	set imageCacheLimit(bytes: number) {
+		$.imageCacheSetLimit(bytes);
+		imageCacheLimit = bytes;
+	}
+
+	/**
+	 * Removes every image from the cache of decoded images, so that the
+	 * next load of each URL reads the image again (i.e. after the file
+	 * has been modified).
+	 */
+	clearImageCache() {
+		$.imageCacheClear();
+	}
+
+	/**
+	 * When `true`, an overlay with the frame rate and the frame time
+	 * breakdown is shown in the top-right corner of the screen.
+	 *
+	 * The overlay is composited when presenting the frame, so it does
+	 * not modify the pixels of the `screen` canvas. Enabling the overlay
+	 * switches the screen to canvas rendering mode.
+	 *
+	 * @default false
+	 */
+	get overlay() {
+		return overlay !== null;
+	}
+
+	set overlay(enabled: boolean) {
+		if (enabled === this.overlay) return;
+		if (enabled) {
+			screen.getContext('2d');
+			overlay = new OffscreenCanvas(OVERLAY_WIDTH, OVERLAY_HEIGHT);
+			overlayUpdated = 0;
+			$.framebufferSetOverlay(overlay, screen.width - OVERLAY_WIDTH, 0);
+		} else {
+			$.framebufferSetOverlay(null, 0, 0);
+			overlay = null;
+		}
+	}
+}
+
+export const performance = new FramePerformance();
+
+function format(n: number) {
+	return n.toFixed(1).padStart(5);
+}
+
+/**
+ * Redraws the performance overlay, at most every 500ms.
+ * Invoked at the end of the frame handler.
+ */
+export function updatePerformanceOverlay() {
+	if (!overlay) return;
+	const now = Date.now();
+	if (now - overlayUpdated < OVERLAY_UPDATE_INTERVAL) return;
+	overlayUpdated = now;
+
+	const t = $.frameTimings();
+	const ctx = overlay.getContext('2d');
+	ctx.clearRect(0, 0, OVERLAY_WIDTH, OVERLAY_HEIGHT);
+	ctx.fillStyle = 'rgba(0, 0, 0, 0.7)';
+	ctx.fillRect(0, 0, OVERLAY_WIDTH, OVERLAY_HEIGHT);
+	ctx.font = '16px system-ui';
+	ctx.fillStyle = 'white';
+
+	const fps = t.interval.mean > 0 ? 1000 / t.interval.mean : 0;
+	let y = 20;
+	ctx.fillText(`${fps.toFixed(1)} FPS`, 8, y);
+	ctx.fillText(`frame p95 ${format(t.interval.p95)} ms`, 140, y);
+	y += 24;
+	ctx.fillText('ms', 8, y);
+	ctx.fillText('  p50    p95    max', 100, y);
+	for (const phase of OVERLAY_PHASES) {
+		const s = t[phase];
+		y += 20;
+		ctx.fillText(phase, 8, y);
+		ctx.fillText(`${format(s.p50)} ${format(s.p95)} ${format(s.max)}`, 100, y);
+	}
+}
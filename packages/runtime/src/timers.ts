@@ -1,8 +1,11 @@
+import { $ } from './$';
+import type { TimerOpaque } from './internal';
+
 interface Timer {
 	args: any[];
 	callback: Function;
-	invokeAt: number;
-	interval?: number;
+	interval: boolean;
+	native: TimerOpaque;
 }
 
 /**
@@ -13,6 +16,41 @@ export type TimerHandler = string | Function;
 let nextId = 0;
 const timers = new Map<number, Timer>();
 
+// Scheduling is done natively (see `timers.c`), which invokes
+// this handler with the ID of each timer when it is due
+$.onTimer((id) => {
+	const timer = timers.get(id);
+	if (!timer) return;
+	if (!timer.interval) timers.delete(id);
+	timer.callback.apply(null, timer.args);
+});
+
+function addTimer(
+	handler: TimerHandler,
+	timeout: number,
+	args: any[],
+	interval: boolean,
+) {
+	const id = ++nextId;
+	const callback =
+		typeof handler === 'string' ? new Function(handler) : handler;
+	timers.set(id, {
+		args,
+		callback,
+		interval,
+		native: $.timerNew(id, Number(timeout), interval),
+	});
+	return id;
+}
+
+function removeTimer(id?: number) {
+	if (typeof id !== 'number') return;
+	const timer = timers.get(id);
+	if (!timer) return;
+	timers.delete(id);
+	$.timerClear(timer.native);
+}
+
 /**
  * The global `setTimeout()` method sets a timer which executes a function or specified piece of code once the timer expires.
  *
@@ -23,15 +61,7 @@ const timers = new Map<number, Timer>();
  * @returns The numeric ID of the timer, which can be used later with the {@link clearTimeout | `clearTimeout()`} method to cancel the timer.
  */
 export function setTimeout(handler: TimerHandler, timeout = 0, ...args: any[]) {
-	const id = ++nextId;
-	const callback =
-		typeof handler === 'string' ? new Function(handler) : handler;
-	timers.set(id, {
-		args,
-		callback,
-		invokeAt: Date.now() + timeout,
-	});
-	return id;
+	return addTimer(handler, timeout, args, false);
 }
 
 /**
@@ -48,16 +78,7 @@ export function setInterval(
 	timeout = 0,
 	...args: any[]
 ) {
-	const id = ++nextId;
-	const callback =
-		typeof handler === 'string' ? new Function(handler) : handler;
-	timers.set(id, {
-		args,
-		callback,
-		invokeAt: Date.now() + timeout,
-		interval: timeout,
-	});
-	return id;
+	return addTimer(handler, timeout, args, true);
 }
 
 /**
@@ -67,7 +88,7 @@ export function setInterval(
  * @param id - The ID of the timer you want to clear, as returned by {@link setTimeout | `setTimeout()`}.
  */
 export function clearTimeout(id?: number) {
-	if (typeof id === 'number') timers.delete(id);
+	removeTimer(id);
 }
 
 /**
@@ -77,19 +98,6 @@ export function clearTimeout(id?: number) {
  * @param id - The ID of the timer you want to clear, as returned by {@link setInterval | `setInterval()`}.
  */
 export function clearInterval(id?: number) {
-	if (typeof id === 'number') timers.delete(id);
+	removeTimer(id);
 }
 
-export function processTimers() {
-	const now = Date.now();
-	for (const [id, timer] of timers) {
-		if (now >= timer.invokeAt) {
-			if (typeof timer.interval === 'number') {
-				timer.invokeAt = now + timer.interval;
-			} else {
-				clearTimeout(id);
-			}
-			timer.callback.apply(null, timer.args);
-		}
-	}
-}
@@ -1,5 +1,7 @@
+import { $ } from './$';
 import type { PathLike } from './switch';
 import type { BufferSource } from './types';
+import type { AbortSignal } from './polyfills/abort-controller';
 import {
 	INTERNAL_SYMBOL,
 	type Callback,
@@ -76,6 +78,39 @@ export function toPromise<
 	});
 }
 
+/**
+ * Invokes `fn`, which must return a Promise from a native async function
+ * (one that is backed by `nx_queue_async()`), and cancels the underlying
+ * native work when `signal` is aborted. The returned Promise rejects with
+ * `signal.reason` as soon as the signal is aborted, while the native work
+ * is skipped (or finishes and releases its resources) in the background.
+ */
+export function abortable<T>(
+	signal: AbortSignal | undefined,
+	fn: () => Promise<T>,
+): Promise<T> {
+	if (!signal) return fn();
+	if (signal.aborted) return Promise.reject(signal.reason);
+	const promise = fn();
+	return new Promise<T>((resolve, reject) => {
+		const onAbort = () => {
+			$.asyncCancel(promise);
+			reject(signal.reason);
+		};
+		signal.addEventListener('abort', onAbort);
+		promise.then(
+			(value) => {
+				signal.removeEventListener('abort', onAbort);
+				resolve(value);
+			},
+			(err) => {
+				signal.removeEventListener('abort', onAbort);
+				reject(signal.aborted ? signal.reason : err);
+			},
+		);
+	});
+}
+
 export function assertInternalConstructor(a: ArrayLike<any>) {
 	if (a[0] !== INTERNAL_SYMBOL) throw new TypeError('Illegal constructor');
 }
@@ -1,101 +1,243 @@
 #include <stdlib.h>
+#include <string.h>
 #include "async.h"
 #include "error.h"
+#include "timers.h"
 
-void nx_process_async(JSContext *ctx, nx_context_t *nx_ctx)
+// Name of the (non-enumerable) property of the Promise returned by
+// `nx_queue_async()` which holds the handle of the request
+#define NX_WORK_HANDLE_PROP "nxAsyncWork"
+
+static JSClassID nx_work_handle_class_id;
+
+/**
+ * `nx_work_t` structs are allocated in slabs and recycled through a free
+ * list, and small payloads are stored inline in `data_storage`, so that
+ * queueing async work does not call `malloc()` in the steady state.
+ * Requests are only ever allocated and freed on the JS thread, so the
+ * free list does not need any synchronization.
+ */
+
+nx_work_t *nx_work_new(nx_context_t *nx_ctx)
+{
+	if (nx_ctx->free_work == NULL)
+	{
+		nx_work_slab_t *slab = malloc(sizeof(nx_work_slab_t));
+		if (slab == NULL)
+			return NULL;
+		slab->next = nx_ctx->work_slabs;
+		nx_ctx->work_slabs = slab;
+		for (int i = 0; i < NX_WORK_SLAB_SIZE; i++)
+		{
+			slab->work[i].next = nx_ctx->free_work;
+			nx_ctx->free_work = &slab->work[i];
+		}
+	}
+
+	nx_work_t *req = nx_ctx->free_work;
+	nx_ctx->free_work = req->next;
+	memset(req, 0, sizeof(nx_work_t));
+	req->data = req->data_storage;
+	atomic_init(&req->refs, 1);
+	return req;
+}
+
+void nx_work_free(nx_context_t *nx_ctx, nx_work_t *req)
+{
+	if (req->data != req->data_storage)
+		free(req->data);
+	req->next = nx_ctx->free_work;
+	nx_ctx->free_work = req;
+}
+
+void nx_work_pool_destroy(nx_context_t *nx_ctx)
+{
+	nx_work_slab_t *slab = nx_ctx->work_slabs;
+	while (slab)
+	{
+		nx_work_slab_t *next = slab->next;
+		free(slab);
+		slab = next;
+	}
+	nx_ctx->work_slabs = NULL;
+	nx_ctx->free_work = NULL;
+}
+
+static JSValue nx_new_abort_error(JSContext *ctx)
 {
+	JSValue err = JS_NewError(ctx);
+	JS_DefinePropertyValueStr(ctx, err, "name", JS_NewString(ctx, "AbortError"), JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE);
+	JS_DefinePropertyValueStr(ctx, err, "message", JS_NewString(ctx, "The operation was aborted"), JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE);
+	return err;
+}
+
+void nx_process_async(JSContext *ctx, nx_context_t *nx_ctx, u64 deadline)
+{
+	// Take ownership of all the work that has completed so far
+	nx_work_t *cur = atomic_exchange_explicit(&nx_ctx->completed_work, NULL, memory_order_acquire);
+
+	// The completed work is pushed onto a stack, so reverse it in order to
+	// resolve in the order of completion, and append it to the ready list
 	nx_work_t *prev = NULL;
-	nx_work_t *cur = nx_ctx->work_queue;
-	pthread_mutex_lock(&nx_ctx->async_done_mutex);
+	nx_work_t *tail = cur;
 	while (cur != NULL)
 	{
-		if (cur->done)
-		{
-			nx_work_t *next = cur->next;
-			JSValue result = cur->after_work_cb(ctx, cur);
-			JSValue ret_val;
-			JSValue args[1];
-			if (JS_IsException(result))
-			{
-				args[0] = JS_GetException(ctx);
-				ret_val = JS_Call(ctx, cur->reject, JS_NULL, 1, args);
-			}
-			else
-			{
-				args[0] = result;
-				ret_val = JS_Call(ctx, cur->resolve, JS_NULL, 1, args);
-			}
-			JS_FreeValue(ctx, args[0]);
-			JS_FreeValue(ctx, cur->resolve);
-			JS_FreeValue(ctx, cur->reject);
-			if (JS_IsException(ret_val))
-			{
-				nx_emit_error_event(ctx);
-			}
-			JS_FreeValue(ctx, ret_val);
-			if (cur->data)
-				free(cur->data);
-			free(cur);
+		nx_work_t *next = cur->next;
+		cur->next = prev;
+		prev = cur;
+		cur = next;
+	}
+	if (prev != NULL)
+	{
+		if (nx_ctx->ready_work_tail)
+			nx_ctx->ready_work_tail->next = prev;
+		else
+			nx_ctx->ready_work = prev;
+		nx_ctx->ready_work_tail = tail;
+	}
 
-			cur = next;
+	while ((cur = nx_ctx->ready_work) != NULL)
+	{
+		nx_ctx->ready_work = cur->next;
+		if (nx_ctx->ready_work == NULL)
+			nx_ctx->ready_work_tail = NULL;
+		JS_SetOpaque(cur->handle, NULL);
+		JS_FreeValue(ctx, cur->handle);
 
-			// remove entry from linked list
-			if (prev == NULL)
-			{
-				// at the start of the list, so reset the context pointer
-				nx_ctx->work_queue = cur;
-			}
-			else
+		// `after_work_cb` is invoked even when the work was cancelled,
+		// since it is responsible for releasing the request's resources
+		JSValue result = cur->after_work_cb(ctx, cur);
+		JSValue ret_val;
+		JSValue args[1];
+		if (nx_work_cancelled(cur))
+		{
+			if (JS_IsException(result))
 			{
-				prev->next = cur;
+				result = JS_GetException(ctx);
 			}
-
-			// If the callback threw a fatal error
-			// then don't process any more async callbacks
-			if (nx_ctx->had_error)
-				break;
+			JS_FreeValue(ctx, result);
+			args[0] = nx_new_abort_error(ctx);
+			ret_val = JS_Call(ctx, cur->reject, JS_NULL, 1, args);
+		}
+		else if (JS_IsException(result))
+		{
+			args[0] = JS_GetException(ctx);
+			ret_val = JS_Call(ctx, cur->reject, JS_NULL, 1, args);
 		}
 		else
 		{
-			prev = cur;
-			cur = cur->next;
+			args[0] = result;
+			ret_val = JS_Call(ctx, cur->resolve, JS_NULL, 1, args);
+		}
+		JS_FreeValue(ctx, args[0]);
+		JS_FreeValue(ctx, cur->resolve);
+		JS_FreeValue(ctx, cur->reject);
+		if (JS_IsException(ret_val))
+		{
+			nx_emit_error_event(ctx);
 		}
+		JS_FreeValue(ctx, ret_val);
+		nx_work_free(nx_ctx, cur);
+
+		// If the callback threw a fatal error
+		// then don't process any more async callbacks
+		if (nx_ctx->had_error)
+			break;
+
+		// Leave the rest for the next iteration of the
+		// main loop once the time budget has been used up
+		if (nx_timers_now() >= deadline)
+			break;
 	}
-	pthread_mutex_unlock(&nx_ctx->async_done_mutex);
+}
+
+void nx_work_unref(nx_work_t *req)
+{
+	if (atomic_fetch_sub_explicit(&req->refs, 1, memory_order_acq_rel) != 1)
+		return;
+
+	// Push onto the completed work stack
+	nx_context_t *nx_ctx = req->nx_ctx;
+	nx_work_t *head = atomic_load_explicit(&nx_ctx->completed_work, memory_order_relaxed);
+	do
+	{
+		req->next = head;
+	} while (!atomic_compare_exchange_weak_explicit(&nx_ctx->completed_work, &head, req,
+													memory_order_release, memory_order_relaxed));
+
+	// Interrupt the main loop if it is blocked waiting for events
+	nx_poll_wakeup(&nx_ctx->poll);
 }
 
 void nx_do_async(nx_work_t *req)
 {
-	req->work_cb(req);
-	pthread_mutex_lock(req->async_done_mutex);
-	req->done = 1;
-	pthread_mutex_unlock(req->async_done_mutex);
+	// Skip the work entirely if it was cancelled before it started
+	if (!nx_work_cancelled(req))
+	{
+		req->work_cb(req);
+	}
+	nx_work_unref(req);
 }
 
 JSValue nx_queue_async(JSContext *ctx, nx_work_t *req, nx_work_cb work_cb, nx_after_work_cb after_work_cb)
 {
 	JSValue promise, resolving_funcs[2];
 	promise = JS_NewPromiseCapability(ctx, resolving_funcs);
-	req->done = 0;
 	req->resolve = resolving_funcs[0];
 	req->reject = resolving_funcs[1];
 	req->work_cb = work_cb;
 	req->after_work_cb = after_work_cb;
+	req->nx_ctx = JS_GetContextOpaque(ctx);
+	atomic_init(&req->cancelled, false);
 
-	// Add to linked list
-	nx_context_t *nx_ctx = JS_GetContextOpaque(ctx);
-	pthread_mutex_lock(&nx_ctx->async_done_mutex);
-	if (nx_ctx->work_queue)
-	{
-		req->next = nx_ctx->work_queue;
-	}
-	nx_ctx->work_queue = req;
-	pthread_mutex_unlock(&nx_ctx->async_done_mutex);
+	// The Promise keeps the handle alive, and the request holds
+	// its own reference until it has completed
+	req->handle = JS_NewObjectClass(ctx, nx_work_handle_class_id);
+	JS_SetOpaque(req->handle, req);
+	JS_DefinePropertyValueStr(ctx, promise, NX_WORK_HANDLE_PROP, JS_DupValue(ctx, req->handle), 0);
 
-	if (thpool_add_work(nx_ctx->thpool, (void (*)(void *))nx_do_async, req) != 0)
+	req->job.fn = (void (*)(void *))nx_do_async;
+	req->job.arg = req;
+
+	if (nx_thread_pool_add_work(req->nx_ctx->thpool, &req->job, req->priority) != 0)
 	{
 		// TODO: throw exception / clean up
 	}
 
 	return promise;
 }
+
+static JSValue nx_async_cancel(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	if (!JS_IsObject(argv[0]))
+	{
+		return JS_FALSE;
+	}
+	JSValue handle = JS_GetPropertyStr(ctx, argv[0], NX_WORK_HANDLE_PROP);
+	nx_work_t *req = JS_GetOpaque(handle, nx_work_handle_class_id);
+	JS_FreeValue(ctx, handle);
+	if (!req)
+	{
+		// Not a native Promise, or the request has already completed
+		return JS_FALSE;
+	}
+	atomic_store_explicit(&req->cancelled, true, memory_order_relaxed);
+	return JS_TRUE;
+}
+
+static const JSCFunctionListEntry function_list[] = {
+	JS_CFUNC_DEF("asyncCancel", 1, nx_async_cancel),
+};
+
+void nx_init_async(JSContext *ctx, JSValueConst init_obj)
+{
+	JSRuntime *rt = JS_GetRuntime(ctx);
+
+	JS_NewClassID(rt, &nx_work_handle_class_id);
+	JSClassDef work_handle_class = {
+		"AsyncWork",
+	};
+	JS_NewClass(rt, nx_work_handle_class_id, &work_handle_class);
+
+	JS_SetPropertyFunctionList(ctx, init_obj, function_list, countof(function_list));
+}
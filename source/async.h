@@ -1,12 +1,44 @@
 #pragma once
 #include "types.h"
 
-#define NX_INIT_WORK_T(type)                    \
-	nx_work_t *req = malloc(sizeof(nx_work_t)); \
-	memset(req, 0, sizeof(nx_work_t));          \
-	type *data = malloc(sizeof(type));          \
-	memset(data, 0, sizeof(type));              \
-	req->data = data;
-
-void nx_process_async(JSContext *ctx, nx_context_t *nx_ctx);
+#define NX_INIT_WORK_T(type)                                   \
+	nx_work_t *req = nx_work_new(JS_GetContextOpaque(ctx));    \
+	if (!req)                                                  \
+		return JS_ThrowOutOfMemory(ctx);                       \
+	if (sizeof(type) > NX_WORK_DATA_SIZE)                      \
+	{                                                          \
+		req->data = calloc(1, sizeof(type));                   \
+		if (!req->data)                                        \
+		{                                                      \
+			nx_work_free(JS_GetContextOpaque(ctx), req);       \
+			return JS_ThrowOutOfMemory(ctx);                   \
+		}                                                      \
+	}                                                          \
+	type *data = req->data;
+
+nx_work_t *nx_work_new(nx_context_t *nx_ctx);
+void nx_work_free(nx_context_t *nx_ctx, nx_work_t *req);
+void nx_work_pool_destroy(nx_context_t *nx_ctx);
+// Returns `true` if the request has been cancelled from JS. Long running
+// work callbacks should check this periodically and bail out early.
+static inline bool nx_work_cancelled(nx_work_t *req)
+{
+	return atomic_load_explicit(&req->cancelled, memory_order_relaxed);
+}
+
+// Takes a reference on `req` for a job which works on the request alongside
+// its work callback, so that the request only completes once that job has
+// dropped the reference with `nx_work_unref()`. Must be called on the JS
+// thread before the request is queued.
+static inline void nx_work_ref(nx_work_t *req)
+{
+	atomic_fetch_add_explicit(&req->refs, 1, memory_order_relaxed);
+}
+
+void nx_work_unref(nx_work_t *req);
+
+// Resolves completed work until there is none left, or until `deadline`
+// has passed, in which case the rest is resolved on the next call
+void nx_process_async(JSContext *ctx, nx_context_t *nx_ctx, u64 deadline);
 JSValue nx_queue_async(JSContext *ctx, nx_work_t *req, nx_work_cb work_cb, nx_after_work_cb after_work_cb);
+void nx_init_async(JSContext *ctx, JSValueConst init_obj);
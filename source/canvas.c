@@ -7,8 +7,12 @@
 #include <math.h>
 #include "dommatrix.h"
 #include "font.h"
+#include "glyph-atlas.h"
+#include "glyph-cache.h"
 #include "image.h"
 #include "canvas.h"
+#include "path2d.h"
+#include "pixels.h"
 
 #define CANVAS_CONTEXT_ARGV0                                                                   \
 	nx_canvas_context_2d_t *context = JS_GetOpaque2(ctx, argv[0], nx_canvas_context_class_id); \
@@ -28,6 +32,23 @@
 	cairo_t *cr = context->ctx;                                                                 \
 	(void)cr;
 
+// For the methods which draw to the canvas, which is not allowed
+// while a view returned by `getPixelView()` is still live
+#define CANVAS_CONTEXT_DRAWABLE                                                                 \
+	if (context->canvas->pixel_view)                                                            \
+	{                                                                                           \
+		return JS_ThrowTypeError(ctx, "Can not draw while a pixel view of the canvas is live"); \
+	}
+
+// For the `CanvasPath` methods, which are shared by
+// `CanvasRenderingContext2D` and `Path2D`
+#define CANVAS_PATH_THIS                           \
+	cairo_t *cr = get_path_target(ctx, this_val); \
+	if (!cr)                                       \
+	{                                              \
+		return JS_EXCEPTION;                       \
+	}
+
 #define RECT_ARGS                                        \
 	double args[4];                                      \
 	if (js_validate_doubles_args(ctx, argv, args, 4, 0)) \
@@ -53,6 +74,11 @@ static inline int min(int a, int b)
 	return a < b ? a : b;
 }
 
+static inline int max(int a, int b)
+{
+	return a > b ? a : b;
+}
+
 static inline float minf(float a, float b)
 {
 	return a < b ? a : b;
@@ -81,6 +107,133 @@ static int js_validate_doubles_args(JSContext *ctx, JSValueConst *argv, double *
 	return result;
 }
 
+static inline int64_t rect_area(const nx_rect_t *r)
+{
+	return (int64_t)(r->x2 - r->x1) * (r->y2 - r->y1);
+}
+
+static inline void rect_union(nx_rect_t *dst, const nx_rect_t *src)
+{
+	dst->x1 = min(dst->x1, src->x1);
+	dst->y1 = min(dst->y1, src->y1);
+	dst->x2 = max(dst->x2, src->x2);
+	dst->y2 = max(dst->y2, src->y2);
+}
+
+void nx_damage_add(nx_damage_t *damage, const nx_rect_t *rect)
+{
+	uint32_t best = 0;
+	int64_t best_growth = INT64_MAX;
+	for (uint32_t i = 0; i < damage->count; i++)
+	{
+		nx_rect_t *r = &damage->rects[i];
+		if (rect->x1 <= r->x2 && rect->x2 >= r->x1 && rect->y1 <= r->y2 && rect->y2 >= r->y1)
+		{
+			// Overlaps or touches an existing rectangle, so grow that one
+			rect_union(r, rect);
+			return;
+		}
+		nx_rect_t u = *r;
+		rect_union(&u, rect);
+		int64_t growth = rect_area(&u) - rect_area(r);
+		if (growth < best_growth)
+		{
+			best = i;
+			best_growth = growth;
+		}
+	}
+
+	if (damage->count < NX_DAMAGE_MAX_RECTS)
+	{
+		damage->rects[damage->count++] = *rect;
+	}
+	else
+	{
+		// Out of slots, so merge into the rectangle which grows the least
+		rect_union(&damage->rects[best], rect);
+	}
+}
+
+void nx_canvas_damage(nx_canvas_t *canvas, int32_t x, int32_t y, int32_t width, int32_t height)
+{
+	nx_rect_t rect = {
+		.x1 = max(x, 0),
+		.y1 = max(y, 0),
+		.x2 = min(x + width, canvas->width),
+		.y2 = min(y + height, canvas->height),
+	};
+	if (rect.x2 <= rect.x1 || rect.y2 <= rect.y1)
+		return;
+	nx_damage_add(&canvas->damage, &rect);
+}
+
+static bool is_unbounded_operator(cairo_operator_t op)
+{
+	// These operators also modify the destination
+	// outside of the shape that is being drawn
+	return op == CAIRO_OPERATOR_IN ||
+		   op == CAIRO_OPERATOR_OUT ||
+		   op == CAIRO_OPERATOR_DEST_IN ||
+		   op == CAIRO_OPERATOR_DEST_ATOP;
+}
+
+/**
+ * Marks the area that will be modified by drawing within the
+ * given user space rectangle (under the current transform,
+ * clip and composite operation) as damaged on the canvas.
+ */
+static void damage_user_rect(nx_canvas_context_2d_t *context, double x1, double y1, double x2, double y2)
+{
+	cairo_t *cr = context->ctx;
+	nx_canvas_t *canvas = context->canvas;
+	double cx1, cy1, cx2, cy2;
+	cairo_clip_extents(cr, &cx1, &cy1, &cx2, &cy2);
+	if (is_unbounded_operator(cairo_get_operator(cr)))
+	{
+		x1 = cx1;
+		y1 = cy1;
+		x2 = cx2;
+		y2 = cy2;
+	}
+	else
+	{
+		double t;
+		if (x2 < x1)
+			t = x1, x1 = x2, x2 = t;
+		if (y2 < y1)
+			t = y1, y1 = y2, y2 = t;
+		x1 = fmax(x1, cx1);
+		y1 = fmax(y1, cy1);
+		x2 = fmin(x2, cx2);
+		y2 = fmin(y2, cy2);
+	}
+	if (!(x2 > x1 && y2 > y1))
+		return;
+
+	// Bounding box of the (possibly rotated) rectangle in device space
+	double px[4] = {x1, x2, x1, x2};
+	double py[4] = {y1, y1, y2, y2};
+	double dx1 = INFINITY, dy1 = INFINITY, dx2 = -INFINITY, dy2 = -INFINITY;
+	for (int i = 0; i < 4; i++)
+	{
+		cairo_user_to_device(cr, &px[i], &py[i]);
+		dx1 = fmin(dx1, px[i]);
+		dy1 = fmin(dy1, py[i]);
+		dx2 = fmax(dx2, px[i]);
+		dy2 = fmax(dy2, py[i]);
+	}
+
+	// Pad by a pixel for anti-aliasing and image filtering
+	dx1 = fmax(floor(dx1) - 1, 0);
+	dy1 = fmax(floor(dy1) - 1, 0);
+	dx2 = fmin(ceil(dx2) + 1, canvas->width);
+	dy2 = fmin(ceil(dy2) + 1, canvas->height);
+	if (!(dx2 > dx1 && dy2 > dy1))
+		return;
+
+	nx_canvas_damage(canvas, dx1, dy1, dx2 - dx1, dy2 - dy1);
+}
+
 static void set_fill_rule(JSContext *ctx, JSValueConst fill_rule, cairo_t *cr)
 {
 	cairo_fill_rule_t rule = CAIRO_FILL_RULE_WINDING;
@@ -98,12 +251,73 @@ static void set_fill_rule(JSContext *ctx, JSValueConst fill_rule, cairo_t *cr)
 	cairo_set_fill_rule(cr, rule);
 }
 
-static void apply_path(JSContext *ctx, JSValue this_val, JSValue path) {
-	nx_context_t *nx_ctx = JS_GetContextOpaque(ctx);
-	JSValue apply_path_func = JS_GetPropertyStr(ctx, nx_ctx->init_obj, "applyPath");
-	JSValue apply_path_argv[] = {this_val, path};
-	JS_Call(ctx, apply_path_func, JS_NULL, 2, apply_path_argv);
-	JS_FreeValue(ctx, apply_path_func);
+// Returns the cairo context that `CanvasPath` methods called on `obj` add segments to
+static cairo_t *get_path_target(JSContext *ctx, JSValueConst obj)
+{
+	nx_canvas_context_2d_t *context = JS_GetOpaque(obj, nx_canvas_context_class_id);
+	if (context)
+		return context->ctx;
+	nx_path2d_t *path = nx_get_path2d(ctx, obj);
+	if (!path)
+		return NULL;
+	return nx_path2d_begin_edit(path);
+}
+
+// Adds the segments of the `Path2D` instance `path` to the current path
+static bool apply_path(JSContext *ctx, nx_canvas_context_2d_t *context, JSValueConst path)
+{
+	nx_path2d_t *p = nx_get_path2d(ctx, path);
+	if (!p)
+		return true;
+	cairo_path_t *segments = nx_path2d_get_path(p);
+	if (segments->status == CAIRO_STATUS_SUCCESS)
+		cairo_append_path(context->ctx, segments);
+	return false;
+}
+
+static inline bool is_translation(const cairo_matrix_t *matrix)
+{
+	return matrix->xx == 1. && matrix->yy == 1. && matrix->xy == 0. && matrix->yx == 0.;
+}
+
+/**
+ * Gets the current clip region in device space, for drawing directly into
+ * the canvas pixels. `matrix` is the current transform, which must only be
+ * a translation. Returns `false` if the clip can not be represented as a
+ * single rectangle on pixel boundaries.
+ */
+static bool get_device_clip(nx_canvas_context_2d_t *context, const cairo_matrix_t *matrix, nx_rect_t *clip)
+{
+	nx_canvas_t *canvas = context->canvas;
+	clip->x1 = 0;
+	clip->y1 = 0;
+	clip->x2 = canvas->width;
+	clip->y2 = canvas->height;
+
+	cairo_rectangle_list_t *rects = cairo_copy_clip_rectangle_list(context->ctx);
+	bool representable = rects->status == CAIRO_STATUS_SUCCESS && rects->num_rectangles <= 1;
+	if (representable && rects->num_rectangles == 1)
+	{
+		// Clip rectangles are in user space, which is only translated from device space
+		cairo_rectangle_t *r = &rects->rectangles[0];
+		double x1 = r->x + matrix->x0;
+		double y1 = r->y + matrix->y0;
+		double x2 = x1 + r->width;
+		double y2 = y1 + r->height;
+		representable = x1 == floor(x1) && y1 == floor(y1) && x2 == floor(x2) && y2 == floor(y2);
+		clip->x1 = max(clip->x1, (int32_t)x1);
+		clip->y1 = max(clip->y1, (int32_t)y1);
+		clip->x2 = min(clip->x2, (int32_t)x2);
+		clip->y2 = min(clip->y2, (int32_t)y2);
+	}
+	else if (representable)
+	{
+		// Everything is clipped away
+		clip->x2 = clip->x1;
+		clip->y2 = clip->y1;
+	}
+	cairo_rectangle_list_destroy(rects);
+	return representable;
 }
 
 static void save_path(nx_canvas_context_2d_t *context)
@@ -121,6 +335,10 @@ static void restore_path(nx_canvas_context_2d_t *context)
 
 static void fill(nx_canvas_context_2d_t *context, bool preserve)
 {
+	double x1, y1, x2, y2;
+	cairo_path_extents(context->ctx, &x1, &y1, &x2, &y2);
+	damage_user_rect(context, x1, y1, x2, y2);
+
 	// TODO: support fill pattern / fill gradient / shadow
 	cairo_set_source_rgba(
 		context->ctx,
@@ -140,6 +358,10 @@ static void fill(nx_canvas_context_2d_t *context, bool preserve)
 
 static void stroke(nx_canvas_context_2d_t *context, bool preserve)
 {
+	double x1, y1, x2, y2;
+	cairo_stroke_extents(context->ctx, &x1, &y1, &x2, &y2);
+	damage_user_rect(context, x1, y1, x2, y2);
+
 	// TODO: support stroke pattern / stroke gradient / shadow
 	cairo_set_source_rgba(
 		context->ctx,
@@ -166,7 +388,7 @@ static void set_font_size(nx_canvas_context_2d_t *context, double font_size)
 
 static JSValue nx_canvas_context_2d_move_to(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
-	CANVAS_CONTEXT_THIS;
+	CANVAS_PATH_THIS;
 	double args[2];
 	if (js_validate_doubles_args(ctx, argv, args, 2, 0))
 		return JS_EXCEPTION;
@@ -196,7 +418,11 @@ static JSValue nx_canvas_context_2d_is_point_in_path(JSContext *ctx, JSValueCons
 		if (!JS_IsNull(path)) {
 			needs_restore = true;
 			save_path(context);
-			apply_path(ctx, this_val, path);
+			if (apply_path(ctx, context, path))
+			{
+				restore_path(context);
+				return JS_EXCEPTION;
+			}
 		}
 
 		nx_dommatrix_t matrix = {0};
@@ -235,7 +461,11 @@ static JSValue nx_canvas_context_2d_is_point_in_stroke(JSContext *ctx, JSValueCo
 		if (!JS_IsNull(path)) {
 			needs_restore = true;
 			save_path(context);
-			apply_path(ctx, this_val, path);
+			if (apply_path(ctx, context, path))
+			{
+				restore_path(context);
+				return JS_EXCEPTION;
+			}
 		}
 
 		nx_dommatrix_t matrix = {0};
@@ -258,7 +488,7 @@ static JSValue nx_canvas_context_2d_is_point_in_stroke(JSContext *ctx, JSValueCo
 
 static JSValue nx_canvas_context_2d_line_to(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
-	CANVAS_CONTEXT_THIS;
+	CANVAS_PATH_THIS;
 	double args[2];
 	if (js_validate_doubles_args(ctx, argv, args, 2, 0))
 		return JS_EXCEPTION;
@@ -268,7 +498,7 @@ static JSValue nx_canvas_context_2d_line_to(JSContext *ctx, JSValueConst this_va
 
 static JSValue nx_canvas_context_2d_bezier_curve_to(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
-	CANVAS_CONTEXT_THIS;
+	CANVAS_PATH_THIS;
 	double args[6];
 	if (js_validate_doubles_args(ctx, argv, args, 6, 0))
 		return JS_EXCEPTION;
@@ -279,14 +509,9 @@ static JSValue nx_canvas_context_2d_bezier_curve_to(JSContext *ctx, JSValueConst
 /*
  * Quadratic curve approximation from libsvg-cairo.
  */
-static JSValue nx_canvas_context_2d_quadratic_curve_to(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+static void quadratic_curve_to(cairo_t *cr, double x1, double y1, double x2, double y2)
 {
-	CANVAS_CONTEXT_THIS;
-	double args[4];
-	if (js_validate_doubles_args(ctx, argv, args, 4, 0))
-		return JS_EXCEPTION;
-	double x, y, x1 = args[0], y1 = args[1], x2 = args[2], y2 = args[3];
-
+	double x, y;
 	cairo_get_current_point(cr, &x, &y);
 
 	if (0 == x && 0 == y)
@@ -296,6 +521,15 @@ static JSValue nx_canvas_context_2d_quadratic_curve_to(JSContext *ctx, JSValueCo
 	}
 
 	cairo_curve_to(cr, x + 2.0 / 3.0 * (x1 - x), y + 2.0 / 3.0 * (y1 - y), x2 + 2.0 / 3.0 * (x1 - x2), y2 + 2.0 / 3.0 * (y1 - y2), x2, y2);
+}
+
+static JSValue nx_canvas_context_2d_quadratic_curve_to(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	CANVAS_PATH_THIS;
+	double args[4];
+	if (js_validate_doubles_args(ctx, argv, args, 4, 0))
+		return JS_EXCEPTION;
+	quadratic_curve_to(cr, args[0], args[1], args[2], args[3]);
 	return JS_UNDEFINED;
 }
 
@@ -350,12 +584,27 @@ static double adjustEndAngle(double startAngle, double endAngle, int countercloc
 	return newEndAngle;
 }
 
+static void arc(cairo_t *cr, double x, double y, double radius, double startAngle, double endAngle, int counterclockwise)
+{
+	canonicalizeAngle(&startAngle, &endAngle);
+	endAngle = adjustEndAngle(startAngle, endAngle, counterclockwise);
+
+	if (counterclockwise)
+	{
+		cairo_arc_negative(cr, x, y, radius, startAngle, endAngle);
+	}
+	else
+	{
+		cairo_arc(cr, x, y, radius, startAngle, endAngle);
+	}
+}
+
 /*
  * Adds an arc at x, y with the given radii and start/end angles.
  */
 static JSValue nx_canvas_context_2d_arc(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
-	CANVAS_CONTEXT_THIS;
+	CANVAS_PATH_THIS;
 	double args[5];
 	if (js_validate_doubles_args(ctx, argv, args, 5, 0))
 		return JS_EXCEPTION;
@@ -372,22 +621,11 @@ static JSValue nx_canvas_context_2d_arc(JSContext *ctx, JSValueConst this_val, i
 		return JS_EXCEPTION;
 	}
 
-	int counterclockwise = JS_ToBool(ctx, argv[6]);
+	int counterclockwise = argc >= 6 ? JS_ToBool(ctx, argv[5]) : 0;
 	if (counterclockwise == -1)
 		return JS_EXCEPTION;
 
-	canonicalizeAngle(&startAngle, &endAngle);
-	endAngle = adjustEndAngle(startAngle, endAngle, counterclockwise);
-
-	if (counterclockwise)
-	{
-		cairo_arc_negative(cr, x, y, radius, startAngle, endAngle);
-	}
-	else
-	{
-		cairo_arc(cr, x, y, radius, startAngle, endAngle);
-	}
-
+	arc(cr, x, y, radius, startAngle, endAngle, counterclockwise);
 	return JS_UNDEFINED;
 }
 
@@ -398,7 +636,7 @@ static JSValue nx_canvas_context_2d_arc(JSContext *ctx, JSValueConst this_val, i
  */
 static JSValue nx_canvas_context_2d_arc_to(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
-	CANVAS_CONTEXT_THIS;
+	CANVAS_PATH_THIS;
 	double args[5];
 	if (js_validate_doubles_args(ctx, argv, args, 5, 0))
 		return JS_EXCEPTION;
@@ -499,7 +737,7 @@ static JSValue nx_canvas_context_2d_arc_to(JSContext *ctx, JSValueConst this_val
 
 static JSValue nx_canvas_context_2d_ellipse(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
-	CANVAS_CONTEXT_THIS;
+	CANVAS_PATH_THIS;
 	double args[7];
 	if (js_validate_doubles_args(ctx, argv, args, 7, 0))
 		return JS_EXCEPTION;
@@ -550,10 +788,8 @@ static JSValue nx_canvas_context_2d_ellipse(JSContext *ctx, JSValueConst this_va
 	return JS_UNDEFINED;
 }
 
-static JSValue nx_canvas_context_2d_rect(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+static void rect(cairo_t *cr, double x, double y, double width, double height)
 {
-	CANVAS_CONTEXT_THIS;
-	RECT_ARGS;
 	if (width == 0)
 	{
 		cairo_move_to(cr, x, y);
@@ -568,6 +804,13 @@ static JSValue nx_canvas_context_2d_rect(JSContext *ctx, JSValueConst this_val,
 	{
 		cairo_rectangle(cr, x, y, width, height);
 	}
+}
+
+static JSValue nx_canvas_context_2d_rect(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	CANVAS_PATH_THIS;
+	RECT_ARGS;
+	rect(cr, x, y, width, height);
 	return JS_UNDEFINED;
 }
 
@@ -648,7 +891,7 @@ inline static bool get_radius(JSContext *ctx, JSValue v, Point *p)
 
 static JSValue nx_canvas_context_2d_round_rect(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
-	CANVAS_CONTEXT_THIS;
+	CANVAS_PATH_THIS;
 	RECT_ARGS;
 
 	// 4. Let normalizedRadii be an empty list
@@ -845,132 +1088,96 @@ static JSValue nx_canvas_context_2d_get_transform(JSContext *ctx, JSValueConst t
 	return array;
 }
 
-static JSValue nx_canvas_context_2d_stroke_rect(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+static void stroke_rect(nx_canvas_context_2d_t *context, double x, double y, double width, double height)
 {
-	CANVAS_CONTEXT_THIS;
-	RECT_ARGS;
 	if (width && height)
 	{
 		save_path(context);
-		cairo_rectangle(cr, x, y, width, height);
+		cairo_rectangle(context->ctx, x, y, width, height);
 		stroke(context, false);
 		restore_path(context);
 	}
-	return JS_UNDEFINED;
 }
 
-static JSValue nx_canvas_context_2d_clear_rect(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+static JSValue nx_canvas_context_2d_stroke_rect(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
 	CANVAS_CONTEXT_THIS;
+	CANVAS_CONTEXT_DRAWABLE;
 	RECT_ARGS;
+	stroke_rect(context, x, y, width, height);
+	return JS_UNDEFINED;
+}
+
+static void clear_rect(nx_canvas_context_2d_t *context, double x, double y, double width, double height)
+{
+	cairo_t *cr = context->ctx;
 	if (width && height)
 	{
 		cairo_save(cr);
 		save_path(context);
 		cairo_rectangle(cr, x, y, width, height);
 		cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+		damage_user_rect(context, x, y, x + width, y + height);
 		cairo_fill(cr);
 		restore_path(context);
 		cairo_restore(cr);
 	}
-	return JS_UNDEFINED;
 }
 
-double get_text_scale(nx_canvas_context_2d_t *context, const char *text, double max_width)
+static JSValue nx_canvas_context_2d_clear_rect(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
-	// Create HarfBuzz buffer
-	hb_buffer_t *buf = hb_buffer_create();
-
-	// Set buffer to LTR direction, common script and default language
-	hb_buffer_set_direction(buf, HB_DIRECTION_LTR);
-	hb_buffer_set_script(buf, HB_SCRIPT_COMMON);
-	hb_buffer_set_language(buf, hb_language_get_default());
-
-	// Add text and layout it
-	hb_buffer_add_utf8(buf, text, -1, 0, -1);
-	hb_shape(context->state->hb_font, buf, NULL, 0);
-
-	// Get buffer data
-	unsigned int glyph_count = hb_buffer_get_length(buf);
-	hb_glyph_position_t *glyph_pos = hb_buffer_get_glyph_positions(buf, NULL);
-
-	double width = 0;
-	for (int i = 0; i < glyph_count; ++i)
-	{
-		width += glyph_pos[i].x_advance / (64.0);
-	}
+	CANVAS_CONTEXT_THIS;
+	CANVAS_CONTEXT_DRAWABLE;
+	RECT_ARGS;
+	clear_rect(context, x, y, width, height);
+	return JS_UNDEFINED;
+}
 
-	hb_buffer_destroy(buf);
+// Maximum number of glyphs positioned on the stack when drawing text
+#define TEXT_STACK_GLYPHS 64
 
-	return width > max_width ? max_width / width : 1.;
+// Returns the shaped glyph run of `text` in the current font at `font_size`
+static nx_glyph_run_t *get_glyph_run(JSContext *ctx, nx_canvas_context_2d_t *context, const char *text, size_t length, double font_size)
+{
+	nx_glyph_run_t *run = nx_glyph_run_get(context->state->hb_font, font_size, HB_DIRECTION_LTR, text, length);
+	if (!run)
+		JS_ThrowOutOfMemory(ctx);
+	return run;
 }
 
-static JSValue nx_canvas_context_2d_fill_text(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+static bool get_text_scale(JSContext *ctx, nx_canvas_context_2d_t *context, const char *text, size_t length, double max_width, double *scale)
 {
-	CANVAS_CONTEXT_THIS;
-	double args[2];
-	if (js_validate_doubles_args(ctx, argv, args, 2, 1))
-		return JS_EXCEPTION;
-
-	const char *text = JS_ToCString(ctx, argv[0]);
-	if (!text)
-		return JS_EXCEPTION;
-
-	double scale = 1.;
-	double font_size = context->state->font_size;
-
-	if (argc >= 4 && JS_IsNumber(argv[3]))
-	{
-		double max_width;
-		if (JS_ToFloat64(ctx, &max_width, argv[3]))
-			return JS_EXCEPTION;
-		scale = get_text_scale(context, text, max_width);
-
-		if (scale != 1.)
-		{
-			set_font_size(context, font_size * scale);
-		}
-	}
-
-	// Create HarfBuzz buffer
-	hb_buffer_t *buf = hb_buffer_create();
-
-	// Set buffer to LTR direction, common script and default language
-	hb_buffer_set_direction(buf, HB_DIRECTION_LTR);
-	hb_buffer_set_script(buf, HB_SCRIPT_COMMON);
-	hb_buffer_set_language(buf, hb_language_get_default());
-
-	// Add text and layout it
-	hb_buffer_add_utf8(buf, text, -1, 0, -1);
-	hb_shape(context->state->hb_font, buf, NULL, 0);
-
-	// Get buffer data
-	unsigned int glyph_count = hb_buffer_get_length(buf);
-	hb_glyph_info_t *glyph_info = hb_buffer_get_glyph_infos(buf, NULL);
-	hb_glyph_position_t *glyph_pos = hb_buffer_get_glyph_positions(buf, NULL);
+	nx_glyph_run_t *run = get_glyph_run(ctx, context, text, length, context->state->font_size);
+	if (!run)
+		return true;
+	double width = run->x_advance;
+	*scale = width > max_width ? max_width / width : 1.;
+	return false;
+}
 
-	// Shape glyph for Cairo
-	cairo_glyph_t *cairo_glyphs = cairo_glyph_allocate(glyph_count);
-	double x = 0;
-	double y = 0;
-	for (int i = 0; i < glyph_count; ++i)
-	{
-		cairo_glyphs[i].index = glyph_info[i].codepoint;
-		cairo_glyphs[i].x = x + (glyph_pos[i].x_offset / (64.0));
-		cairo_glyphs[i].y = -(y + glyph_pos[i].y_offset / (64.0));
-		x += glyph_pos[i].x_advance / (64.0);
-		y += glyph_pos[i].y_advance / (64.0);
-	}
+/**
+ * Positions the glyphs of `run` at (`x`, `y`) according to the current
+ * `textAlign` and `textBaseline`. `stack_glyphs` is used when the run has
+ * at most `TEXT_STACK_GLYPHS` glyphs, otherwise the glyphs are allocated
+ * and must be freed with `cairo_glyph_free()`.
+ */
+static cairo_glyph_t *position_glyphs(nx_canvas_context_2d_t *context, nx_glyph_run_t *run, double x, double y, cairo_glyph_t *stack_glyphs)
+{
+	cairo_glyph_t *cairo_glyphs = run->glyph_count <= TEXT_STACK_GLYPHS
+									  ? stack_glyphs
+									  : cairo_glyph_allocate(run->glyph_count);
+	if (!cairo_glyphs)
+		return NULL;
 
 	// TODO: consider RTL fonts / `direction` property for START / END mode
 	double alignment_offset = 0; // TEXT_ALIGN_START / TEXT_ALIGN_LEFT
 	if (context->state->text_align == TEXT_ALIGN_END || context->state->text_align == TEXT_ALIGN_RIGHT)
 	{
-		alignment_offset = -x;
+		alignment_offset = -run->x_advance;
 	}
 	else if (context->state->text_align == TEXT_ALIGN_CENTER)
 	{
-		alignment_offset = -x / 2.0;
+		alignment_offset = -run->x_advance / 2.0;
 	}
 
 	double baseline_offset = 0; // TEXT_BASELINE_ALPHABETIC
@@ -998,10 +1205,134 @@ static JSValue nx_canvas_context_2d_fill_text(JSContext *ctx, JSValueConst this_
 	}
 
 	// Move glyphs to the correct positions
-	for (int i = 0; i < glyph_count; ++i)
+	for (unsigned int i = 0; i < run->glyph_count; ++i)
+	{
+		cairo_glyphs[i].index = run->glyphs[i].index;
+		cairo_glyphs[i].x = run->glyphs[i].x + x + alignment_offset;
+		cairo_glyphs[i].y = run->glyphs[i].y + y + baseline_offset;
+	}
+
+	return cairo_glyphs;
+}
+
+/**
+ * Draws positioned glyphs by blending them from the glyph atlas directly
+ * into the canvas pixels. This is only possible when the current transform
+ * is a translation, the clip is a single pixel-aligned rectangle and the
+ * glyphs are composited with `source-over`. Returns `false` (without
+ * drawing) when the text needs to be drawn by cairo instead.
+ */
+static bool fill_glyphs_from_atlas(nx_canvas_context_2d_t *context, cairo_glyph_t *glyphs, unsigned int count, double font_size)
+{
+	cairo_t *cr = context->ctx;
+	nx_canvas_t *canvas = context->canvas;
+
+	if (cairo_get_operator(cr) != CAIRO_OPERATOR_OVER || !FT_IS_SCALABLE(context->state->ft_face))
+		return false;
+
+	cairo_matrix_t matrix;
+	cairo_get_matrix(cr, &matrix);
+	if (!is_translation(&matrix))
+		return false;
+
+	nx_rect_t clip;
+	if (!get_device_clip(context, &matrix, &clip))
+		return false;
+
+	// Premultiplied, native-endian ARGB32
+	double a = context->state->fill.a * context->state->global_alpha;
+	uint8_t color[4] = {
+		(uint8_t)lround(context->state->fill.b * a * 255.),
+		(uint8_t)lround(context->state->fill.g * a * 255.),
+		(uint8_t)lround(context->state->fill.r * a * 255.),
+		(uint8_t)lround(a * 255.),
+	};
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		glyphs[i].x += matrix.x0;
+		glyphs[i].y += matrix.y0;
+	}
+
+	cairo_surface_flush(canvas->surface);
+	nx_rect_t drawn;
+	if (!nx_glyph_atlas_draw(context->state->ft_face, font_size, glyphs, count,
+							 canvas->data, canvas->width * 4, &clip, color, &drawn))
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			glyphs[i].x -= matrix.x0;
+			glyphs[i].y -= matrix.y0;
+		}
+		return false;
+	}
+
+	if (drawn.x2 > drawn.x1)
 	{
-		cairo_glyphs[i].x += args[0] + alignment_offset;
-		cairo_glyphs[i].y += args[1] + baseline_offset;
+		cairo_surface_mark_dirty_rectangle(canvas->surface, drawn.x1, drawn.y1, drawn.x2 - drawn.x1, drawn.y2 - drawn.y1);
+		nx_canvas_damage(canvas, drawn.x1, drawn.y1, drawn.x2 - drawn.x1, drawn.y2 - drawn.y1);
+	}
+	return true;
+}
+
+static JSValue nx_canvas_context_2d_fill_text(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	CANVAS_CONTEXT_THIS;
+	CANVAS_CONTEXT_DRAWABLE;
+	double args[2];
+	if (js_validate_doubles_args(ctx, argv, args, 2, 1))
+		return JS_EXCEPTION;
+
+	double max_width = 0;
+	bool has_max_width = argc >= 4 && JS_IsNumber(argv[3]);
+	if (has_max_width && JS_ToFloat64(ctx, &max_width, argv[3]))
+		return JS_EXCEPTION;
+
+	size_t length;
+	const char *text = JS_ToCStringLen(ctx, &length, argv[0]);
+	if (!text)
+		return JS_EXCEPTION;
+
+	double scale = 1.;
+	double font_size = context->state->font_size;
+
+	if (has_max_width)
+	{
+		if (get_text_scale(ctx, context, text, length, max_width, &scale))
+		{
+			JS_FreeCString(ctx, text);
+			return JS_EXCEPTION;
+		}
+
+		if (scale != 1.)
+		{
+			set_font_size(context, font_size * scale);
+		}
+	}
+
+	nx_glyph_run_t *run = get_glyph_run(ctx, context, text, length, font_size * scale);
+	JS_FreeCString(ctx, text);
+	cairo_glyph_t stack_glyphs[TEXT_STACK_GLYPHS];
+	cairo_glyph_t *cairo_glyphs = run ? position_glyphs(context, run, args[0], args[1], stack_glyphs) : NULL;
+	if (!cairo_glyphs)
+	{
+		if (scale != 1.)
+		{
+			set_font_size(context, font_size);
+		}
+		return run ? JS_ThrowOutOfMemory(ctx) : JS_EXCEPTION;
+	}
+
+	if (context->state->text_rendering == TEXT_RENDERING_OPTIMIZE_SPEED &&
+		fill_glyphs_from_atlas(context, cairo_glyphs, run->glyph_count, font_size * scale))
+	{
+		if (scale != 1.)
+		{
+			set_font_size(context, font_size);
+		}
+		if (cairo_glyphs != stack_glyphs)
+			cairo_glyph_free(cairo_glyphs);
+		return JS_UNDEFINED;
 	}
 
 	// TODO: support gradient / pattern
@@ -1012,16 +1343,24 @@ static JSValue nx_canvas_context_2d_fill_text(JSContext *ctx, JSValueConst this_
 		context->state->fill.b,
 		context->state->fill.a * context->state->global_alpha);
 
-	cairo_show_glyphs(cr, cairo_glyphs, glyph_count);
+	cairo_text_extents_t extents;
+	cairo_glyph_extents(cr, cairo_glyphs, run->glyph_count, &extents);
+	damage_user_rect(
+		context,
+		extents.x_bearing,
+		extents.y_bearing,
+		extents.x_bearing + extents.width,
+		extents.y_bearing + extents.height);
+
+	cairo_show_glyphs(cr, cairo_glyphs, run->glyph_count);
 
 	if (scale != 1.)
 	{
 		set_font_size(context, font_size);
 	}
 
-	cairo_glyph_free(cairo_glyphs);
-	hb_buffer_destroy(buf);
-	JS_FreeCString(ctx, text);
+	if (cairo_glyphs != stack_glyphs)
+		cairo_glyph_free(cairo_glyphs);
 
 	return JS_UNDEFINED;
 }
@@ -1029,25 +1368,31 @@ static JSValue nx_canvas_context_2d_fill_text(JSContext *ctx, JSValueConst this_
 static JSValue nx_canvas_context_2d_stroke_text(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
 	CANVAS_CONTEXT_THIS;
+	CANVAS_CONTEXT_DRAWABLE;
 	double args[2];
 	if (js_validate_doubles_args(ctx, argv, args, 2, 1))
 		return JS_EXCEPTION;
 
-	const char *text = JS_ToCString(ctx, argv[0]);
-	if (!text)
+	double max_width = 0;
+	bool has_max_width = argc >= 4 && JS_IsNumber(argv[3]);
+	if (has_max_width && JS_ToFloat64(ctx, &max_width, argv[3]))
 		return JS_EXCEPTION;
 
-	save_path(context);
+	size_t length;
+	const char *text = JS_ToCStringLen(ctx, &length, argv[0]);
+	if (!text)
+		return JS_EXCEPTION;
 
 	double scale = 1.;
 	double font_size = context->state->font_size;
 
-	if (argc >= 4 && JS_IsNumber(argv[3]))
+	if (has_max_width)
 	{
-		double max_width;
-		if (JS_ToFloat64(ctx, &max_width, argv[3]))
+		if (get_text_scale(ctx, context, text, length, max_width, &scale))
+		{
+			JS_FreeCString(ctx, text);
 			return JS_EXCEPTION;
-		scale = get_text_scale(context, text, max_width);
+		}
 
 		if (scale != 1.)
 		{
@@ -1055,80 +1400,23 @@ static JSValue nx_canvas_context_2d_stroke_text(JSContext *ctx, JSValueConst thi
 		}
 	}
 
-	// Create HarfBuzz buffer
-	hb_buffer_t *buf = hb_buffer_create();
-
-	// Set buffer to LTR direction, common script and default language
-	hb_buffer_set_direction(buf, HB_DIRECTION_LTR);
-	hb_buffer_set_script(buf, HB_SCRIPT_COMMON);
-	hb_buffer_set_language(buf, hb_language_get_default());
-
-	// Add text and layout it
-	hb_buffer_add_utf8(buf, text, -1, 0, -1);
-	hb_shape(context->state->hb_font, buf, NULL, 0);
-
-	// Get buffer data
-	unsigned int glyph_count = hb_buffer_get_length(buf);
-	hb_glyph_info_t *glyph_info = hb_buffer_get_glyph_infos(buf, NULL);
-	hb_glyph_position_t *glyph_pos = hb_buffer_get_glyph_positions(buf, NULL);
-
-	// Shape glyph for Cairo
-	cairo_glyph_t *cairo_glyphs = cairo_glyph_allocate(glyph_count);
-	double x = 0;
-	double y = 0;
-	for (int i = 0; i < glyph_count; ++i)
-	{
-		cairo_glyphs[i].index = glyph_info[i].codepoint;
-		cairo_glyphs[i].x = x + (glyph_pos[i].x_offset / (64.0));
-		cairo_glyphs[i].y = -(y + glyph_pos[i].y_offset / (64.0));
-		x += glyph_pos[i].x_advance / (64.0);
-		y += glyph_pos[i].y_advance / (64.0);
-	}
-
-	// TODO: consider RTL fonts / `direction` property for START / END mode
-	double alignment_offset = 0; // TEXT_ALIGN_START / TEXT_ALIGN_LEFT
-	if (context->state->text_align == TEXT_ALIGN_END || context->state->text_align == TEXT_ALIGN_RIGHT)
-	{
-		alignment_offset = -x;
-	}
-	else if (context->state->text_align == TEXT_ALIGN_CENTER)
-	{
-		alignment_offset = -x / 2.0;
-	}
-
-	double baseline_offset = 0; // TEXT_BASELINE_ALPHABETIC
-	if (context->state->text_baseline == TEXT_BASELINE_TOP)
-	{
-		baseline_offset = context->state->ft_face->size->metrics.ascender / 64.0;
-	}
-	else if (context->state->text_baseline == TEXT_BASELINE_HANGING)
-	{
-		// TODO: don't know how to properly calculate this, so just pick a multiplier that seems close
-		baseline_offset = (context->state->ft_face->size->metrics.ascender / 64.0) * 0.80;
-	}
-	else if (context->state->text_baseline == TEXT_BASELINE_MIDDLE)
-	{
-		baseline_offset = ((context->state->ft_face->size->metrics.ascender / 64.0) + (context->state->ft_face->size->metrics.descender / 64.0)) / 2.0;
-	}
-	else if (context->state->text_baseline == TEXT_BASELINE_IDEOGRAPHIC)
-	{
-		baseline_offset = context->state->ft_face->size->metrics.descender / 64.0;
-	}
-	else if (context->state->text_baseline == TEXT_BASELINE_BOTTOM)
+	nx_glyph_run_t *run = get_glyph_run(ctx, context, text, length, font_size * scale);
+	JS_FreeCString(ctx, text);
+	cairo_glyph_t stack_glyphs[TEXT_STACK_GLYPHS];
+	cairo_glyph_t *cairo_glyphs = run ? position_glyphs(context, run, args[0], args[1], stack_glyphs) : NULL;
+	if (!cairo_glyphs)
 	{
-		// TODO: don't know how to properly calculate this, so just pick a multiplier that seems close
-		baseline_offset = (context->state->ft_face->size->metrics.descender / 64.0) * 2.0;
+		if (scale != 1.)
+		{
+			set_font_size(context, font_size);
+		}
+		return run ? JS_ThrowOutOfMemory(ctx) : JS_EXCEPTION;
 	}
 
-	// Move glyphs to the correct positions
-	for (int i = 0; i < glyph_count; ++i)
-	{
-		cairo_glyphs[i].x += args[0] + alignment_offset;
-		cairo_glyphs[i].y += args[1] + baseline_offset;
-	}
+	save_path(context);
 
 	// Draw the text onto the Cairo surface
-	cairo_glyph_path(cr, cairo_glyphs, glyph_count);
+	cairo_glyph_path(cr, cairo_glyphs, run->glyph_count);
 
 	stroke(context, false);
 
@@ -1139,9 +1427,8 @@ static JSValue nx_canvas_context_2d_stroke_text(JSContext *ctx, JSValueConst thi
 
 	restore_path(context);
 
-	cairo_glyph_free(cairo_glyphs);
-	hb_buffer_destroy(buf);
-	JS_FreeCString(ctx, text);
+	if (cairo_glyphs != stack_glyphs)
+		cairo_glyph_free(cairo_glyphs);
 
 	return JS_UNDEFINED;
 }
@@ -1149,36 +1436,21 @@ static JSValue nx_canvas_context_2d_stroke_text(JSContext *ctx, JSValueConst thi
 static JSValue nx_canvas_context_2d_measure_text(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
 	CANVAS_CONTEXT_THIS;
-	const char *text = JS_ToCString(ctx, argv[0]);
-
-	// Create HarfBuzz buffer
-	hb_buffer_t *buf = hb_buffer_create();
-
-	// Set buffer to LTR direction, common script and default language
-	hb_buffer_set_direction(buf, HB_DIRECTION_LTR);
-	hb_buffer_set_script(buf, HB_SCRIPT_COMMON);
-	hb_buffer_set_language(buf, hb_language_get_default());
-
-	// Add text and layout it
-	hb_buffer_add_utf8(buf, text, -1, 0, -1);
-	hb_shape(context->state->hb_font, buf, NULL, 0);
-
-	// Get buffer data
-	unsigned int glyph_count = hb_buffer_get_length(buf);
-	hb_glyph_position_t *glyph_pos = hb_buffer_get_glyph_positions(buf, NULL);
+	size_t length;
+	const char *text = JS_ToCStringLen(ctx, &length, argv[0]);
+	if (!text)
+		return JS_EXCEPTION;
 
-	double width = 0;
-	// Calculate the width of the text
-	for (int i = 0; i < glyph_count; ++i)
-	{
-		width += glyph_pos[i].x_advance / 64.0;
-	}
+	nx_glyph_run_t *run = get_glyph_run(ctx, context, text, length, context->state->font_size);
+	JS_FreeCString(ctx, text);
+	if (!run)
+		return JS_EXCEPTION;
 
 	// Create the TextMetrics object
 	JSValue metrics = JS_NewObject(ctx);
 
 	// Set the width property
-	JS_SetPropertyStr(ctx, metrics, "width", JS_NewFloat64(ctx, width));
+	JS_SetPropertyStr(ctx, metrics, "width", JS_NewFloat64(ctx, run->x_advance));
 
 	// Set the rest of the properties to 0 for now
 	JS_SetPropertyStr(ctx, metrics, "actualBoundingBoxLeft", JS_NewFloat64(ctx, 0));
@@ -1193,9 +1465,6 @@ static JSValue nx_canvas_context_2d_measure_text(JSContext *ctx, JSValueConst th
 	JS_SetPropertyStr(ctx, metrics, "alphabeticBaseline", JS_NewFloat64(ctx, 0));
 	JS_SetPropertyStr(ctx, metrics, "ideographicBaseline", JS_NewFloat64(ctx, 0));
 
-	JS_FreeCString(ctx, text);
-	hb_buffer_destroy(buf);
-
 	return metrics;
 }
 
@@ -1207,6 +1476,7 @@ static void js_free_array_buffer(JSRuntime *rt, void *opaque, void *ptr)
 static JSValue nx_canvas_context_2d_put_image_data(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
 	CANVAS_CONTEXT_THIS;
+	CANVAS_CONTEXT_DRAWABLE;
 
 	int sx = 0, sy = 0, sw = 0, sh = 0, dx, dy, image_data_width, image_data_height, rows, cols;
 	size_t src_offset, src_length, bytes_per_element;
@@ -1294,48 +1564,15 @@ static JSValue nx_canvas_context_2d_put_image_data(JSContext *ctx, JSValueConst
 	dst += dstStride * dy + 4 * dx;
 	for (int y = 0; y < rows; ++y)
 	{
-		uint8_t *dstRow = dst;
-		uint8_t *srcRow = src;
-		for (int x = 0; x < cols; ++x)
-		{
-			// rgba
-			uint8_t r = *srcRow++;
-			uint8_t g = *srcRow++;
-			uint8_t b = *srcRow++;
-			uint8_t a = *srcRow++;
-
-			// argb
-			// performance optimization: fully transparent/opaque pixels can be
-			// processed more efficiently.
-			if (a == 0)
-			{
-				*dstRow++ = 0;
-				*dstRow++ = 0;
-				*dstRow++ = 0;
-				*dstRow++ = 0;
-			}
-			else if (a == 255)
-			{
-				*dstRow++ = b;
-				*dstRow++ = g;
-				*dstRow++ = r;
-				*dstRow++ = a;
-			}
-			else
-			{
-				float alpha = (float)a / 255;
-				*dstRow++ = b * alpha;
-				*dstRow++ = g * alpha;
-				*dstRow++ = r * alpha;
-				*dstRow++ = a;
-			}
-		}
+		// rgba -> premultiplied argb
+		nx_rgba_to_bgra_premultiplied(dst, src, cols);
 		dst += dstStride;
 		src += srcStride;
 	}
 
 	cairo_surface_mark_dirty_rectangle(
 		context->canvas->surface, dx, dy, cols, rows);
+	nx_canvas_damage(context->canvas, dx, dy, cols, rows);
 
 	return JS_UNDEFINED;
 }
@@ -1355,75 +1592,116 @@ void decompose_matrix(cairo_matrix_t matrix, double *destination)
 	destination[5] = matrix.y0;
 }
 
-static JSValue nx_canvas_context_2d_draw_image(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+// Gets the surface and size of an `Image` or canvas to draw
+static bool get_image_source(JSContext *ctx, JSValueConst obj, cairo_surface_t **surface, double *width, double *height)
 {
-	if (argc != 3 && argc != 5 && argc != 9)
+	nx_image_t *img = nx_get_image(ctx, obj);
+	if (img)
 	{
-		JS_ThrowTypeError(ctx, "Invalid arguments");
-		return JS_EXCEPTION;
+		*surface = img->surface;
+		*width = img->width;
+		*height = img->height;
+		return false;
+	}
+	nx_canvas_t *canvas = nx_get_canvas(ctx, obj);
+	if (!canvas)
+	{
+		JS_ThrowTypeError(ctx, "Image or Canvas expected");
+		return true;
 	}
+	*surface = canvas->surface;
+	*width = canvas->width;
+	*height = canvas->height;
+	return false;
+}
 
-	double args[8];
-	if (js_validate_doubles_args(ctx, argv, args, argc - 1, 1))
-		return JS_EXCEPTION;
+/**
+ * Draws an image at its natural size by blending its rows directly into
+ * the canvas pixels. This is only possible when the image lands on whole
+ * device pixels (the transform is a translation by an integer offset),
+ * the clip is a single pixel-aligned rectangle and the image is composited
+ * with `source-over` at full opacity, which is the common case for sprites
+ * and tile maps. Returns `false` (without drawing) when the image needs to
+ * be drawn by cairo instead.
+ */
+static bool blit_image(nx_canvas_context_2d_t *context, cairo_surface_t *surface,
+					   double source_w, double source_h,
+					   double sx, double sy, double sw, double sh,
+					   double dx, double dy, double dw, double dh)
+{
+	cairo_t *cr = context->ctx;
+	nx_canvas_t *canvas = context->canvas;
+
+	if (surface == canvas->surface ||
+		context->state->global_alpha != 1. ||
+		cairo_get_operator(cr) != CAIRO_OPERATOR_OVER ||
+		cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE ||
+		cairo_image_surface_get_format(surface) != CAIRO_FORMAT_ARGB32)
+		return false;
 
-	CANVAS_CONTEXT_THIS;
+	// No scaling, and the source rectangle must be entirely within the image
+	if (sw != dw || sh != dh || sw <= 0 || sh <= 0 ||
+		sx < 0 || sy < 0 || sx + sw > source_w || sy + sh > source_h ||
+		sx != floor(sx) || sy != floor(sy) || sw != floor(sw) || sh != floor(sh))
+		return false;
 
-	double sx = 0, sy = 0, sw = 0, sh = 0, dx = 0, dy = 0, dw = 0, dh = 0, source_w = 0, source_h = 0;
-	cairo_surface_t *surface;
+	cairo_matrix_t matrix;
+	cairo_get_matrix(cr, &matrix);
+	if (!is_translation(&matrix))
+		return false;
 
-	nx_image_t *img = nx_get_image(ctx, argv[0]);
-	if (img)
-	{
-		surface = img->surface;
-		source_w = sw = img->width;
-		source_h = sh = img->height;
-	}
-	else
-	{
-		nx_canvas_t *canvas = nx_get_canvas(ctx, argv[0]);
-		if (!canvas)
-		{
-			JS_ThrowTypeError(ctx, "Image or Canvas expected");
-			return JS_EXCEPTION;
-		}
-		surface = canvas->surface;
-		source_w = sw = canvas->width;
-		source_h = sh = canvas->height;
-	}
+	double x = dx + matrix.x0;
+	double y = dy + matrix.y0;
+	if (x != floor(x) || y != floor(y) || fabs(x) > INT32_MAX / 2 || fabs(y) > INT32_MAX / 2)
+		return false;
 
-	// Arguments
-	switch (argc)
+	nx_rect_t clip;
+	if (!get_device_clip(context, &matrix, &clip))
+		return false;
+
+	int32_t x1 = max(clip.x1, (int32_t)x);
+	int32_t y1 = max(clip.y1, (int32_t)y);
+	int32_t x2 = min(clip.x2, (int32_t)x + (int32_t)sw);
+	int32_t y2 = min(clip.y2, (int32_t)y + (int32_t)sh);
+	if (x1 >= x2 || y1 >= y2)
+		return true;
+
+	cairo_surface_flush(surface);
+	cairo_surface_flush(canvas->surface);
+
+	size_t src_stride = cairo_image_surface_get_stride(surface);
+	size_t dst_stride = canvas->width * 4;
+	const uint8_t *src = cairo_image_surface_get_data(surface) +
+						 ((size_t)sy + (y1 - (int32_t)y)) * src_stride +
+						 ((size_t)sx + (x1 - (int32_t)x)) * 4;
+	uint8_t *dst = canvas->data + (size_t)y1 * dst_stride + (size_t)x1 * 4;
+	for (int32_t row = y1; row < y2; row++)
 	{
-	case 9:
-		// img, sx, sy, sw, sh, dx, dy, dw, dh
-		sx = args[0];
-		sy = args[1];
-		sw = args[2];
-		sh = args[3];
-		dx = args[4];
-		dy = args[5];
-		dw = args[6];
-		dh = args[7];
-		break;
-	case 5:
-		// img, dx, dy, dw, dh
-		dx = args[0];
-		dy = args[1];
-		dw = args[2];
-		dh = args[3];
-		break;
-	case 3:
-		// img, dx, dy
-		dx = args[0];
-		dy = args[1];
-		dw = sw;
-		dh = sh;
-		break;
+		nx_blend_over(dst, src, x2 - x1);
+		dst += dst_stride;
+		src += src_stride;
 	}
 
-	if (!(sw && sh && dw && dh))
-		return JS_UNDEFINED;
+	cairo_surface_mark_dirty_rectangle(canvas->surface, x1, y1, x2 - x1, y2 - y1);
+	nx_canvas_damage(canvas, x1, y1, x2 - x1, y2 - y1);
+	return true;
+}
+
+static void draw_image(nx_canvas_context_2d_t *context, cairo_surface_t *surface,
+					   double source_w, double source_h,
+					   double sx, double sy, double sw, double sh,
+					   double dx, double dy, double dw, double dh)
+{
+	cairo_t *cr = context->ctx;
+
+	// An `Image` that has not loaded yet (or a closed `ImageBitmap`) has no surface
+	if (!surface || !(sw && sh && dw && dh))
+		return;
+
+	if (blit_image(context, surface, source_w, source_h, sx, sy, sw, sh, dx, dy, dw, dh))
+		return;
+
+	damage_user_rect(context, dx, dy, dx + dw, dy + dh);
 
 	// Start draw
 	cairo_save(cr);
@@ -1567,7 +1845,95 @@ static JSValue nx_canvas_context_2d_draw_image(JSContext *ctx, JSValueConst this
 		cairo_destroy(ctxTemp);
 		cairo_surface_destroy(surfTemp);
 	}
+}
+
+static JSValue nx_canvas_context_2d_draw_image(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	if (argc != 3 && argc != 5 && argc != 9)
+	{
+		JS_ThrowTypeError(ctx, "Invalid arguments");
+		return JS_EXCEPTION;
+	}
+
+	double args[8];
+	if (js_validate_doubles_args(ctx, argv, args, argc - 1, 1))
+		return JS_EXCEPTION;
 
+	CANVAS_CONTEXT_THIS;
+	CANVAS_CONTEXT_DRAWABLE;
+
+	double sx = 0, sy = 0, sw = 0, sh = 0, dx = 0, dy = 0, dw = 0, dh = 0, source_w = 0, source_h = 0;
+	cairo_surface_t *surface;
+	if (get_image_source(ctx, argv[0], &surface, &source_w, &source_h))
+		return JS_EXCEPTION;
+	sw = source_w;
+	sh = source_h;
+
+	// Arguments
+	switch (argc)
+	{
+	case 9:
+		// img, sx, sy, sw, sh, dx, dy, dw, dh
+		sx = args[0];
+		sy = args[1];
+		sw = args[2];
+		sh = args[3];
+		dx = args[4];
+		dy = args[5];
+		dw = args[6];
+		dh = args[7];
+		break;
+	case 5:
+		// img, dx, dy, dw, dh
+		dx = args[0];
+		dy = args[1];
+		dw = args[2];
+		dh = args[3];
+		break;
+	case 3:
+		// img, dx, dy
+		dx = args[0];
+		dy = args[1];
+		dw = sw;
+		dh = sh;
+		break;
+	}
+
+	draw_image(context, surface, source_w, source_h, sx, sy, sw, sh, dx, dy, dw, dh);
+	return JS_UNDEFINED;
+}
+
+/**
+ * Draws many regions of the same image, i.e. sprites from a sprite sheet
+ * or the tiles of a tile map. `rects` contains groups of eight numbers,
+ * `sx, sy, sw, sh, dx, dy, dw, dh`, one group per region to draw.
+ */
+static JSValue nx_canvas_context_2d_draw_images(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	CANVAS_CONTEXT_ARGV0;
+	CANVAS_CONTEXT_DRAWABLE;
+	double source_w, source_h;
+	cairo_surface_t *surface;
+	if (get_image_source(ctx, argv[1], &surface, &source_w, &source_h))
+		return JS_EXCEPTION;
+	size_t size;
+	uint8_t *buffer = JS_GetArrayBuffer(ctx, &size, argv[2]);
+	if (!buffer)
+		return JS_EXCEPTION;
+	uint32_t offset, length;
+	if (JS_ToUint32(ctx, &offset, argv[3]) || JS_ToUint32(ctx, &length, argv[4]))
+		return JS_EXCEPTION;
+	if (offset % sizeof(double) || offset > size || length > (size - offset) / sizeof(double))
+		return JS_ThrowRangeError(ctx, "Rectangles are out of bounds");
+	if (length % 8)
+		return JS_ThrowRangeError(ctx, "Rectangles length must be a multiple of 8");
+
+	const double *r = (const double *)(buffer + offset);
+	const double *end = r + length;
+	for (; r < end; r += 8)
+	{
+		draw_image(context, surface, source_w, source_h, r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7]);
+	}
 	return JS_UNDEFINED;
 }
 
@@ -1664,8 +2030,77 @@ static JSValue nx_canvas_get_height(JSContext *ctx, JSValueConst this_val, int a
 	return JS_NewUint32(ctx, canvas->height);
 }
 
-static JSValue nx_canvas_set_height(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+static JSValue nx_canvas_set_height(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	return JS_UNDEFINED;
+}
+
+static void nx_canvas_pixel_view_free(JSRuntime *rt, void *opaque, void *ptr)
+{
+	// QuickJS may invoke this again with a NULL `ptr` when a
+	// detached ArrayBuffer is finalized, so only release once
+	if (!ptr)
+		return;
+	JSValue *canvas_val = opaque;
+	nx_canvas_t *canvas = JS_GetOpaque(*canvas_val, nx_canvas_class_id);
+	if (canvas)
+		canvas->pixel_view = false;
+	JS_FreeValueRT(rt, *canvas_val);
+	js_free_rt(rt, canvas_val);
+}
+
+static JSValue nx_canvas_get_pixel_view(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_canvas_t *canvas = nx_get_canvas(ctx, argv[0]);
+	if (!canvas)
+		return JS_EXCEPTION;
+	if (canvas->pixel_view)
+	{
+		return JS_ThrowTypeError(ctx, "A pixel view of this canvas has not been released");
+	}
+
+	// The ArrayBuffer holds a reference to the canvas, so that the
+	// backing store is not freed while the ArrayBuffer is still alive
+	JSValue *canvas_val = js_malloc(ctx, sizeof(JSValue));
+	if (!canvas_val)
+		return JS_EXCEPTION;
+	*canvas_val = JS_DupValue(ctx, argv[0]);
+
+	// Make sure that any pending drawing has been written to the buffer
+	cairo_surface_flush(canvas->surface);
+
+	JSValue ab = JS_NewArrayBuffer(ctx, canvas->data, canvas->width * canvas->height * 4, nx_canvas_pixel_view_free, canvas_val, false);
+	if (JS_IsException(ab))
+	{
+		JS_FreeValue(ctx, *canvas_val);
+		js_free(ctx, canvas_val);
+		return ab;
+	}
+	canvas->pixel_view = true;
+	return ab;
+}
+
+static JSValue nx_canvas_release_pixel_view(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
+	nx_canvas_t *canvas = nx_get_canvas(ctx, argv[0]);
+	if (!canvas)
+		return JS_EXCEPTION;
+	size_t size;
+	uint8_t *data = JS_GetArrayBuffer(ctx, &size, argv[1]);
+	if (!data)
+		return JS_EXCEPTION;
+	if (data != canvas->data)
+	{
+		return JS_ThrowTypeError(ctx, "Pixel view does not belong to this canvas");
+	}
+
+	// The pixels were modified outside of cairo, so any cached state is stale
+	cairo_surface_mark_dirty(canvas->surface);
+	nx_canvas_damage(canvas, 0, 0, canvas->width, canvas->height);
+
+	// Detaching invokes `nx_canvas_pixel_view_free()`, which
+	// clears `pixel_view` so that the canvas may be drawn to
+	JS_DetachArrayBuffer(ctx, argv[1]);
 	return JS_UNDEFINED;
 }
 
@@ -1736,7 +2171,7 @@ static JSValue nx_canvas_context_2d_begin_path(JSContext *ctx, JSValueConst this
 
 static JSValue nx_canvas_context_2d_close_path(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
-	CANVAS_CONTEXT_THIS;
+	CANVAS_PATH_THIS;
 	cairo_close_path(cr);
 	return JS_UNDEFINED;
 }
@@ -1752,6 +2187,7 @@ static JSValue nx_canvas_context_2d_clip(JSContext *ctx, JSValueConst this_val,
 static JSValue nx_canvas_context_2d_fill(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
 	CANVAS_CONTEXT_THIS;
+	CANVAS_CONTEXT_DRAWABLE;
 	JSValue path = JS_NULL;
 	JSValue fill_rule = JS_NULL;
 	if (argc == 1)
@@ -1799,7 +2235,11 @@ static JSValue nx_canvas_context_2d_fill(JSContext *ctx, JSValueConst this_val,
 	else
 	{
 		save_path(context);
-		apply_path(ctx, this_val, path);
+		if (apply_path(ctx, context, path))
+		{
+			restore_path(context);
+			return JS_EXCEPTION;
+		}
 		fill(context, false);
 		restore_path(context);
 	}
@@ -1809,6 +2249,7 @@ static JSValue nx_canvas_context_2d_fill(JSContext *ctx, JSValueConst this_val,
 static JSValue nx_canvas_context_2d_stroke(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
 	CANVAS_CONTEXT_THIS;
+	CANVAS_CONTEXT_DRAWABLE;
 	JSValue path = JS_NULL;
 	if (argc == 1)
 	{
@@ -1828,18 +2269,23 @@ static JSValue nx_canvas_context_2d_stroke(JSContext *ctx, JSValueConst this_val
 	else
 	{
 		save_path(context);
-		apply_path(ctx, this_val, path);
+		if (apply_path(ctx, context, path))
+		{
+			restore_path(context);
+			return JS_EXCEPTION;
+		}
 		stroke(context, false);
 		restore_path(context);
 	}
 	return JS_UNDEFINED;
 }
 
-static JSValue nx_canvas_context_2d_save(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+static bool save_state(JSContext *ctx, nx_canvas_context_2d_t *context)
 {
-	CANVAS_CONTEXT_THIS;
-	cairo_save(cr);
 	nx_canvas_context_2d_state_t *state = js_mallocz(ctx, sizeof(nx_canvas_context_2d_state_t));
+	if (!state)
+		return true;
+	cairo_save(context->ctx);
 	memcpy(state, context->state, sizeof(nx_canvas_context_2d_state_t));
 	state->next = context->state;
 	state->font = context->state->font;
@@ -1848,12 +2294,20 @@ static JSValue nx_canvas_context_2d_save(JSContext *ctx, JSValueConst this_val,
 		state->font_string = strdup(context->state->font_string);
 	}
 	context->state = state;
-	return JS_UNDEFINED;
+	return false;
 }
 
-static JSValue nx_canvas_context_2d_restore(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+static JSValue nx_canvas_context_2d_save(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
 	CANVAS_CONTEXT_THIS;
+	if (save_state(ctx, context))
+		return JS_EXCEPTION;
+	return JS_UNDEFINED;
+}
+
+static void restore_state(JSContext *ctx, nx_canvas_context_2d_t *context)
+{
+	cairo_t *cr = context->ctx;
 	if (context->state->next)
 	{
 		cairo_restore(cr);
@@ -1869,23 +2323,35 @@ static JSValue nx_canvas_context_2d_restore(JSContext *ctx, JSValueConst this_va
 		cairo_set_font_face(cr, face->cairo_font);
 		set_font_size(context, context->state->font_size);
 	}
-	return JS_UNDEFINED;
 }
 
-static JSValue nx_canvas_context_2d_fill_rect(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+static JSValue nx_canvas_context_2d_restore(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
 	CANVAS_CONTEXT_THIS;
-	RECT_ARGS;
+	restore_state(ctx, context);
+	return JS_UNDEFINED;
+}
+
+static void fill_rect(nx_canvas_context_2d_t *context, double x, double y, double width, double height)
+{
 	if (width && height)
 	{
 		save_path(context);
-		cairo_rectangle(cr, x, y, width, height);
+		cairo_rectangle(context->ctx, x, y, width, height);
 
 		// TODO: support gradient / pattern
 		fill(context, false);
 
 		restore_path(context);
 	}
+}
+
+static JSValue nx_canvas_context_2d_fill_rect(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	CANVAS_CONTEXT_THIS;
+	CANVAS_CONTEXT_DRAWABLE;
+	RECT_ARGS;
+	fill_rect(context, x, y, width, height);
 	return JS_UNDEFINED;
 }
 
@@ -2461,34 +2927,7 @@ static JSValue nx_canvas_context_2d_get_image_data(JSContext *ctx, JSValueConst
 	// and store in big-endian format
 	for (int y = 0; y < sh; ++y)
 	{
-		uint32_t *row = (uint32_t *)(src + srcStride * (y + sy));
-		for (int x = 0; x < sw; ++x)
-		{
-			int bx = x * 4;
-			uint32_t *pixel = row + x + sx;
-			uint8_t a = *pixel >> 24;
-			uint8_t r = *pixel >> 16;
-			uint8_t g = *pixel >> 8;
-			uint8_t b = *pixel;
-			dst[bx + 3] = a;
-
-			// Performance optimization: fully transparent/opaque pixels can be
-			// processed more efficiently.
-			if (a == 0 || a == 255)
-			{
-				dst[bx + 0] = r;
-				dst[bx + 1] = g;
-				dst[bx + 2] = b;
-			}
-			else
-			{
-				// Undo alpha pre-multiplication
-				float alphaR = (float)255 / a;
-				dst[bx + 0] = (int)((float)r * alphaR);
-				dst[bx + 1] = (int)((float)g * alphaR);
-				dst[bx + 2] = (int)((float)b * alphaR);
-			}
-		}
+		nx_bgra_premultiplied_to_rgba(dst, src + srcStride * (y + sy) + sx * bpp, sw);
 		dst += dstStride;
 	}
 
@@ -2632,6 +3071,54 @@ static JSValue nx_canvas_context_2d_set_text_baseline(JSContext *ctx, JSValueCon
 	return JS_UNDEFINED;
 }
 
+static JSValue nx_canvas_context_2d_get_text_rendering(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	CANVAS_CONTEXT_THIS;
+	const char *v;
+	switch (context->state->text_rendering)
+	{
+	case TEXT_RENDERING_OPTIMIZE_SPEED:
+		v = "optimizeSpeed";
+		break;
+	case TEXT_RENDERING_OPTIMIZE_LEGIBILITY:
+		v = "optimizeLegibility";
+		break;
+	case TEXT_RENDERING_GEOMETRIC_PRECISION:
+		v = "geometricPrecision";
+		break;
+	default:
+		v = "auto";
+		break;
+	}
+	return JS_NewString(ctx, v);
+}
+
+static JSValue nx_canvas_context_2d_set_text_rendering(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	CANVAS_CONTEXT_THIS;
+	const char *str = JS_ToCString(ctx, argv[0]);
+	if (!str)
+		return JS_EXCEPTION;
+	if (strcmp(str, "auto") == 0)
+	{
+		context->state->text_rendering = TEXT_RENDERING_AUTO;
+	}
+	else if (strcmp(str, "optimizeSpeed") == 0)
+	{
+		context->state->text_rendering = TEXT_RENDERING_OPTIMIZE_SPEED;
+	}
+	else if (strcmp(str, "optimizeLegibility") == 0)
+	{
+		context->state->text_rendering = TEXT_RENDERING_OPTIMIZE_LEGIBILITY;
+	}
+	else if (strcmp(str, "geometricPrecision") == 0)
+	{
+		context->state->text_rendering = TEXT_RENDERING_GEOMETRIC_PRECISION;
+	}
+	JS_FreeCString(ctx, str);
+	return JS_UNDEFINED;
+}
+
 static JSValue nx_canvas_context_2d_rotate(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
 	CANVAS_CONTEXT_THIS;
@@ -2727,6 +3214,639 @@ static JSValue nx_canvas_context_2d_translate(JSContext *ctx, JSValueConst this_
 	return JS_UNDEFINED;
 }
 
+/**
+ * Opcodes of the commands written by `Switch.DrawCommandBuffer`. Each command
+ * is stored as its opcode followed by its arguments, all as doubles.
+ *
+ * Keep in sync with `packages/runtime/src/switch/draw-command-buffer.ts`.
+ */
+typedef enum
+{
+	DRAW_COMMAND_SAVE,
+	DRAW_COMMAND_RESTORE,
+	DRAW_COMMAND_BEGIN_PATH,
+	DRAW_COMMAND_CLOSE_PATH,
+	DRAW_COMMAND_MOVE_TO,
+	DRAW_COMMAND_LINE_TO,
+	DRAW_COMMAND_BEZIER_CURVE_TO,
+	DRAW_COMMAND_QUADRATIC_CURVE_TO,
+	DRAW_COMMAND_ARC,
+	DRAW_COMMAND_RECT,
+	DRAW_COMMAND_FILL,
+	DRAW_COMMAND_STROKE,
+	DRAW_COMMAND_FILL_RECT,
+	DRAW_COMMAND_STROKE_RECT,
+	DRAW_COMMAND_CLEAR_RECT,
+	DRAW_COMMAND_TRANSLATE,
+	DRAW_COMMAND_ROTATE,
+	DRAW_COMMAND_SCALE,
+	DRAW_COMMAND_TRANSFORM,
+	DRAW_COMMAND_SET_TRANSFORM,
+	DRAW_COMMAND_RESET_TRANSFORM,
+	DRAW_COMMAND_SET_GLOBAL_ALPHA,
+	DRAW_COMMAND_SET_FILL_COLOR,
+	DRAW_COMMAND_SET_STROKE_COLOR,
+	DRAW_COMMAND_SET_LINE_WIDTH,
+	DRAW_COMMAND_DRAW_IMAGE,
+	DRAW_COMMAND_DRAW_IMAGE_SCALED,
+	DRAW_COMMAND_DRAW_IMAGE_SUBRECT,
+	DRAW_COMMAND_COUNT
+} draw_command_t;
+
+// Number of arguments of each draw command
+static const uint8_t draw_command_arg_count[DRAW_COMMAND_COUNT] = {
+	[DRAW_COMMAND_MOVE_TO] = 2,
+	[DRAW_COMMAND_LINE_TO] = 2,
+	[DRAW_COMMAND_BEZIER_CURVE_TO] = 6,
+	[DRAW_COMMAND_QUADRATIC_CURVE_TO] = 4,
+	[DRAW_COMMAND_ARC] = 6,
+	[DRAW_COMMAND_RECT] = 4,
+	[DRAW_COMMAND_FILL_RECT] = 4,
+	[DRAW_COMMAND_STROKE_RECT] = 4,
+	[DRAW_COMMAND_CLEAR_RECT] = 4,
+	[DRAW_COMMAND_TRANSLATE] = 2,
+	[DRAW_COMMAND_ROTATE] = 1,
+	[DRAW_COMMAND_SCALE] = 2,
+	[DRAW_COMMAND_TRANSFORM] = 6,
+	[DRAW_COMMAND_SET_TRANSFORM] = 6,
+	[DRAW_COMMAND_SET_GLOBAL_ALPHA] = 1,
+	[DRAW_COMMAND_SET_FILL_COLOR] = 4,
+	[DRAW_COMMAND_SET_STROKE_COLOR] = 4,
+	[DRAW_COMMAND_SET_LINE_WIDTH] = 1,
+	// The first argument of the image commands is an index into the images array
+	[DRAW_COMMAND_DRAW_IMAGE] = 3,
+	[DRAW_COMMAND_DRAW_IMAGE_SCALED] = 5,
+	[DRAW_COMMAND_DRAW_IMAGE_SUBRECT] = 9,
+};
+
+typedef struct
+{
+	cairo_surface_t *surface;
+	double width;
+	double height;
+} draw_command_image_t;
+
+// Resolves the image sources referenced by the image commands
+static bool get_draw_command_images(JSContext *ctx, JSValueConst array, draw_command_image_t **images, uint32_t *count)
+{
+	*images = NULL;
+	JSValue length_val = JS_GetPropertyStr(ctx, array, "length");
+	int err = JS_ToUint32(ctx, count, length_val);
+	JS_FreeValue(ctx, length_val);
+	if (err)
+		return true;
+	if (*count == 0)
+		return false;
+
+	*images = js_malloc(ctx, *count * sizeof(draw_command_image_t));
+	if (!*images)
+		return true;
+	for (uint32_t i = 0; i < *count; i++)
+	{
+		JSValue v = JS_GetPropertyUint32(ctx, array, i);
+		draw_command_image_t *image = &(*images)[i];
+		err = get_image_source(ctx, v, &image->surface, &image->width, &image->height);
+		JS_FreeValue(ctx, v);
+		if (err)
+		{
+			js_free(ctx, *images);
+			*images = NULL;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Checks that the commands are well formed, so that they can then be
+ * executed without any further checks (including on worker threads).
+ * `min_depth` is set to the lowest `save()` depth that is reached relative
+ * to the start, which is negative when the commands restore state that
+ * was saved before they were recorded.
+ */
+static JSValue validate_draw_commands(JSContext *ctx, const double *commands, uint32_t length, uint32_t image_count, int32_t *min_depth)
+{
+	int32_t depth = 0;
+	*min_depth = 0;
+	const double *p = commands;
+	const double *end = commands + length;
+	while (p < end)
+	{
+		double op = *p++;
+		if (!(op >= 0 && op < DRAW_COMMAND_COUNT))
+			return JS_ThrowTypeError(ctx, "Invalid draw command: %g", op);
+		draw_command_t command = (draw_command_t)op;
+		if (end - p < draw_command_arg_count[command])
+			return JS_ThrowRangeError(ctx, "Draw command is missing arguments");
+		const double *a = p;
+		p += draw_command_arg_count[command];
+
+		if (command >= DRAW_COMMAND_DRAW_IMAGE && !(a[0] >= 0 && a[0] < image_count))
+			return JS_ThrowRangeError(ctx, "Invalid image index: %g", a[0]);
+		if (command == DRAW_COMMAND_ARC && a[2] < 0)
+			return JS_ThrowRangeError(ctx, "The radius provided is negative.");
+		if (command == DRAW_COMMAND_SAVE)
+			depth++;
+		else if (command == DRAW_COMMAND_RESTORE)
+			*min_depth = min(*min_depth, --depth);
+	}
+	return JS_UNDEFINED;
+}
+
+// `save()` / `restore()` for the bands of a tiled flush. These run on worker
+// threads, so the states can not be allocated from the JS runtime. The font
+// is left alone, since there are no text commands.
+static bool save_band_state(nx_canvas_context_2d_t *context)
+{
+	nx_canvas_context_2d_state_t *state = malloc(sizeof(nx_canvas_context_2d_state_t));
+	if (!state)
+		return true;
+	cairo_save(context->ctx);
+	memcpy(state, context->state, sizeof(nx_canvas_context_2d_state_t));
+	state->font_string = NULL;
+	state->next = context->state;
+	context->state = state;
+	return false;
+}
+
+static void restore_band_state(nx_canvas_context_2d_t *context)
+{
+	if (context->state->next)
+	{
+		cairo_restore(context->ctx);
+		nx_canvas_context_2d_state_t *prev = context->state;
+		context->state = prev->next;
+		free(prev);
+	}
+}
+
+/**
+ * Executes validated draw commands. `ctx` is `NULL` when drawing a band of
+ * a tiled flush on a worker thread. When `draw` is `false`, only the state
+ * (transform, styles, path and `save()` stack) is updated and nothing is
+ * drawn. Returns `true` if a `save()` failed to allocate.
+ */
+static bool execute_draw_commands(JSContext *ctx, nx_canvas_context_2d_t *context,
+								  const double *commands, uint32_t length,
+								  const draw_command_image_t *images, bool draw)
+{
+	cairo_t *cr = context->ctx;
+	const double *p = commands;
+	const double *end = commands + length;
+	while (p < end)
+	{
+		draw_command_t command = (draw_command_t)*p++;
+		const double *a = p;
+		p += draw_command_arg_count[command];
+		const draw_command_image_t *image = command >= DRAW_COMMAND_DRAW_IMAGE ? &images[(uint32_t)a[0]] : NULL;
+
+		switch (command)
+		{
+		case DRAW_COMMAND_SAVE:
+			if (ctx ? save_state(ctx, context) : save_band_state(context))
+				return true;
+			break;
+		case DRAW_COMMAND_RESTORE:
+			if (ctx)
+				restore_state(ctx, context);
+			else
+				restore_band_state(context);
+			break;
+		case DRAW_COMMAND_BEGIN_PATH:
+			cairo_new_path(cr);
+			break;
+		case DRAW_COMMAND_CLOSE_PATH:
+			cairo_close_path(cr);
+			break;
+		case DRAW_COMMAND_MOVE_TO:
+			cairo_move_to(cr, a[0], a[1]);
+			break;
+		case DRAW_COMMAND_LINE_TO:
+			cairo_line_to(cr, a[0], a[1]);
+			break;
+		case DRAW_COMMAND_BEZIER_CURVE_TO:
+			cairo_curve_to(cr, a[0], a[1], a[2], a[3], a[4], a[5]);
+			break;
+		case DRAW_COMMAND_QUADRATIC_CURVE_TO:
+			quadratic_curve_to(cr, a[0], a[1], a[2], a[3]);
+			break;
+		case DRAW_COMMAND_ARC:
+			arc(cr, a[0], a[1], a[2], a[3], a[4], a[5] != 0);
+			break;
+		case DRAW_COMMAND_RECT:
+			rect(cr, a[0], a[1], a[2], a[3]);
+			break;
+		case DRAW_COMMAND_FILL:
+			if (draw)
+				fill(context, true);
+			break;
+		case DRAW_COMMAND_STROKE:
+			if (draw)
+				stroke(context, true);
+			break;
+		case DRAW_COMMAND_FILL_RECT:
+			if (draw)
+				fill_rect(context, a[0], a[1], a[2], a[3]);
+			break;
+		case DRAW_COMMAND_STROKE_RECT:
+			if (draw)
+				stroke_rect(context, a[0], a[1], a[2], a[3]);
+			break;
+		case DRAW_COMMAND_CLEAR_RECT:
+			if (draw)
+				clear_rect(context, a[0], a[1], a[2], a[3]);
+			break;
+		case DRAW_COMMAND_TRANSLATE:
+			cairo_translate(cr, a[0], a[1]);
+			break;
+		case DRAW_COMMAND_ROTATE:
+			cairo_rotate(cr, a[0]);
+			break;
+		case DRAW_COMMAND_SCALE:
+			cairo_scale(cr, a[0], a[1]);
+			break;
+		case DRAW_COMMAND_TRANSFORM:
+		case DRAW_COMMAND_SET_TRANSFORM:
+		{
+			cairo_matrix_t matrix;
+			cairo_matrix_init(&matrix, a[0], a[1], a[2], a[3], a[4], a[5]);
+			if (command == DRAW_COMMAND_SET_TRANSFORM)
+				cairo_set_matrix(cr, &matrix);
+			else
+				cairo_transform(cr, &matrix);
+			break;
+		}
+		case DRAW_COMMAND_RESET_TRANSFORM:
+			cairo_identity_matrix(cr);
+			break;
+		case DRAW_COMMAND_SET_GLOBAL_ALPHA:
+			if (a[0] >= 0 && a[0] <= 1)
+				context->state->global_alpha = a[0];
+			break;
+		case DRAW_COMMAND_SET_FILL_COLOR:
+			context->state->fill.r = a[0] / 255.;
+			context->state->fill.g = a[1] / 255.;
+			context->state->fill.b = a[2] / 255.;
+			context->state->fill.a = a[3];
+			break;
+		case DRAW_COMMAND_SET_STROKE_COLOR:
+			context->state->stroke.r = a[0] / 255.;
+			context->state->stroke.g = a[1] / 255.;
+			context->state->stroke.b = a[2] / 255.;
+			context->state->stroke.a = a[3];
+			break;
+		case DRAW_COMMAND_SET_LINE_WIDTH:
+			cairo_set_line_width(cr, a[0]);
+			break;
+		case DRAW_COMMAND_DRAW_IMAGE:
+			if (draw)
+				draw_image(context, image->surface, image->width, image->height,
+						   0, 0, image->width, image->height,
+						   a[1], a[2], image->width, image->height);
+			break;
+		case DRAW_COMMAND_DRAW_IMAGE_SCALED:
+			if (draw)
+				draw_image(context, image->surface, image->width, image->height,
+						   0, 0, image->width, image->height,
+						   a[1], a[2], a[3], a[4]);
+			break;
+		case DRAW_COMMAND_DRAW_IMAGE_SUBRECT:
+			if (draw)
+				draw_image(context, image->surface, image->width, image->height,
+						   a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8]);
+			break;
+		case DRAW_COMMAND_COUNT:
+			break;
+		}
+	}
+	return false;
+}
+
+/**
+ * Tiled flush. The canvas is split into horizontal bands, and the commands
+ * are replayed once per band, each with its own cairo context which draws
+ * into (and is clipped to) that band of the canvas pixels. The bands are
+ * drawn by the thread pool workers, and by the JS thread itself, so that
+ * it never waits on workers that are busy with other work. All the bands
+ * have been drawn by the time `flush()` returns.
+ */
+
+// Minimum number of rows in a band, so that replaying
+// the commands per band costs less than it saves
+#define DRAW_BAND_MIN_HEIGHT 64
+
+typedef struct
+{
+	// Covers the whole canvas, but its surface is only the band's rows.
+	// Since it has the same size as the canvas, the damage that is
+	// collected for the band is already in canvas coordinates.
+	nx_canvas_t canvas;
+	bool failed;
+} draw_band_t;
+
+typedef struct
+{
+	// Only read while there are bands left to draw
+	const double *commands;
+	uint32_t length;
+	const draw_command_image_t *images;
+	nx_canvas_t *canvas;
+	nx_canvas_context_2d_state_t state;
+	cairo_matrix_t matrix;
+	cairo_rectangle_list_t *clip;
+	cairo_path_t *path;
+	cairo_operator_t op;
+	cairo_fill_rule_t fill_rule;
+	cairo_line_cap_t line_cap;
+	cairo_line_join_t line_join;
+	double line_width;
+	double miter_limit;
+	double *dashes;
+	int num_dashes;
+	double dash_offset;
+
+	draw_band_t *bands;
+	uint32_t band_count;
+	uint32_t band_height;
+	atomic_uint next_band;
+	atomic_uint done_bands;
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+
+	// Held by the JS thread and by each queued job, since
+	// jobs may only start running after every band is done
+	atomic_int refs;
+	nx_thread_pool_job_t jobs[];
+} draw_tiled_t;
+
+static void draw_band(draw_tiled_t *t, uint32_t index)
+{
+	draw_band_t *band = &t->bands[index];
+	uint32_t y = index * t->band_height;
+	uint32_t height = min(t->band_height, t->canvas->height - y);
+	size_t stride = t->canvas->width * 4;
+
+	band->canvas.width = t->canvas->width;
+	band->canvas.height = t->canvas->height;
+	band->canvas.data = t->canvas->data;
+	band->canvas.surface = cairo_image_surface_create_for_data(
+		t->canvas->data + y * stride, CAIRO_FORMAT_ARGB32,
+		t->canvas->width, height, stride);
+	cairo_surface_set_device_offset(band->canvas.surface, 0, -(double)y);
+
+	nx_canvas_context_2d_state_t state = t->state;
+	state.next = NULL;
+	nx_canvas_context_2d_t context = {
+		.canvas = &band->canvas,
+		.ctx = cairo_create(band->canvas.surface),
+		.state = &state,
+	};
+	cairo_t *cr = context.ctx;
+
+	cairo_set_matrix(cr, &t->matrix);
+	for (int i = 0; i < t->clip->num_rectangles; i++)
+	{
+		cairo_rectangle_t *r = &t->clip->rectangles[i];
+		cairo_rectangle(cr, r->x, r->y, r->width, r->height);
+	}
+	cairo_clip(cr);
+	cairo_append_path(cr, t->path);
+	cairo_set_operator(cr, t->op);
+	cairo_set_fill_rule(cr, t->fill_rule);
+	cairo_set_line_cap(cr, t->line_cap);
+	cairo_set_line_join(cr, t->line_join);
+	cairo_set_line_width(cr, t->line_width);
+	cairo_set_miter_limit(cr, t->miter_limit);
+	cairo_set_dash(cr, t->dashes, t->num_dashes, t->dash_offset);
+
+	band->failed = execute_draw_commands(NULL, &context, t->commands, t->length, t->images, true);
+
+	while (context.state->next)
+		restore_band_state(&context);
+	cairo_destroy(cr);
+	cairo_surface_destroy(band->canvas.surface);
+	band->canvas.surface = NULL;
+}
+
+static void draw_bands(draw_tiled_t *t)
+{
+	uint32_t i;
+	while ((i = atomic_fetch_add(&t->next_band, 1)) < t->band_count)
+	{
+		draw_band(t, i);
+		if (atomic_fetch_add(&t->done_bands, 1) + 1 == t->band_count)
+		{
+			pthread_mutex_lock(&t->lock);
+			pthread_cond_signal(&t->done);
+			pthread_mutex_unlock(&t->lock);
+		}
+	}
+}
+
+static void release_tiled(draw_tiled_t *t)
+{
+	if (atomic_fetch_sub(&t->refs, 1) == 1)
+	{
+		pthread_mutex_destroy(&t->lock);
+		pthread_cond_destroy(&t->done);
+		free(t);
+	}
+}
+
+static void draw_bands_job(void *arg)
+{
+	draw_tiled_t *t = arg;
+	draw_bands(t);
+	release_tiled(t);
+}
+
+/**
+ * Draws the commands in bands on the thread pool. Returns `false` (without
+ * drawing) when the commands can not be drawn tiled, in which case they
+ * need to be executed on the canvas context instead.
+ */
+static bool flush_draw_commands_tiled(JSContext *ctx, nx_canvas_context_2d_t *context,
+									  const double *commands, uint32_t length,
+									  const draw_command_image_t *images, uint32_t image_count,
+									  JSValue *ret)
+{
+	cairo_t *cr = context->ctx;
+	nx_canvas_t *canvas = context->canvas;
+	nx_context_t *nx_ctx = JS_GetContextOpaque(ctx);
+	if (!nx_ctx->thpool || canvas->height < DRAW_BAND_MIN_HEIGHT * 2)
+		return false;
+
+	// Drawing a canvas onto itself would read rows that other bands are writing
+	for (uint32_t i = 0; i < image_count; i++)
+	{
+		if (images[i].surface == canvas->surface)
+			return false;
+	}
+
+	cairo_rectangle_list_t *clip = cairo_copy_clip_rectangle_list(cr);
+	if (clip->status != CAIRO_STATUS_SUCCESS)
+	{
+		cairo_rectangle_list_destroy(clip);
+		return false;
+	}
+	cairo_path_t *path = cairo_copy_path(cr);
+	if (path->status != CAIRO_STATUS_SUCCESS)
+	{
+		cairo_path_destroy(path);
+		cairo_rectangle_list_destroy(clip);
+		return false;
+	}
+
+	int num_jobs = nx_thread_pool_num_threads(nx_ctx->thpool);
+	uint32_t band_count = min((uint32_t)(num_jobs + 1) * 2, canvas->height / DRAW_BAND_MIN_HEIGHT);
+	uint32_t band_height = (canvas->height + band_count - 1) / band_count;
+	band_count = (canvas->height + band_height - 1) / band_height;
+	num_jobs = min(num_jobs, (int)band_count - 1);
+
+	draw_tiled_t *t = calloc(1, sizeof(draw_tiled_t) + num_jobs * sizeof(nx_thread_pool_job_t));
+	draw_band_t *bands = calloc(band_count, sizeof(draw_band_t));
+	int num_dashes = cairo_get_dash_count(cr);
+	double *dashes = num_dashes ? malloc(num_dashes * sizeof(double)) : NULL;
+	if (!t || !bands || (num_dashes && !dashes))
+	{
+		free(t);
+		free(bands);
+		free(dashes);
+		cairo_path_destroy(path);
+		cairo_rectangle_list_destroy(clip);
+		*ret = JS_ThrowOutOfMemory(ctx);
+		return true;
+	}
+
+	t->commands = commands;
+	t->length = length;
+	t->images = images;
+	t->canvas = canvas;
+	t->state = *context->state;
+	cairo_get_matrix(cr, &t->matrix);
+	t->clip = clip;
+	t->path = path;
+	t->op = cairo_get_operator(cr);
+	t->fill_rule = cairo_get_fill_rule(cr);
+	t->line_cap = cairo_get_line_cap(cr);
+	t->line_join = cairo_get_line_join(cr);
+	t->line_width = cairo_get_line_width(cr);
+	t->miter_limit = cairo_get_miter_limit(cr);
+	t->dashes = dashes;
+	t->num_dashes = num_dashes;
+	cairo_get_dash(cr, dashes, &t->dash_offset);
+	t->bands = bands;
+	t->band_count = band_count;
+	t->band_height = band_height;
+	atomic_init(&t->next_band, 0);
+	atomic_init(&t->done_bands, 0);
+	atomic_init(&t->refs, 1);
+	pthread_mutex_init(&t->lock, NULL);
+	pthread_cond_init(&t->done, NULL);
+
+	// Workers only read the pixels of the sources, so make sure that
+	// everything that has been drawn so far has been written out
+	cairo_surface_flush(canvas->surface);
+	for (uint32_t i = 0; i < image_count; i++)
+	{
+		if (images[i].surface)
+			cairo_surface_flush(images[i].surface);
+	}
+
+	for (int i = 0; i < num_jobs; i++)
+	{
+		t->jobs[i].fn = draw_bands_job;
+		t->jobs[i].arg = t;
+		atomic_fetch_add(&t->refs, 1);
+		if (nx_thread_pool_add_work(nx_ctx->thpool, &t->jobs[i], NX_THREAD_POOL_PRIORITY_HIGH))
+			atomic_fetch_sub(&t->refs, 1);
+	}
+
+	draw_bands(t);
+	pthread_mutex_lock(&t->lock);
+	while (atomic_load(&t->done_bands) < band_count)
+		pthread_cond_wait(&t->done, &t->lock);
+	pthread_mutex_unlock(&t->lock);
+
+	bool failed = false;
+	for (uint32_t i = 0; i < band_count; i++)
+	{
+		nx_damage_t *damage = &bands[i].canvas.damage;
+		for (uint32_t j = 0; j < damage->count; j++)
+			nx_damage_add(&canvas->damage, &damage->rects[j]);
+		failed |= bands[i].failed;
+	}
+	cairo_surface_mark_dirty(canvas->surface);
+
+	free(bands);
+	free(dashes);
+	cairo_path_destroy(path);
+	cairo_rectangle_list_destroy(clip);
+	release_tiled(t);
+
+	// Leave the context in the same state as if the commands had been executed on it
+	if (execute_draw_commands(ctx, context, commands, length, images, false))
+		*ret = JS_EXCEPTION;
+	else if (failed)
+		*ret = JS_ThrowOutOfMemory(ctx);
+	return true;
+}
+
+/**
+ * Executes the commands in the first `length` doubles of the `ArrayBuffer`,
+ * so that a batch of drawing operations costs a single call into native code
+ * rather than one call (and argument conversion) per operation.
+ */
+static JSValue nx_canvas_context_2d_flush_commands(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	CANVAS_CONTEXT_ARGV0;
+	CANVAS_CONTEXT_DRAWABLE;
+	size_t size;
+	const double *commands = (const double *)JS_GetArrayBuffer(ctx, &size, argv[1]);
+	if (!commands)
+		return JS_EXCEPTION;
+	uint32_t length;
+	if (JS_ToUint32(ctx, &length, argv[2]))
+		return JS_EXCEPTION;
+	if (length > size / sizeof(double))
+		return JS_ThrowRangeError(ctx, "Command buffer length is out of bounds");
+	bool tiled = argc > 4 && JS_ToBool(ctx, argv[4]);
+
+	draw_command_image_t *images;
+	uint32_t image_count;
+	if (get_draw_command_images(ctx, argv[3], &images, &image_count))
+		return JS_EXCEPTION;
+
+	int32_t min_depth;
+	JSValue ret = validate_draw_commands(ctx, commands, length, image_count, &min_depth);
+	if (!JS_IsException(ret))
+	{
+		// Bands start from the current state, so they can not restore past it
+		bool drawn = tiled && min_depth >= 0 &&
+					 flush_draw_commands_tiled(ctx, context, commands, length, images, image_count, &ret);
+		if (!drawn && execute_draw_commands(ctx, context, commands, length, images, true))
+			ret = JS_EXCEPTION;
+	}
+
+	js_free(ctx, images);
+	return ret;
+}
+
+void nx_canvas_path_init_proto(JSContext *ctx, JSValueConst proto)
+{
+	JSAtom atom;
+	NX_DEF_FUNC(proto, "arc", nx_canvas_context_2d_arc, 5);
+	NX_DEF_FUNC(proto, "arcTo", nx_canvas_context_2d_arc_to, 5);
+	NX_DEF_FUNC(proto, "bezierCurveTo", nx_canvas_context_2d_bezier_curve_to, 6);
+	NX_DEF_FUNC(proto, "closePath", nx_canvas_context_2d_close_path, 0);
+	NX_DEF_FUNC(proto, "ellipse", nx_canvas_context_2d_ellipse, 7);
+	NX_DEF_FUNC(proto, "lineTo", nx_canvas_context_2d_line_to, 2);
+	NX_DEF_FUNC(proto, "moveTo", nx_canvas_context_2d_move_to, 2);
+	NX_DEF_FUNC(proto, "quadraticCurveTo", nx_canvas_context_2d_quadratic_curve_to, 4);
+	NX_DEF_FUNC(proto, "rect", nx_canvas_context_2d_rect, 4);
+	NX_DEF_FUNC(proto, "roundRect", nx_canvas_context_2d_round_rect, 4);
+}
+
 static JSValue nx_canvas_context_2d_init_class(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
 	JSAtom atom;
@@ -2742,31 +3862,22 @@ static JSValue nx_canvas_context_2d_init_class(JSContext *ctx, JSValueConst this
 	NX_DEF_GETSET(proto, "miterLimit", nx_canvas_context_2d_get_miter_limit, nx_canvas_context_2d_set_miter_limit);
 	NX_DEF_GETSET(proto, "textAlign", nx_canvas_context_2d_get_text_align, nx_canvas_context_2d_set_text_align);
 	NX_DEF_GETSET(proto, "textBaseline", nx_canvas_context_2d_get_text_baseline, nx_canvas_context_2d_set_text_baseline);
-	NX_DEF_FUNC(proto, "arc", nx_canvas_context_2d_arc, 5);
-	NX_DEF_FUNC(proto, "arcTo", nx_canvas_context_2d_arc_to, 5);
+	NX_DEF_GETSET(proto, "textRendering", nx_canvas_context_2d_get_text_rendering, nx_canvas_context_2d_set_text_rendering);
 	NX_DEF_FUNC(proto, "beginPath", nx_canvas_context_2d_begin_path, 0);
-	NX_DEF_FUNC(proto, "bezierCurveTo", nx_canvas_context_2d_bezier_curve_to, 6);
 	NX_DEF_FUNC(proto, "clearRect", nx_canvas_context_2d_clear_rect, 4);
-	NX_DEF_FUNC(proto, "closePath", nx_canvas_context_2d_close_path, 0);
 	NX_DEF_FUNC(proto, "clip", nx_canvas_context_2d_clip, 0);
 	NX_DEF_FUNC(proto, "drawImage", nx_canvas_context_2d_draw_image, 3);
-	NX_DEF_FUNC(proto, "ellipse", nx_canvas_context_2d_ellipse, 7);
 	NX_DEF_FUNC(proto, "fill", nx_canvas_context_2d_fill, 0);
 	NX_DEF_FUNC(proto, "fillRect", nx_canvas_context_2d_fill_rect, 4);
 	NX_DEF_FUNC(proto, "fillText", nx_canvas_context_2d_fill_text, 3);
 	NX_DEF_FUNC(proto, "getLineDash", nx_canvas_context_2d_get_line_dash, 0);
 	NX_DEF_FUNC(proto, "isPointInPath", nx_canvas_context_2d_is_point_in_path, 2);
 	NX_DEF_FUNC(proto, "isPointInStroke", nx_canvas_context_2d_is_point_in_stroke, 2);
-	NX_DEF_FUNC(proto, "lineTo", nx_canvas_context_2d_line_to, 2);
 	NX_DEF_FUNC(proto, "measureText", nx_canvas_context_2d_measure_text, 1);
-	NX_DEF_FUNC(proto, "moveTo", nx_canvas_context_2d_move_to, 2);
 	NX_DEF_FUNC(proto, "putImageData", nx_canvas_context_2d_put_image_data, 3);
-	NX_DEF_FUNC(proto, "quadraticCurveTo", nx_canvas_context_2d_quadratic_curve_to, 4);
-	NX_DEF_FUNC(proto, "rect", nx_canvas_context_2d_rect, 4);
 	NX_DEF_FUNC(proto, "resetTransform", nx_canvas_context_2d_reset_transform, 0);
 	NX_DEF_FUNC(proto, "restore", nx_canvas_context_2d_restore, 0);
 	NX_DEF_FUNC(proto, "rotate", nx_canvas_context_2d_rotate, 1);
-	NX_DEF_FUNC(proto, "roundRect", nx_canvas_context_2d_round_rect, 4);
 	NX_DEF_FUNC(proto, "save", nx_canvas_context_2d_save, 0);
 	NX_DEF_FUNC(proto, "scale", nx_canvas_context_2d_scale, 2);
 	NX_DEF_FUNC(proto, "setLineDash", nx_canvas_context_2d_set_line_dash, 1);
@@ -2776,6 +3887,7 @@ static JSValue nx_canvas_context_2d_init_class(JSContext *ctx, JSValueConst this
 	NX_DEF_FUNC(proto, "strokeText", nx_canvas_context_2d_stroke_text, 3);
 	NX_DEF_FUNC(proto, "transform", nx_canvas_context_2d_transform, 6);
 	NX_DEF_FUNC(proto, "translate", nx_canvas_context_2d_translate, 2);
+	nx_canvas_path_init_proto(ctx, proto);
 	JS_FreeValue(ctx, proto);
 	return JS_UNDEFINED;
 }
@@ -2812,6 +3924,7 @@ static JSValue nx_canvas_context_2d_new(JSContext *ctx, JSValueConst this_val, i
 	state->image_smoothing_enabled = true;
 	state->text_align = TEXT_ALIGN_START;
 	state->text_baseline = TEXT_BASELINE_ALPHABETIC;
+	state->text_rendering = TEXT_RENDERING_AUTO;
 	cairo_set_line_width(context->ctx, 1.);
 
 	JS_SetOpaque(obj, context);
@@ -2838,8 +3951,12 @@ static void finalizer_canvas(JSRuntime *rt, JSValue val)
 static const JSCFunctionListEntry init_function_list[] = {
 	JS_CFUNC_DEF("canvasNew", 0, nx_canvas_new),
 	JS_CFUNC_DEF("canvasInitClass", 0, nx_canvas_init_class),
+	JS_CFUNC_DEF("canvasGetPixelView", 0, nx_canvas_get_pixel_view),
+	JS_CFUNC_DEF("canvasReleasePixelView", 0, nx_canvas_release_pixel_view),
 	JS_CFUNC_DEF("canvasContext2dNew", 0, nx_canvas_context_2d_new),
 	JS_CFUNC_DEF("canvasContext2dInitClass", 0, nx_canvas_context_2d_init_class),
+	JS_CFUNC_DEF("canvasContext2dDrawImages", 0, nx_canvas_context_2d_draw_images),
+	JS_CFUNC_DEF("canvasContext2dFlushCommands", 0, nx_canvas_context_2d_flush_commands),
 	JS_CFUNC_DEF("canvasContext2dGetImageData", 0, nx_canvas_context_2d_get_image_data),
 	JS_CFUNC_DEF("canvasContext2dGetTransform", 0, nx_canvas_context_2d_get_transform),
 	JS_CFUNC_DEF("canvasContext2dGetFont", 0, nx_canvas_context_2d_get_font),
@@ -3,6 +3,33 @@
 #include <harfbuzz/hb.h>
 #include "types.h"
 
+// Maximum number of separate rectangles tracked in a damage region.
+// Further rectangles are merged into the existing ones.
+#define NX_DAMAGE_MAX_RECTS 8
+
+/**
+ * Rectangle in device (pixel) space, `x2` and `y2` are exclusive.
+ */
+typedef struct
+{
+	int32_t x1;
+	int32_t y1;
+	int32_t x2;
+	int32_t y2;
+} nx_rect_t;
+
+/**
+ * Approximation of a set of modified pixels, as a small list of
+ * rectangles which contains all of them.
+ */
+typedef struct
+{
+	nx_rect_t rects[NX_DAMAGE_MAX_RECTS];
+	uint32_t count;
+} nx_damage_t;
+
+void nx_damage_add(nx_damage_t *damage, const nx_rect_t *rect);
+
 /**
  * `Screen` / `OffscreenCanvas` / `Image` / `ImageBitmap`
  */
@@ -12,10 +39,21 @@ typedef struct
 	uint32_t height;
 	uint8_t *data;
 	cairo_surface_t *surface;
+
+	// Regions of `data` which have been drawn to since the
+	// damage was last reset (i.e. since the last presented frame)
+	nx_damage_t damage;
+
+	// Set while an ArrayBuffer returned by `getPixelView()` aliases
+	// `data`, during which the canvas may not be drawn to
+	bool pixel_view;
 } nx_canvas_t;
 
 nx_canvas_t *nx_get_canvas(JSContext *ctx, JSValueConst obj);
 
+// Marks a region of the canvas (in device space) as modified
+void nx_canvas_damage(nx_canvas_t *canvas, int32_t x, int32_t y, int32_t width, int32_t height);
+
 typedef struct nx_rgba_s
 {
 	double r;
@@ -43,6 +81,14 @@ typedef enum
 	TEXT_ALIGN_END
 } text_align_t;
 
+typedef enum
+{
+	TEXT_RENDERING_AUTO,
+	TEXT_RENDERING_OPTIMIZE_SPEED,
+	TEXT_RENDERING_OPTIMIZE_LEGIBILITY,
+	TEXT_RENDERING_GEOMETRIC_PRECISION
+} text_rendering_t;
+
 /*
  * State struct.
  *
@@ -68,6 +114,7 @@ typedef struct nx_canvas_context_2d_state_s
 	const char *font_string;
 	text_baseline_t text_baseline;
 	text_align_t text_align;
+	text_rendering_t text_rendering;
 	FT_Face ft_face;
 	hb_font_t *hb_font;
 	bool image_smoothing_enabled;
@@ -88,4 +135,7 @@ typedef struct nx_canvas_context_2d_s
 
 nx_canvas_context_2d_t *nx_get_canvas_context_2d(JSContext *ctx, JSValueConst obj);
 
+// Defines the `CanvasPath` methods (`moveTo()`, `arc()`, etc.) on `proto`
+void nx_canvas_path_init_proto(JSContext *ctx, JSValueConst proto);
+
 void nx_init_canvas(JSContext *ctx, JSValueConst init_obj);
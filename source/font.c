@@ -2,6 +2,8 @@
 #include <harfbuzz/hb-ot.h>
 #include "types.h"
 #include "font.h"
+#include "glyph-atlas.h"
+#include "glyph-cache.h"
 
 static JSClassID nx_font_face_class_id;
 
@@ -69,6 +71,7 @@ static void finalizer_font_face(JSRuntime *rt, JSValue val)
 	{
 		if (context->hb_font)
 		{
+			nx_glyph_cache_remove_font(context->hb_font);
 			hb_font_destroy(context->hb_font);
 		}
 		if (context->cairo_font)
@@ -77,6 +80,7 @@ static void finalizer_font_face(JSRuntime *rt, JSValue val)
 		}
 		if (context->ft_face)
 		{
+			nx_glyph_atlas_remove_face(context->ft_face);
 			FT_Done_Face(context->ft_face);
 		}
 		js_free_rt(rt, context->font_buffer);
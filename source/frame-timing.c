@@ -0,0 +1,172 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "types.h"
+#include "frame-timing.h"
+#include "timers.h"
+
+static const char *phase_names[NX_FRAME_PHASE_COUNT] = {
+	"poll",
+	"timers",
+	"async",
+	"jobs",
+	"handler",
+	"present",
+};
+
+void nx_frame_timing_mark(nx_frame_timing_t *timing, enum nx_frame_phase phase)
+{
+	u64 now = nx_timers_now();
+	if (timing->last_mark)
+		timing->current[phase] += now - timing->last_mark;
+	timing->last_mark = now;
+}
+
+void nx_frame_timing_commit(nx_frame_timing_t *timing)
+{
+	u64 now = timing->last_mark;
+
+	// The first frame has no previous frame to measure the interval from
+	if (timing->last_commit)
+	{
+		memcpy(timing->phases[timing->index], timing->current, sizeof(timing->current));
+		timing->intervals[timing->index] = now - timing->last_commit;
+		timing->index = (timing->index + 1) % NX_FRAME_TIMING_HISTORY;
+		if (timing->count < NX_FRAME_TIMING_HISTORY)
+			timing->count++;
+		timing->frames++;
+	}
+
+	memset(timing->current, 0, sizeof(timing->current));
+	timing->last_commit = now;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a;
+	u64 y = *(const u64 *)b;
+	return x < y ? -1 : x > y;
+}
+
+// Nearest-rank percentile of sorted `values`
+static u64 percentile(const u64 *values, u32 count, double p)
+{
+	u32 rank = (u32)ceil(p * count);
+	return values[rank > 0 ? rank - 1 : 0];
+}
+
+static inline double ns_to_ms(u64 ns)
+{
+	return ns / 1e6;
+}
+
+/**
+ * Creates an object with the statistics (in milliseconds) of `values`,
+ * which must contain `count` entries. `values` is sorted in place.
+ */
+static JSValue nx_frame_timing_stats_new(JSContext *ctx, u64 *values, u32 count, u64 last)
+{
+	JSValue obj = JS_NewObject(ctx);
+	double mean = 0, p50 = 0, p95 = 0, p99 = 0, max = 0;
+	if (count > 0)
+	{
+		u64 sum = 0;
+		for (u32 i = 0; i < count; i++)
+			sum += values[i];
+		qsort(values, count, sizeof(u64), compare_u64);
+		mean = ns_to_ms(sum) / count;
+		p50 = ns_to_ms(percentile(values, count, 0.50));
+		p95 = ns_to_ms(percentile(values, count, 0.95));
+		p99 = ns_to_ms(percentile(values, count, 0.99));
+		max = ns_to_ms(values[count - 1]);
+	}
+	JS_SetPropertyStr(ctx, obj, "last", JS_NewFloat64(ctx, ns_to_ms(last)));
+	JS_SetPropertyStr(ctx, obj, "mean", JS_NewFloat64(ctx, mean));
+	JS_SetPropertyStr(ctx, obj, "p50", JS_NewFloat64(ctx, p50));
+	JS_SetPropertyStr(ctx, obj, "p95", JS_NewFloat64(ctx, p95));
+	JS_SetPropertyStr(ctx, obj, "p99", JS_NewFloat64(ctx, p99));
+	JS_SetPropertyStr(ctx, obj, "max", JS_NewFloat64(ctx, max));
+	return obj;
+}
+
+static JSValue nx_frame_timings(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_context_t *nx_ctx = JS_GetContextOpaque(ctx);
+	nx_frame_timing_t *timing = &nx_ctx->frame_timing;
+	u32 count = timing->count;
+	u32 last = (timing->index + NX_FRAME_TIMING_HISTORY - 1) % NX_FRAME_TIMING_HISTORY;
+	u64 values[NX_FRAME_TIMING_HISTORY];
+
+	JSValue obj = JS_NewObject(ctx);
+	JS_SetPropertyStr(ctx, obj, "frames", JS_NewInt64(ctx, timing->frames));
+
+	memcpy(values, timing->intervals, count * sizeof(u64));
+	JS_SetPropertyStr(ctx, obj, "interval", nx_frame_timing_stats_new(ctx, values, count, count ? timing->intervals[last] : 0));
+
+	// Time spent doing work, which is everything except for polling
+	// (since that includes the time spent idle waiting for the next frame)
+	u64 busy_last = 0;
+	for (u32 i = 0; i < count; i++)
+	{
+		values[i] = 0;
+		for (int p = 0; p < NX_FRAME_PHASE_COUNT; p++)
+		{
+			if (p != NX_FRAME_PHASE_POLL)
+				values[i] += timing->phases[i][p];
+		}
+		if (i == last)
+			busy_last = values[i];
+	}
+	JS_SetPropertyStr(ctx, obj, "busy", nx_frame_timing_stats_new(ctx, values, count, busy_last));
+
+	for (int p = 0; p < NX_FRAME_PHASE_COUNT; p++)
+	{
+		for (u32 i = 0; i < count; i++)
+			values[i] = timing->phases[i][p];
+		JS_SetPropertyStr(ctx, obj, phase_names[p], nx_frame_timing_stats_new(ctx, values, count, count ? timing->phases[last][p] : 0));
+	}
+
+	return obj;
+}
+
+static JSValue nx_frame_set_rate_cap(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_context_t *nx_ctx = JS_GetContextOpaque(ctx);
+	double fps;
+	if (JS_ToFloat64(ctx, &fps, argv[0]))
+		return JS_EXCEPTION;
+	if (isnan(fps) || fps < 0)
+		return JS_ThrowRangeError(ctx, "Invalid frame rate: %f", fps);
+
+	// A cap of `0` or `Infinity` runs the frame handler on every iteration
+	// of the main loop, which is then limited by waiting for a free display
+	// buffer when presenting, or by the display's refresh interval when
+	// there was nothing to present (see the main loop)
+	nx_ctx->frame_interval = fps == 0 || isinf(fps) ? 0 : (u64)(1e9 / fps);
+	return JS_UNDEFINED;
+}
+
+static JSValue nx_frame_set_drain_budget(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_context_t *nx_ctx = JS_GetContextOpaque(ctx);
+	double ms;
+	if (JS_ToFloat64(ctx, &ms, argv[0]))
+		return JS_EXCEPTION;
+	if (isnan(ms) || ms <= 0)
+		return JS_ThrowRangeError(ctx, "Invalid drain budget: %f", ms);
+
+	// `Infinity` drains everything on every iteration of the main loop
+	nx_ctx->drain_budget = isinf(ms) ? 0 : (u64)(ms * 1e6);
+	return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry function_list[] = {
+	JS_CFUNC_DEF("frameTimings", 0, nx_frame_timings),
+	JS_CFUNC_DEF("frameSetRateCap", 1, nx_frame_set_rate_cap),
+	JS_CFUNC_DEF("frameSetDrainBudget", 1, nx_frame_set_drain_budget),
+};
+
+void nx_init_frame_timing(JSContext *ctx, JSValueConst init_obj)
+{
+	JS_SetPropertyFunctionList(ctx, init_obj, function_list, countof(function_list));
+}
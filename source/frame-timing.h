@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <quickjs.h>
+
+/**
+ * Frame time instrumentation for the main loop.
+ *
+ * Each iteration of the main loop marks the end of every phase, and the
+ * time since the previous mark is attributed to that phase. Iterations
+ * which do not run the frame handler (i.e. the loop was woken early by
+ * I/O or a timer) accumulate into the following frame. Once a frame has
+ * been presented its timings are committed into a ring buffer of the most
+ * recent frames, from which percentiles are computed on demand.
+ */
+
+// Number of recent frames kept for computing statistics (4 seconds at 60 FPS)
+#define NX_FRAME_TIMING_HISTORY 240
+
+enum nx_frame_phase
+{
+	// Waiting for and dispatching file descriptor activity (includes idle time)
+	NX_FRAME_PHASE_POLL,
+	// Invoking due timers
+	NX_FRAME_PHASE_TIMERS,
+	// Resolving completed thread pool work
+	NX_FRAME_PHASE_ASYNC,
+	// Running pending Promise jobs (microtasks)
+	NX_FRAME_PHASE_JOBS,
+	// Running the frame handler (`requestAnimationFrame()` callbacks, input events)
+	NX_FRAME_PHASE_HANDLER,
+	// Presenting the frame to the display
+	NX_FRAME_PHASE_PRESENT,
+	NX_FRAME_PHASE_COUNT
+};
+
+typedef struct nx_frame_timing_s
+{
+	// Phase durations (ns) of the most recent frames
+	uint64_t phases[NX_FRAME_TIMING_HISTORY][NX_FRAME_PHASE_COUNT];
+	// Time (ns) between the end of each frame and the end of the previous one
+	uint64_t intervals[NX_FRAME_TIMING_HISTORY];
+	// Index in the ring buffer that the next frame will be written to
+	uint32_t index;
+	// Number of valid entries in the ring buffer
+	uint32_t count;
+	// Total number of frames committed
+	uint64_t frames;
+
+	// Phase durations of the frame in progress
+	uint64_t current[NX_FRAME_PHASE_COUNT];
+	uint64_t last_mark;
+	uint64_t last_commit;
+} nx_frame_timing_t;
+
+void nx_frame_timing_mark(nx_frame_timing_t *timing, enum nx_frame_phase phase);
+void nx_frame_timing_commit(nx_frame_timing_t *timing);
+
+void nx_init_frame_timing(JSContext *ctx, JSValueConst init_obj);
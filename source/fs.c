@@ -8,6 +8,10 @@
 #include "fs.h"
 #include "async.h"
 
+// Files are read in chunks of this size by `readFile()`,
+// checking for cancellation in between each chunk
+#define READ_FILE_CHUNK_SIZE (1024 * 1024)
+
 typedef struct
 {
 	int err;
@@ -236,14 +240,31 @@ void nx_read_file_do(nx_work_t *req)
 		return;
 	}
 
-	size_t result = fread(data->result, 1, data->size, file);
+	// Read in chunks so that the request can be cancelled part way through
+	size_t result = 0;
+	while (result < data->size)
+	{
+		if (nx_work_cancelled(req))
+		{
+			data->err = ECANCELED;
+			break;
+		}
+		size_t chunk = data->size - result;
+		if (chunk > READ_FILE_CHUNK_SIZE)
+			chunk = READ_FILE_CHUNK_SIZE;
+		size_t n = fread(data->result + result, 1, chunk, file);
+		result += n;
+		if (n != chunk)
+			break;
+	}
 	fclose(file);
 
 	if (result != data->size)
 	{
 		free(data->result);
 		data->result = NULL;
-		data->err = -1;
+		if (!data->err)
+			data->err = -1;
 	}
 }
 
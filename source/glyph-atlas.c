@@ -0,0 +1,326 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "types.h"
+#include FT_OUTLINE_H
+#include FT_SIZES_H
+#include "glyph-atlas.h"
+#include "pixels.h"
+
+// Maximum number of glyphs in the atlas, after which it is reset
+#define NX_GLYPH_ATLAS_MAX_GLYPHS 4096
+
+// Number of hash table buckets (must be a power of 2)
+#define NX_GLYPH_ATLAS_BUCKETS 2048
+
+typedef struct nx_atlas_glyph_s
+{
+	struct nx_atlas_glyph_s *chain;
+
+	// Key
+	FT_Face face;
+	FT_F26Dot6 size;
+	uint32_t index;
+	uint32_t subpixel;
+
+	// Region of the glyph's coverage in the atlas
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+
+	// Offset from the pen position to the top-left corner of the region
+	int32_t left;
+	int32_t top;
+} nx_atlas_glyph_t;
+
+typedef enum
+{
+	ATLAS_OK,
+	// No space left in the atlas, so it needs to be reset
+	ATLAS_FULL,
+	// The glyph can not be drawn from the atlas
+	ATLAS_UNSUPPORTED,
+} atlas_result_t;
+
+typedef struct
+{
+	// 8-bit coverage, allocated on first use
+	uint8_t *pixels;
+
+	nx_atlas_glyph_t glyphs[NX_GLYPH_ATLAS_MAX_GLYPHS];
+	uint32_t count;
+	nx_atlas_glyph_t *buckets[NX_GLYPH_ATLAS_BUCKETS];
+
+	// Glyphs are packed into rows ("shelves") from the top-left
+	uint32_t shelf_x;
+	uint32_t shelf_y;
+	uint32_t shelf_height;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t resets;
+} nx_glyph_atlas_t;
+
+static nx_glyph_atlas_t atlas;
+
+static uint32_t hash_key(FT_Face face, FT_F26Dot6 size, uint32_t index, uint32_t subpixel)
+{
+	uintptr_t h = (uintptr_t)face;
+	h ^= (uintptr_t)size * 0x9E3779B1u;
+	h ^= (uintptr_t)index * 0x85EBCA77u;
+	h ^= subpixel * 0xC2B2AE3Du;
+	h ^= h >> 15;
+	return (uint32_t)h;
+}
+
+static void atlas_reset(void)
+{
+	memset(atlas.buckets, 0, sizeof(atlas.buckets));
+	atlas.count = 0;
+	atlas.shelf_x = 0;
+	atlas.shelf_y = 0;
+	atlas.shelf_height = 0;
+	atlas.resets++;
+}
+
+static nx_atlas_glyph_t *atlas_find(FT_Face face, FT_F26Dot6 size, uint32_t index, uint32_t subpixel)
+{
+	uint32_t hash = hash_key(face, size, index, subpixel);
+	nx_atlas_glyph_t *g = atlas.buckets[hash & (NX_GLYPH_ATLAS_BUCKETS - 1)];
+	for (; g; g = g->chain)
+	{
+		if (g->face == face && g->size == size && g->index == index && g->subpixel == subpixel)
+			return g;
+	}
+	return NULL;
+}
+
+// Reserves a `width` x `height` region of the atlas
+static bool atlas_pack(uint32_t width, uint32_t height, uint16_t *x, uint16_t *y)
+{
+	// Leave a 1 pixel gap between glyphs
+	uint32_t w = width + 1;
+	uint32_t h = height + 1;
+	if (atlas.shelf_x + w > NX_GLYPH_ATLAS_SIZE)
+	{
+		atlas.shelf_y += atlas.shelf_height;
+		atlas.shelf_x = 0;
+		atlas.shelf_height = 0;
+	}
+	if (atlas.shelf_y + h > NX_GLYPH_ATLAS_SIZE)
+		return false;
+	*x = atlas.shelf_x;
+	*y = atlas.shelf_y;
+	atlas.shelf_x += w;
+	if (h > atlas.shelf_height)
+		atlas.shelf_height = h;
+	return true;
+}
+
+static atlas_result_t atlas_add(FT_Face face, FT_F26Dot6 size, uint32_t index, uint32_t subpixel)
+{
+	if (atlas.count == NX_GLYPH_ATLAS_MAX_GLYPHS)
+		return ATLAS_FULL;
+
+	// Hint vertically only, since glyphs are positioned horizontally at subpixel offsets
+	if (FT_Load_Glyph(face, index, FT_LOAD_NO_BITMAP | FT_LOAD_TARGET_LIGHT))
+		return ATLAS_UNSUPPORTED;
+	FT_GlyphSlot slot = face->glyph;
+	if (slot->format != FT_GLYPH_FORMAT_OUTLINE)
+		return ATLAS_UNSUPPORTED;
+	FT_Outline_Translate(&slot->outline, subpixel * 64 / NX_GLYPH_ATLAS_SUBPIXELS, 0);
+	if (FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL))
+		return ATLAS_UNSUPPORTED;
+
+	FT_Bitmap *bitmap = &slot->bitmap;
+	if (bitmap->pixel_mode != FT_PIXEL_MODE_GRAY || bitmap->num_grays != 256 || bitmap->pitch < 0)
+		return ATLAS_UNSUPPORTED;
+	if (bitmap->width >= NX_GLYPH_ATLAS_SIZE / 4 || bitmap->rows >= NX_GLYPH_ATLAS_SIZE / 4)
+		return ATLAS_UNSUPPORTED;
+
+	uint16_t x = 0, y = 0;
+	if (bitmap->width && bitmap->rows && !atlas_pack(bitmap->width, bitmap->rows, &x, &y))
+		return ATLAS_FULL;
+
+	for (uint32_t row = 0; row < bitmap->rows; row++)
+	{
+		memcpy(atlas.pixels + (y + row) * NX_GLYPH_ATLAS_SIZE + x,
+			   bitmap->buffer + row * bitmap->pitch,
+			   bitmap->width);
+	}
+
+	nx_atlas_glyph_t *g = &atlas.glyphs[atlas.count++];
+	g->face = face;
+	g->size = size;
+	g->index = index;
+	g->subpixel = subpixel;
+	g->x = x;
+	g->y = y;
+	g->width = bitmap->width;
+	g->height = bitmap->rows;
+	g->left = slot->bitmap_left;
+	g->top = slot->bitmap_top;
+
+	nx_atlas_glyph_t **bucket = &atlas.buckets[hash_key(face, size, index, subpixel) & (NX_GLYPH_ATLAS_BUCKETS - 1)];
+	g->chain = *bucket;
+	*bucket = g;
+	return ATLAS_OK;
+}
+
+// Splits a device space x coordinate into whole pixels and a subpixel offset
+static inline int32_t pen_x(double x, uint32_t *subpixel)
+{
+	double fx = floor(x);
+	uint32_t s = (uint32_t)lround((x - fx) * NX_GLYPH_ATLAS_SUBPIXELS);
+	if (s == NX_GLYPH_ATLAS_SUBPIXELS)
+	{
+		fx += 1;
+		s = 0;
+	}
+	*subpixel = s;
+	return (int32_t)fx;
+}
+
+// Makes sure that every glyph is in the atlas
+static atlas_result_t atlas_prepare(FT_Face face, FT_F26Dot6 size, const cairo_glyph_t *glyphs, unsigned int count)
+{
+	atlas_result_t result = ATLAS_OK;
+	FT_Size previous_size = face->size;
+	FT_Size ft_size = NULL;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		uint32_t subpixel;
+		pen_x(glyphs[i].x, &subpixel);
+		if (atlas_find(face, size, glyphs[i].index, subpixel))
+		{
+			atlas.hits++;
+			continue;
+		}
+		atlas.misses++;
+
+		// Glyphs are rasterized with a separate size object, since the face is
+		// shared with cairo (which caches the size it last set on the face)
+		if (!ft_size)
+		{
+			if (FT_New_Size(face, &ft_size))
+				return ATLAS_UNSUPPORTED;
+			FT_Activate_Size(ft_size);
+			if (FT_Set_Char_Size(face, 0, size, 0, 0))
+			{
+				result = ATLAS_UNSUPPORTED;
+				break;
+			}
+		}
+
+		result = atlas_add(face, size, glyphs[i].index, subpixel);
+		if (result != ATLAS_OK)
+			break;
+	}
+	if (ft_size)
+	{
+		FT_Activate_Size(previous_size);
+		FT_Done_Size(ft_size);
+	}
+	return result;
+}
+
+bool nx_glyph_atlas_draw(FT_Face face, double font_size,
+						 const cairo_glyph_t *glyphs, unsigned int count,
+						 uint8_t *dst, uint32_t stride, const nx_rect_t *clip,
+						 const uint8_t color[4], nx_rect_t *drawn)
+{
+	if (!atlas.pixels)
+	{
+		atlas.pixels = malloc(NX_GLYPH_ATLAS_SIZE * NX_GLYPH_ATLAS_SIZE);
+		if (!atlas.pixels)
+			return false;
+	}
+
+	FT_F26Dot6 size = (FT_F26Dot6)lround(font_size * 64.0);
+	atlas_result_t result = atlas_prepare(face, size, glyphs, count);
+	if (result == ATLAS_FULL)
+	{
+		// Start over with an empty atlas. If the glyphs of
+		// this text alone do not fit, then let cairo draw it.
+		atlas_reset();
+		result = atlas_prepare(face, size, glyphs, count);
+	}
+	if (result != ATLAS_OK)
+		return false;
+
+	drawn->x1 = drawn->y1 = INT32_MAX;
+	drawn->x2 = drawn->y2 = INT32_MIN;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		uint32_t subpixel;
+		int32_t px = pen_x(glyphs[i].x, &subpixel);
+		int32_t py = (int32_t)lround(glyphs[i].y);
+		const nx_atlas_glyph_t *g = atlas_find(face, size, glyphs[i].index, subpixel);
+
+		int32_t x1 = px + g->left;
+		int32_t y1 = py - g->top;
+		int32_t x2 = x1 + g->width;
+		int32_t y2 = y1 + g->height;
+		int32_t cx1 = x1 > clip->x1 ? x1 : clip->x1;
+		int32_t cy1 = y1 > clip->y1 ? y1 : clip->y1;
+		int32_t cx2 = x2 < clip->x2 ? x2 : clip->x2;
+		int32_t cy2 = y2 < clip->y2 ? y2 : clip->y2;
+		if (cx1 >= cx2 || cy1 >= cy2)
+			continue;
+
+		const uint8_t *mask = atlas.pixels + (g->y + cy1 - y1) * NX_GLYPH_ATLAS_SIZE + g->x + (cx1 - x1);
+		uint8_t *row = dst + cy1 * stride + cx1 * 4;
+		for (int32_t y = cy1; y < cy2; y++)
+		{
+			nx_blend_mask_solid(row, mask, cx2 - cx1, color);
+			row += stride;
+			mask += NX_GLYPH_ATLAS_SIZE;
+		}
+
+		if (cx1 < drawn->x1)
+			drawn->x1 = cx1;
+		if (cy1 < drawn->y1)
+			drawn->y1 = cy1;
+		if (cx2 > drawn->x2)
+			drawn->x2 = cx2;
+		if (cy2 > drawn->y2)
+			drawn->y2 = cy2;
+	}
+	if (drawn->x1 > drawn->x2)
+		drawn->x1 = drawn->y1 = drawn->x2 = drawn->y2 = 0;
+	return true;
+}
+
+void nx_glyph_atlas_remove_face(FT_Face face)
+{
+	// Glyphs are not removed individually, since
+	// fonts are rarely freed while the app is running
+	for (uint32_t i = 0; i < atlas.count; i++)
+	{
+		if (atlas.glyphs[i].face == face)
+		{
+			atlas_reset();
+			return;
+		}
+	}
+}
+
+static JSValue nx_glyph_atlas_stats(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	JSValue obj = JS_NewObject(ctx);
+	JS_SetPropertyStr(ctx, obj, "hits", JS_NewInt64(ctx, atlas.hits));
+	JS_SetPropertyStr(ctx, obj, "misses", JS_NewInt64(ctx, atlas.misses));
+	JS_SetPropertyStr(ctx, obj, "glyphs", JS_NewInt64(ctx, atlas.count));
+	JS_SetPropertyStr(ctx, obj, "resets", JS_NewInt64(ctx, atlas.resets));
+	return obj;
+}
+
+static const JSCFunctionListEntry function_list[] = {
+	JS_CFUNC_DEF("glyphAtlasStats", 0, nx_glyph_atlas_stats),
+};
+
+void nx_init_glyph_atlas(JSContext *ctx, JSValueConst init_obj)
+{
+	JS_SetPropertyFunctionList(ctx, init_obj, function_list, countof(function_list));
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "canvas.h"
+
+/**
+ * Glyph atlas used by the `textRendering = "optimizeSpeed"` text path.
+ *
+ * Each glyph is rasterized by FreeType once per (face, size, horizontal
+ * subpixel offset) into a shared 8-bit coverage atlas, and drawing text is
+ * then a masked blend of the atlas regions into the canvas pixels instead
+ * of rasterizing every glyph through cairo on each call.
+ */
+
+// Width and height of the atlas in pixels
+#define NX_GLYPH_ATLAS_SIZE 1024
+
+// Number of horizontal subpixel positions that glyphs are rasterized at
+#define NX_GLYPH_ATLAS_SUBPIXELS 4
+
+/**
+ * Draws `count` glyphs of `face` at `font_size`, positioned in device space,
+ * into the ARGB32 pixels `dst` with `stride` bytes per row. Only the pixels
+ * within `clip` are modified, and the region which was drawn to is written
+ * to `drawn`. `color` is a premultiplied native-endian ARGB32 pixel.
+ *
+ * Returns `false` without drawing anything if any of the glyphs can not be
+ * rasterized into the atlas (i.e. bitmap / color glyphs, or very large
+ * glyphs), in which case the text should be drawn with cairo instead.
+ */
+bool nx_glyph_atlas_draw(FT_Face face, double font_size,
+						 const cairo_glyph_t *glyphs, unsigned int count,
+						 uint8_t *dst, uint32_t stride, const nx_rect_t *clip,
+						 const uint8_t color[4], nx_rect_t *drawn);
+
+// Removes every glyph of `face` from the atlas
+void nx_glyph_atlas_remove_face(FT_Face face);
+
+void nx_init_glyph_atlas(JSContext *ctx, JSValueConst init_obj);
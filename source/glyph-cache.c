@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "types.h"
+#include "glyph-cache.h"
+
+// Number of hash table buckets (must be a power of 2)
+#define NX_GLYPH_CACHE_BUCKETS 1024
+
+typedef struct
+{
+	nx_glyph_run_t *buckets[NX_GLYPH_CACHE_BUCKETS];
+	// Most recently used run
+	nx_glyph_run_t *head;
+	// Least recently used run
+	nx_glyph_run_t *tail;
+	size_t count;
+	size_t bytes;
+	size_t limit;
+	uint64_t hits;
+	uint64_t misses;
+} nx_glyph_cache_t;
+
+static nx_glyph_cache_t cache = {
+	.limit = NX_GLYPH_CACHE_DEFAULT_LIMIT,
+};
+
+// FNV-1a
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t length)
+{
+	const uint8_t *p = data;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static uint32_t hash_key(hb_font_t *font, double font_size, hb_direction_t direction, const char *text, size_t text_length)
+{
+	uint32_t hash = 2166136261u;
+	hash = hash_bytes(hash, &font, sizeof(font));
+	hash = hash_bytes(hash, &font_size, sizeof(font_size));
+	hash = hash_bytes(hash, &direction, sizeof(direction));
+	return hash_bytes(hash, text, text_length);
+}
+
+static void lru_unlink(nx_glyph_run_t *run)
+{
+	if (run->prev)
+		run->prev->next = run->next;
+	else
+		cache.head = run->next;
+	if (run->next)
+		run->next->prev = run->prev;
+	else
+		cache.tail = run->prev;
+	run->prev = run->next = NULL;
+}
+
+static void lru_push_front(nx_glyph_run_t *run)
+{
+	run->prev = NULL;
+	run->next = cache.head;
+	if (cache.head)
+		cache.head->prev = run;
+	else
+		cache.tail = run;
+	cache.head = run;
+}
+
+static void remove_run(nx_glyph_run_t *run)
+{
+	nx_glyph_run_t **p = &cache.buckets[run->hash & (NX_GLYPH_CACHE_BUCKETS - 1)];
+	while (*p != run)
+		p = &(*p)->chain;
+	*p = run->chain;
+	lru_unlink(run);
+	cache.count--;
+	cache.bytes -= run->bytes;
+	free(run);
+}
+
+// Evicts the least recently used runs until the cache fits within its limit,
+// but never evicts `keep` (the run which is about to be returned)
+static void evict(nx_glyph_run_t *keep)
+{
+	while (cache.bytes > cache.limit && cache.tail && cache.tail != keep)
+		remove_run(cache.tail);
+}
+
+static nx_glyph_run_t *shape(hb_font_t *font, double font_size, hb_direction_t direction,
+							 const char *text, size_t text_length, uint32_t hash)
+{
+	// The `hb_font_t` is shared by every context which uses the font,
+	// so the scale is not necessarily the one of the calling context
+	hb_font_set_scale(font, font_size * 64, font_size * 64);
+
+	hb_buffer_t *buf = hb_buffer_create();
+	hb_buffer_set_direction(buf, direction);
+	hb_buffer_set_script(buf, HB_SCRIPT_COMMON);
+	hb_buffer_set_language(buf, hb_language_get_default());
+	hb_buffer_add_utf8(buf, text, text_length, 0, text_length);
+	hb_shape(font, buf, NULL, 0);
+
+	unsigned int glyph_count = hb_buffer_get_length(buf);
+	hb_glyph_info_t *glyph_info = hb_buffer_get_glyph_infos(buf, NULL);
+	hb_glyph_position_t *glyph_pos = hb_buffer_get_glyph_positions(buf, NULL);
+
+	// The run, its glyphs and a copy of the text are a single allocation
+	size_t bytes = sizeof(nx_glyph_run_t) + glyph_count * sizeof(cairo_glyph_t) + text_length + 1;
+	nx_glyph_run_t *run = malloc(bytes);
+	if (!run)
+	{
+		hb_buffer_destroy(buf);
+		return NULL;
+	}
+	memset(run, 0, sizeof(nx_glyph_run_t));
+	run->hash = hash;
+	run->bytes = bytes;
+	run->font = font;
+	run->font_size = font_size;
+	run->direction = direction;
+	run->glyphs = (cairo_glyph_t *)(run + 1);
+	run->glyph_count = glyph_count;
+	run->text = (char *)(run->glyphs + glyph_count);
+	run->text_length = text_length;
+	memcpy(run->text, text, text_length);
+	run->text[text_length] = '\0';
+
+	double x = 0;
+	double y = 0;
+	for (unsigned int i = 0; i < glyph_count; ++i)
+	{
+		run->glyphs[i].index = glyph_info[i].codepoint;
+		run->glyphs[i].x = x + (glyph_pos[i].x_offset / (64.0));
+		run->glyphs[i].y = -(y + glyph_pos[i].y_offset / (64.0));
+		x += glyph_pos[i].x_advance / (64.0);
+		y += glyph_pos[i].y_advance / (64.0);
+	}
+	run->x_advance = x;
+	run->y_advance = y;
+
+	hb_buffer_destroy(buf);
+	return run;
+}
+
+nx_glyph_run_t *nx_glyph_run_get(hb_font_t *font, double font_size, hb_direction_t direction,
+								 const char *text, size_t text_length)
+{
+	uint32_t hash = hash_key(font, font_size, direction, text, text_length);
+	nx_glyph_run_t **bucket = &cache.buckets[hash & (NX_GLYPH_CACHE_BUCKETS - 1)];
+	for (nx_glyph_run_t *run = *bucket; run; run = run->chain)
+	{
+		if (run->hash == hash &&
+			run->font == font &&
+			run->font_size == font_size &&
+			run->direction == direction &&
+			run->text_length == text_length &&
+			memcmp(run->text, text, text_length) == 0)
+		{
+			cache.hits++;
+			if (cache.head != run)
+			{
+				lru_unlink(run);
+				lru_push_front(run);
+			}
+			return run;
+		}
+	}
+
+	cache.misses++;
+	nx_glyph_run_t *run = shape(font, font_size, direction, text, text_length, hash);
+	if (!run)
+		return NULL;
+	run->chain = *bucket;
+	*bucket = run;
+	lru_push_front(run);
+	cache.count++;
+	cache.bytes += run->bytes;
+	evict(run);
+	return run;
+}
+
+void nx_glyph_cache_remove_font(hb_font_t *font)
+{
+	nx_glyph_run_t *run = cache.head;
+	while (run)
+	{
+		nx_glyph_run_t *next = run->next;
+		if (run->font == font)
+			remove_run(run);
+		run = next;
+	}
+}
+
+static JSValue nx_glyph_cache_stats(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	JSValue obj = JS_NewObject(ctx);
+	JS_SetPropertyStr(ctx, obj, "hits", JS_NewInt64(ctx, cache.hits));
+	JS_SetPropertyStr(ctx, obj, "misses", JS_NewInt64(ctx, cache.misses));
+	JS_SetPropertyStr(ctx, obj, "entries", JS_NewInt64(ctx, cache.count));
+	JS_SetPropertyStr(ctx, obj, "bytes", JS_NewInt64(ctx, cache.bytes));
+	JS_SetPropertyStr(ctx, obj, "limit", JS_NewInt64(ctx, cache.limit));
+	return obj;
+}
+
+static JSValue nx_glyph_cache_set_limit(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	double limit;
+	if (JS_ToFloat64(ctx, &limit, argv[0]))
+		return JS_EXCEPTION;
+	if (isnan(limit) || limit < 0)
+		return JS_ThrowRangeError(ctx, "Invalid glyph cache limit: %f", limit);
+
+	cache.limit = isinf(limit) ? SIZE_MAX : (size_t)limit;
+	evict(NULL);
+	return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry function_list[] = {
+	JS_CFUNC_DEF("glyphCacheStats", 0, nx_glyph_cache_stats),
+	JS_CFUNC_DEF("glyphCacheSetLimit", 1, nx_glyph_cache_set_limit),
+};
+
+void nx_init_glyph_cache(JSContext *ctx, JSValueConst init_obj)
+{
+	JS_SetPropertyFunctionList(ctx, init_obj, function_list, countof(function_list));
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <cairo.h>
+#include <quickjs.h>
+#include <harfbuzz/hb.h>
+
+/**
+ * Cache of shaped glyph runs.
+ *
+ * Shaping a string with HarfBuzz is the most expensive part of drawing
+ * text, and applications tend to draw the same strings (HUD labels, scores,
+ * menu items) on every frame. The result of shaping is cached keyed on the
+ * font, font size, text and direction, and the least recently used runs are
+ * evicted once the total size of the cache exceeds its limit.
+ */
+
+// Default maximum total size (in bytes) of the cached glyph runs
+#define NX_GLYPH_CACHE_DEFAULT_LIMIT (1024 * 1024)
+
+typedef struct nx_glyph_run_s
+{
+	// Next run in the same hash table bucket
+	struct nx_glyph_run_s *chain;
+	// Least recently used list (`prev` is more recently used)
+	struct nx_glyph_run_s *prev;
+	struct nx_glyph_run_s *next;
+	uint32_t hash;
+	size_t bytes;
+
+	// Key
+	hb_font_t *font;
+	double font_size;
+	hb_direction_t direction;
+	char *text;
+	size_t text_length;
+
+	// Glyphs positioned relative to the start of the run, with y pointing down
+	cairo_glyph_t *glyphs;
+	unsigned int glyph_count;
+	// Total advance of the run
+	double x_advance;
+	double y_advance;
+} nx_glyph_run_t;
+
+/**
+ * Returns the glyph run of `text` shaped with `font` at `font_size`,
+ * shaping it if it is not already cached. The returned run is owned by the
+ * cache and is only valid until the next call. Returns `NULL` when out of memory.
+ */
+nx_glyph_run_t *nx_glyph_run_get(hb_font_t *font, double font_size, hb_direction_t direction,
+								 const char *text, size_t text_length);
+
+// Removes every cached glyph run which was shaped with `font`
+void nx_glyph_cache_remove_font(hb_font_t *font);
+
+void nx_init_glyph_cache(JSContext *ctx, JSValueConst init_obj);
@@ -0,0 +1,243 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "types.h"
+#include "image.h"
+#include "image-cache.h"
+
+// Number of hash table buckets (must be a power of 2)
+#define NX_IMAGE_CACHE_BUCKETS 256
+
+typedef struct nx_image_cache_entry_s
+{
+	// Next entry in the same hash table bucket
+	struct nx_image_cache_entry_s *chain;
+	// Least recently used list (`prev` is more recently used)
+	struct nx_image_cache_entry_s *prev;
+	struct nx_image_cache_entry_s *next;
+	uint32_t hash;
+	size_t bytes;
+
+	char *key;
+	size_t key_length;
+
+	// Owns the pixels, and is shared with every `Image` loaded from this entry
+	cairo_surface_t *surface;
+	enum ImageFormat format;
+} nx_image_cache_entry_t;
+
+typedef struct
+{
+	nx_image_cache_entry_t *buckets[NX_IMAGE_CACHE_BUCKETS];
+	// Most recently used entry
+	nx_image_cache_entry_t *head;
+	// Least recently used entry
+	nx_image_cache_entry_t *tail;
+	size_t count;
+	size_t bytes;
+	size_t limit;
+	uint64_t hits;
+	uint64_t misses;
+} nx_image_cache_t;
+
+static nx_image_cache_t cache = {
+	.limit = NX_IMAGE_CACHE_DEFAULT_LIMIT,
+};
+
+// FNV-1a
+static uint32_t hash_key(const char *key, size_t key_length)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < key_length; i++)
+	{
+		hash ^= (uint8_t)key[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void lru_unlink(nx_image_cache_entry_t *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		cache.head = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		cache.tail = entry->prev;
+	entry->prev = entry->next = NULL;
+}
+
+static void lru_push_front(nx_image_cache_entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = cache.head;
+	if (cache.head)
+		cache.head->prev = entry;
+	else
+		cache.tail = entry;
+	cache.head = entry;
+}
+
+// Images which still use the surface keep their own reference to it
+static void remove_entry(nx_image_cache_entry_t *entry)
+{
+	nx_image_cache_entry_t **p = &cache.buckets[entry->hash & (NX_IMAGE_CACHE_BUCKETS - 1)];
+	while (*p != entry)
+		p = &(*p)->chain;
+	*p = entry->chain;
+	lru_unlink(entry);
+	cache.count--;
+	cache.bytes -= entry->bytes;
+	cairo_surface_destroy(entry->surface);
+	free(entry);
+}
+
+// Evicts the least recently used entries until the cache fits within its limit
+static void evict(void)
+{
+	while (cache.bytes > cache.limit && cache.tail)
+		remove_entry(cache.tail);
+}
+
+static nx_image_cache_entry_t *find(const char *key, size_t key_length, uint32_t hash)
+{
+	nx_image_cache_entry_t *entry = cache.buckets[hash & (NX_IMAGE_CACHE_BUCKETS - 1)];
+	for (; entry; entry = entry->chain)
+	{
+		if (entry->hash == hash &&
+			entry->key_length == key_length &&
+			memcmp(entry->key, key, key_length) == 0)
+		{
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+// Loads the image cached for `key` into `img`, and returns whether there was one
+static JSValue nx_image_cache_get(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_image_t *image = nx_get_image(ctx, argv[0]);
+	if (!image)
+		return JS_EXCEPTION;
+	size_t key_length;
+	const char *key = JS_ToCStringLen(ctx, &key_length, argv[1]);
+	if (!key)
+		return JS_EXCEPTION;
+
+	nx_image_cache_entry_t *entry = find(key, key_length, hash_key(key, key_length));
+	JS_FreeCString(ctx, key);
+	if (!entry)
+	{
+		cache.misses++;
+		return JS_FALSE;
+	}
+	cache.hits++;
+	if (cache.head != entry)
+	{
+		lru_unlink(entry);
+		lru_push_front(entry);
+	}
+	nx_image_set_surface(JS_GetRuntime(ctx), image, entry->surface, entry->format);
+	return JS_TRUE;
+}
+
+// Adds the decoded pixels of `img` to the cache for `key`
+static JSValue nx_image_cache_put(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_image_t *image = nx_get_image(ctx, argv[0]);
+	if (!image)
+		return JS_EXCEPTION;
+
+	// Only pixels which are owned by the surface can be shared between images
+	size_t bytes = (size_t)image->width * image->height * 4;
+	if (!image->surface || !image->data_owned_by_surface || bytes > cache.limit)
+		return JS_UNDEFINED;
+
+	size_t key_length;
+	const char *key = JS_ToCStringLen(ctx, &key_length, argv[1]);
+	if (!key)
+		return JS_EXCEPTION;
+	uint32_t hash = hash_key(key, key_length);
+	nx_image_cache_entry_t *entry = find(key, key_length, hash);
+	if (entry)
+		remove_entry(entry);
+
+	// The entry and a copy of the key are a single allocation
+	entry = malloc(sizeof(nx_image_cache_entry_t) + key_length + 1);
+	if (!entry)
+	{
+		JS_FreeCString(ctx, key);
+		return JS_ThrowOutOfMemory(ctx);
+	}
+	memset(entry, 0, sizeof(nx_image_cache_entry_t));
+	entry->hash = hash;
+	entry->bytes = bytes;
+	entry->key = (char *)(entry + 1);
+	entry->key_length = key_length;
+	memcpy(entry->key, key, key_length);
+	entry->key[key_length] = '\0';
+	entry->surface = cairo_surface_reference(image->surface);
+	entry->format = image->format;
+	JS_FreeCString(ctx, key);
+
+	nx_image_cache_entry_t **bucket = &cache.buckets[hash & (NX_IMAGE_CACHE_BUCKETS - 1)];
+	entry->chain = *bucket;
+	*bucket = entry;
+	lru_push_front(entry);
+	cache.count++;
+	cache.bytes += bytes;
+	evict();
+	return JS_UNDEFINED;
+}
+
+void nx_image_cache_destroy(void)
+{
+	while (cache.tail)
+		remove_entry(cache.tail);
+}
+
+static JSValue nx_image_cache_clear(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_image_cache_destroy();
+	return JS_UNDEFINED;
+}
+
+static JSValue nx_image_cache_stats(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	JSValue obj = JS_NewObject(ctx);
+	JS_SetPropertyStr(ctx, obj, "hits", JS_NewInt64(ctx, cache.hits));
+	JS_SetPropertyStr(ctx, obj, "misses", JS_NewInt64(ctx, cache.misses));
+	JS_SetPropertyStr(ctx, obj, "entries", JS_NewInt64(ctx, cache.count));
+	JS_SetPropertyStr(ctx, obj, "bytes", JS_NewInt64(ctx, cache.bytes));
+	JS_SetPropertyStr(ctx, obj, "limit", JS_NewInt64(ctx, cache.limit));
+	return obj;
+}
+
+static JSValue nx_image_cache_set_limit(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	double limit;
+	if (JS_ToFloat64(ctx, &limit, argv[0]))
+		return JS_EXCEPTION;
+	if (isnan(limit) || limit < 0)
+		return JS_ThrowRangeError(ctx, "Invalid image cache limit: %f", limit);
+
+	cache.limit = isinf(limit) ? SIZE_MAX : (size_t)limit;
+	evict();
+	return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry function_list[] = {
+	JS_CFUNC_DEF("imageCacheGet", 2, nx_image_cache_get),
+	JS_CFUNC_DEF("imageCachePut", 2, nx_image_cache_put),
+	JS_CFUNC_DEF("imageCacheClear", 0, nx_image_cache_clear),
+	JS_CFUNC_DEF("imageCacheStats", 0, nx_image_cache_stats),
+	JS_CFUNC_DEF("imageCacheSetLimit", 1, nx_image_cache_set_limit),
+};
+
+void nx_init_image_cache(JSContext *ctx, JSValueConst init_obj)
+{
+	JS_SetPropertyFunctionList(ctx, init_obj, function_list, countof(function_list));
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "types.h"
+
+/**
+ * Cache of decoded images.
+ *
+ * Applications tend to load the same assets (sprites, icons, backgrounds)
+ * every time a screen is shown. Decoded images are cached keyed on their
+ * URL (and decode options), and an `Image` which is loaded from the cache
+ * shares the pixels of the cached surface (cairo surfaces are reference
+ * counted) instead of reading and decoding the file again. The least
+ * recently used images are evicted once the total size of the cache
+ * exceeds its limit.
+ */
+
+// Default maximum total size (in bytes) of the cached images
+#define NX_IMAGE_CACHE_DEFAULT_LIMIT (32 * 1024 * 1024)
+
+void nx_init_image_cache(JSContext *ctx, JSValueConst init_obj);
+
+// Releases every cached image, when the runtime shuts down
+void nx_image_cache_destroy(void);
@@ -1,12 +1,16 @@
 #include <png.h>
 #include <turbojpeg.h>
 #include <webp/decode.h>
+#include <setjmp.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <jpeglib.h> // after <stdio.h>, for `FILE`
 #include <stdlib.h>
 #include <string.h>
 #include <cairo.h>
 #include "image.h"
 #include "async.h"
+#include "pixels.h"
 
 static JSClassID nx_image_class_id;
 
@@ -15,6 +19,9 @@ typedef struct
 	int err;
 	char *err_str;
 	nx_image_t *image;
+	// Size to decode the image to, or 0 for the natural size
+	u32 target_width;
+	u32 target_height;
 	JSValue image_val;
 	JSValue buffer_val;
 	uint8_t *input;
@@ -32,6 +39,24 @@ nx_image_t *nx_get_image(JSContext *ctx, JSValueConst obj)
 	return JS_GetOpaque2(ctx, obj, nx_image_class_id);
 }
 
+// Decoded pixels are allocated by the decoder's allocator, which depends on the format
+static uint8_t *alloc_pixels(enum ImageFormat format, size_t size)
+{
+	return format == FORMAT_JPEG ? tjAlloc(size) : malloc(size);
+}
+
+static void free_pixels(enum ImageFormat format, uint8_t *data)
+{
+	if (format == FORMAT_JPEG)
+	{
+		tjFree(data);
+	}
+	else
+	{
+		free(data);
+	}
+}
+
 void close_image(JSRuntime *rt, nx_image_t *image)
 {
 	if (image->surface)
@@ -46,21 +71,29 @@ void close_image(JSRuntime *rt, nx_image_t *image)
 		{
 			js_free_rt(rt, image->data);
 		}
-		else if (image->format == FORMAT_JPEG)
-		{
-			tjFree(image->data);
-		}
-		else
+		else if (!image->data_owned_by_surface)
 		{
-			free(image->data);
+			free_pixels(image->format, image->data);
 		}
 		image->data = NULL;
 		image->data_needs_js_free = false;
+		image->data_owned_by_surface = false;
 	}
 
 	image->width = image->height = 0;
 }
 
+void nx_image_set_surface(JSRuntime *rt, nx_image_t *image, cairo_surface_t *surface, enum ImageFormat format)
+{
+	close_image(rt, image);
+	image->width = cairo_image_surface_get_width(surface);
+	image->height = cairo_image_surface_get_height(surface);
+	image->data = cairo_image_surface_get_data(surface);
+	image->data_owned_by_surface = true;
+	image->surface = cairo_surface_reference(surface);
+	image->format = format;
+}
+
 void user_read_data(png_structp png_ptr, png_bytep data, png_size_t length)
 {
 	struct buffer_state *state = (struct buffer_state *)png_get_io_ptr(png_ptr);
@@ -85,19 +118,31 @@ enum ImageFormat identify_image_format(uint8_t *data, size_t size)
 	return FORMAT_UNKNOWN;
 }
 
-void premultiply_alpha(uint8_t *image_data, int width, int height)
+/**
+ * Fills in a target size of 0 (when only one dimension was given)
+ * so that the image keeps the aspect ratio of its natural size.
+ */
+static void resolve_target_size(u32 width, u32 height, u32 *target_width, u32 *target_height)
 {
-	for (int i = 0; i < width * height; ++i)
+	if (width == 0 || height == 0)
+	{
+		*target_width = *target_height = 0;
+	}
+	else if (*target_width && !*target_height)
+	{
+		*target_height = (u32)((double)height * *target_width / width + 0.5);
+	}
+	else if (*target_height && !*target_width)
 	{
-		uint8_t *pixel = &image_data[i * 4];
-		uint8_t alpha = pixel[3];
-		pixel[0] = (pixel[0] * alpha) / 255;
-		pixel[1] = (pixel[1] * alpha) / 255;
-		pixel[2] = (pixel[2] * alpha) / 255;
+		*target_width = (u32)((double)width * *target_height / height + 0.5);
+	}
+	if (*target_width == 0 || *target_height == 0)
+	{
+		*target_width = *target_height = 0;
 	}
 }
 
-uint8_t *decode_png(uint8_t *input, size_t input_size, u32 *width, u32 *height)
+uint8_t *decode_png(uint8_t *input, size_t input_size, u32 *width, u32 *height, u32 *target_width, u32 *target_height, nx_work_t *req)
 {
 	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 	png_infop info_ptr = png_create_info_struct(png_ptr);
@@ -107,37 +152,106 @@ uint8_t *decode_png(uint8_t *input, size_t input_size, u32 *width, u32 *height)
 
 	png_read_info(png_ptr, info_ptr);
 
-	*width = png_get_image_width(png_ptr, info_ptr);
-	*height = png_get_image_height(png_ptr, info_ptr);
+	u32 src_width = *width = png_get_image_width(png_ptr, info_ptr);
+	u32 src_height = *height = png_get_image_height(png_ptr, info_ptr);
+	resolve_target_size(src_width, src_height, target_width, target_height);
 
-	png_set_bgr(png_ptr);
+	// Images without an alpha channel or transparent color are opaque, so they are never premultiplied
+	bool has_alpha = (png_get_color_type(png_ptr, info_ptr) & PNG_COLOR_MASK_ALPHA) ||
+					 png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS);
 	png_set_expand(png_ptr);
-	bool has_alpha = png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_RGBA;
-	if (!has_alpha)
+	png_set_strip_16(png_ptr);
+	png_set_gray_to_rgb(png_ptr);
+	png_set_bgr(png_ptr);
+	png_set_add_alpha(png_ptr, 0xff, PNG_FILLER_AFTER);
+
+	int passes = png_set_interlace_handling(png_ptr);
+	png_read_update_info(png_ptr, info_ptr);
+
+	// Non-interlaced images that are decoded to a smaller size are reduced
+	// row by row while decoding, so the full size image is never allocated
+	bool downscale = passes == 1 && *target_width && *target_height &&
+					 *target_width <= src_width && *target_height <= src_height &&
+					 (*target_width < src_width || *target_height < src_height);
+	nx_downscaler_t scaler;
+	uint8_t *row = NULL;
+	uint8_t *image_data;
+	if (downscale)
 	{
-		png_set_add_alpha(png_ptr, 0xff, PNG_FILLER_AFTER);
+		*width = *target_width;
+		*height = *target_height;
+		image_data = malloc(4 * (*width) * (*height));
+		row = malloc(4 * src_width);
+		if (!image_data || !row || nx_downscaler_init(&scaler, image_data, *width, *height, src_width, src_height))
+		{
+			png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+			free(image_data);
+			free(row);
+			return NULL;
+		}
 	}
-
-	uint8_t *image_data = malloc(4 * (*width) * (*height));
-	png_bytep rows[*height];
-	for (int i = 0; i < *height; ++i)
+	else
 	{
-		rows[i] = image_data + i * 4 * (*width);
+		image_data = malloc(4 * src_width * src_height);
 	}
 
-	png_read_image(png_ptr, rows);
+	// Decode row by row (instead of `png_read_image()`)
+	// so that the decode can be cancelled part way through
+	for (int pass = 0; pass < passes; ++pass)
+	{
+		for (int i = 0; i < src_height; ++i)
+		{
+			if ((i & 63) == 0 && nx_work_cancelled(req))
+			{
+				png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+				if (downscale)
+				{
+					nx_downscaler_free(&scaler);
+					free(row);
+				}
+				free(image_data);
+				return NULL;
+			}
+			if (downscale)
+			{
+				png_read_row(png_ptr, row, NULL);
+				if (has_alpha)
+				{
+					nx_premultiply(row, src_width);
+				}
+				nx_downscaler_push_row(&scaler, row);
+			}
+			else
+			{
+				// Premultiply each row while it is still in the cache, unless
+				// later passes still need to be combined with it (interlaced)
+				uint8_t *dst = image_data + (size_t)i * 4 * src_width;
+				png_read_row(png_ptr, dst, NULL);
+				if (has_alpha && passes == 1)
+				{
+					nx_premultiply(dst, src_width);
+				}
+			}
+		}
+	}
+	png_read_end(png_ptr, NULL);
 
 	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 
-	if (has_alpha)
+	if (downscale)
+	{
+		nx_downscaler_free(&scaler);
+		free(row);
+	}
+	else if (has_alpha && passes > 1)
 	{
-		premultiply_alpha(image_data, *width, *height);
+		nx_premultiply(image_data, (size_t)(*width) * (*height));
 	}
 
 	return image_data;
 }
 
-int decode_jpeg(uint8_t *jpegBuf, size_t jpegSize, uint8_t **output, int *width, int *height)
+int decode_jpeg(uint8_t *jpegBuf, size_t jpegSize, uint8_t **output, int *width, int *height, u32 *target_width, u32 *target_height)
 {
 	tjhandle handle = NULL;
 	int subsamp, colorspace;
@@ -156,6 +270,30 @@ int decode_jpeg(uint8_t *jpegBuf, size_t jpegSize, uint8_t **output, int *width,
 		goto cleanup;
 	}
 
+	resolve_target_size(*width, *height, target_width, target_height);
+	if (*target_width && *target_height)
+	{
+		// Use the smallest DCT scaling factor which still decodes
+		// at least the target size, and let the IDCT do the rest
+		int num_factors;
+		tjscalingfactor *factors = tjGetScalingFactors(&num_factors);
+		int scaled_width = *width;
+		int scaled_height = *height;
+		for (int i = 0; factors && i < num_factors; i++)
+		{
+			int w = TJSCALED(*width, factors[i]);
+			int h = TJSCALED(*height, factors[i]);
+			if (w >= *target_width && h >= *target_height &&
+				(u64)w * h < (u64)scaled_width * scaled_height)
+			{
+				scaled_width = w;
+				scaled_height = h;
+			}
+		}
+		*width = scaled_width;
+		*height = scaled_height;
+	}
+
 	*output = tjAlloc((*width) * (*height) * tjPixelSize[TJPF_BGRA]);
 
 	if (tjDecompress2(handle, jpegBuf, jpegSize, *output, *width, 0 /*pitch*/, *height, TJPF_BGRA, TJFLAG_FASTDCT) == -1)
@@ -173,57 +311,138 @@ cleanup:
 	return ret;
 }
 
-uint8_t *decode_webp(uint8_t *webp_data, size_t data_size, int *width, int *height)
+uint8_t *decode_webp(uint8_t *webp_data, size_t data_size, int *width, int *height, u32 *target_width, u32 *target_height)
 {
-	// Decode the WebP image data into a BGRA format
-	uint8_t *bgra_data = WebPDecodeBGRA(webp_data, data_size, width, height);
-	if (bgra_data == NULL)
+	WebPDecoderConfig config;
+	if (!WebPInitDecoderConfig(&config) ||
+		WebPGetFeatures(webp_data, data_size, &config.input) != VP8_STATUS_OK)
 	{
-		// TODO: Handle error
 		return NULL;
 	}
+	*width = config.input.width;
+	*height = config.input.height;
 
-	premultiply_alpha(bgra_data, *width, *height);
+	resolve_target_size(*width, *height, target_width, target_height);
+	if (*target_width && *target_height && *target_width <= *width && *target_height <= *height)
+	{
+		// libwebp scales while decoding, so the full size image is never allocated
+		config.options.use_scaling = 1;
+		config.options.scaled_width = *width = *target_width;
+		config.options.scaled_height = *height = *target_height;
+	}
+
+	// Decode straight into premultiplied BGRA, which is the layout of cairo's ARGB32
+	size_t stride = (*width) * 4;
+	uint8_t *bgra_data = malloc(stride * (*height));
+	if (bgra_data == NULL)
+	{
+		return NULL;
+	}
+	config.output.colorspace = MODE_bgrA;
+	config.output.is_external_memory = 1;
+	config.output.u.RGBA.rgba = bgra_data;
+	config.output.u.RGBA.stride = stride;
+	config.output.u.RGBA.size = stride * (*height);
+	if (WebPDecode(webp_data, data_size, &config) != VP8_STATUS_OK)
+	{
+		WebPFreeDecBuffer(&config.output);
+		free(bgra_data);
+		return NULL;
+	}
+	WebPFreeDecBuffer(&config.output);
 
 	return bgra_data;
 }
 
-void nx_decode_image_do(nx_work_t *req)
+/**
+ * Resizes the decoded image to exactly the target size, for when the
+ * decoder could only get close to it (JPEG scaling factors), or when
+ * the target is larger than the image.
+ */
+static bool resize_image(nx_image_t *image, u32 width, u32 height)
 {
-	nx_decode_image_async_t *data = (nx_decode_image_async_t *)req->data;
-	data->image->format = identify_image_format(data->input, data->input_size);
-	if (data->image->format == FORMAT_PNG)
+	uint8_t *data = alloc_pixels(image->format, width * height * 4);
+	if (data == NULL)
+	{
+		return false;
+	}
+	if (width <= image->width && height <= image->height)
+	{
+		nx_downscale(data, width, height, image->data, image->width, image->height, image->width * 4);
+	}
+	else
+	{
+		cairo_surface_t *src = cairo_image_surface_create_for_data(
+			image->data, CAIRO_FORMAT_ARGB32, image->width, image->height, image->width * 4);
+		cairo_surface_t *dst = cairo_image_surface_create_for_data(
+			data, CAIRO_FORMAT_ARGB32, width, height, width * 4);
+		cairo_t *cr = cairo_create(dst);
+		cairo_scale(cr, (double)width / image->width, (double)height / image->height);
+		cairo_set_source_surface(cr, src, 0, 0);
+		cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_GOOD);
+		cairo_pattern_set_extend(cairo_get_source(cr), CAIRO_EXTEND_PAD);
+		cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+		cairo_paint(cr);
+		cairo_destroy(cr);
+		cairo_surface_destroy(dst);
+		cairo_surface_destroy(src);
+	}
+	free_pixels(image->format, image->data);
+	image->data = data;
+	image->width = width;
+	image->height = height;
+	return true;
+}
+
+// Decodes `input` into `image`, and returns an error message on failure.
+// `req` is only used to check whether the decode has been cancelled.
+static char *decode_image(nx_image_t *image, uint8_t *input, size_t input_size,
+						  u32 target_width, u32 target_height, nx_work_t *req)
+{
+	image->format = identify_image_format(input, input_size);
+	if (image->format == FORMAT_PNG)
 	{
-		data->image->data = decode_png(data->input, data->input_size, &data->image->width, &data->image->height);
+		image->data = decode_png(input, input_size, &image->width, &image->height, &target_width, &target_height, req);
 	}
-	else if (data->image->format == FORMAT_JPEG)
+	else if (image->format == FORMAT_JPEG)
 	{
-		if (decode_jpeg(data->input, data->input_size, &data->image->data, (int *)&data->image->width, (int *)&data->image->height))
+		if (decode_jpeg(input, input_size, &image->data, (int *)&image->width, (int *)&image->height, &target_width, &target_height))
 		{
-			data->err_str = tjGetErrorStr();
-			return;
+			return tjGetErrorStr();
 		}
 	}
-	else if (data->image->format == FORMAT_WEBP)
+	else if (image->format == FORMAT_WEBP)
 	{
-		data->image->data = decode_webp(data->input, data->input_size, (int *)&data->image->width, (int *)&data->image->height);
+		image->data = decode_webp(input, input_size, (int *)&image->width, (int *)&image->height, &target_width, &target_height);
 	}
 	else
 	{
-		data->err_str = "Unsupported image format";
-		return;
+		return "Unsupported image format";
 	}
-	if (data->image->data == NULL)
+	if (image->data == NULL)
 	{
-		data->err_str = "Image decode was not initialized";
-		return;
+		return "Image decode was not initialized";
 	}
-	data->image->surface = cairo_image_surface_create_for_data(
-		data->image->data,
+	if (target_width && target_height &&
+		(image->width != target_width || image->height != target_height) &&
+		!resize_image(image, target_width, target_height))
+	{
+		return "Failed to allocate resized image";
+	}
+	image->surface = cairo_image_surface_create_for_data(
+		image->data,
 		CAIRO_FORMAT_ARGB32,
-		data->image->width,
-		data->image->height,
-		data->image->width * 4);
+		image->width,
+		image->height,
+		image->width * 4);
+	return NULL;
+}
+
+void nx_decode_image_do(nx_work_t *req)
+{
+	nx_decode_image_async_t *data = (nx_decode_image_async_t *)req->data;
+	data->err_str = decode_image(data->image, data->input, data->input_size,
+								 data->target_width, data->target_height, req);
 }
 
 JSValue nx_decode_image_cb(JSContext *ctx, nx_work_t *req)
@@ -259,9 +478,836 @@ JSValue nx_image_decode(JSContext *ctx, JSValueConst this_val, int argc, JSValue
 	data->image_val = JS_DupValue(ctx, argv[0]);
 	data->buffer_val = JS_DupValue(ctx, argv[1]);
 	data->input = JS_GetArrayBuffer(ctx, &data->input_size, data->buffer_val);
+	if (argc > 3 && (JS_ToUint32(ctx, &data->target_width, argv[2]) ||
+					 JS_ToUint32(ctx, &data->target_height, argv[3])))
+	{
+		JS_FreeValue(ctx, data->image_val);
+		JS_FreeValue(ctx, data->buffer_val);
+		nx_work_free(JS_GetContextOpaque(ctx), req);
+		return JS_EXCEPTION;
+	}
+
+	// Decoded images are usually needed for the next frame,
+	// so don't let them wait behind file system or DNS work
+	req->priority = NX_THREAD_POOL_PRIORITY_HIGH;
 	return nx_queue_async(ctx, req, nx_decode_image_do, nx_decode_image_cb);
 }
 
+typedef struct
+{
+	nx_image_t *image;
+	JSValue image_val;
+	JSValue buffer_val;
+	uint8_t *input;
+	size_t input_size;
+	char *err_str;
+} decode_batch_item_t;
+
+/**
+ * Decodes many images with a single request (i.e. the assets of a level),
+ * so that there is one Promise and one completion callback for the whole
+ * batch instead of one per image. The request's work callback and a job
+ * per remaining worker thread all pull images off a shared index, so the
+ * images are decoded in parallel. Each job holds a reference on the
+ * request, so it completes once the last image has been decoded.
+ */
+typedef struct
+{
+	decode_batch_item_t *items;
+	uint32_t count;
+	u32 target_width;
+	u32 target_height;
+	nx_work_t *req;
+	atomic_uint next_item;
+	nx_thread_pool_job_t jobs[];
+} decode_batch_t;
+
+typedef struct
+{
+	decode_batch_t *batch;
+} nx_decode_image_batch_async_t;
+
+static void decode_batch_items(decode_batch_t *b)
+{
+	uint32_t i;
+	while ((i = atomic_fetch_add(&b->next_item, 1)) < b->count)
+	{
+		// Skip the rest of the images once the request is cancelled
+		if (nx_work_cancelled(b->req))
+			continue;
+		decode_batch_item_t *item = &b->items[i];
+		item->err_str = decode_image(item->image, item->input, item->input_size,
+									 b->target_width, b->target_height, b->req);
+	}
+}
+
+static void decode_batch_job(void *arg)
+{
+	decode_batch_t *b = arg;
+	decode_batch_items(b);
+	nx_work_unref(b->req);
+}
+
+static void nx_decode_image_batch_do(nx_work_t *req)
+{
+	nx_decode_image_batch_async_t *data = (nx_decode_image_batch_async_t *)req->data;
+	decode_batch_items(data->batch);
+}
+
+static JSValue nx_decode_image_batch_cb(JSContext *ctx, nx_work_t *req)
+{
+	nx_decode_image_batch_async_t *data = (nx_decode_image_batch_async_t *)req->data;
+	decode_batch_t *b = data->batch;
+
+	// Every job has finished with the batch by the time the request completes
+	JSValue results = JS_NewArray(ctx);
+	for (uint32_t i = 0; i < b->count; i++)
+	{
+		decode_batch_item_t *item = &b->items[i];
+		JSValue result = JS_UNDEFINED;
+		if (item->err_str)
+		{
+			result = JS_NewError(ctx);
+			JS_DefinePropertyValueStr(ctx, result, "message", JS_NewString(ctx, item->err_str), JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE);
+		}
+		JS_SetPropertyUint32(ctx, results, i, result);
+		JS_FreeValue(ctx, item->image_val);
+		JS_FreeValue(ctx, item->buffer_val);
+	}
+	free(b->items);
+	free(b);
+	return results;
+}
+
+static JSValue nx_image_decode_batch(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_context_t *nx_ctx = JS_GetContextOpaque(ctx);
+	uint32_t count;
+	JSValue length_val = JS_GetPropertyStr(ctx, argv[0], "length");
+	int err = JS_ToUint32(ctx, &count, length_val);
+	JS_FreeValue(ctx, length_val);
+	if (err)
+		return JS_EXCEPTION;
+	u32 target_width = 0, target_height = 0;
+	if (argc > 3 && (JS_ToUint32(ctx, &target_width, argv[2]) ||
+					 JS_ToUint32(ctx, &target_height, argv[3])))
+		return JS_EXCEPTION;
+
+	int num_jobs = nx_thread_pool_num_threads(nx_ctx->thpool) - 1;
+	if (num_jobs > (int)count - 1)
+		num_jobs = (int)count - 1;
+	if (num_jobs < 0)
+		num_jobs = 0;
+	decode_batch_t *b = calloc(1, sizeof(decode_batch_t) + num_jobs * sizeof(nx_thread_pool_job_t));
+	decode_batch_item_t *items = count ? calloc(count, sizeof(decode_batch_item_t)) : NULL;
+	if (!b || (count && !items))
+	{
+		free(b);
+		free(items);
+		return JS_ThrowOutOfMemory(ctx);
+	}
+
+	uint32_t i;
+	for (i = 0; i < count; i++)
+	{
+		decode_batch_item_t *item = &items[i];
+		item->image_val = JS_GetPropertyUint32(ctx, argv[0], i);
+		item->buffer_val = JS_GetPropertyUint32(ctx, argv[1], i);
+		item->image = nx_get_image(ctx, item->image_val);
+		if (!item->image)
+			goto fail;
+		item->input = JS_GetArrayBuffer(ctx, &item->input_size, item->buffer_val);
+		if (!item->input)
+			goto fail;
+
+		// Every image is written to by the thread that decodes it
+		for (uint32_t j = 0; j < i; j++)
+		{
+			if (items[j].image == item->image)
+			{
+				JS_ThrowTypeError(ctx, "The same image can not be decoded twice in a batch");
+				goto fail;
+			}
+		}
+	}
+
+	nx_work_t *req = nx_work_new(nx_ctx);
+	if (!req)
+	{
+		JS_ThrowOutOfMemory(ctx);
+		goto fail;
+	}
+	nx_decode_image_batch_async_t *data = req->data;
+	b->items = items;
+	b->count = count;
+	b->target_width = target_width;
+	b->target_height = target_height;
+	b->req = req;
+	atomic_init(&b->next_item, 0);
+	data->batch = b;
+
+	// The references are taken up front, since the work
+	// callback may decode every image before the jobs start
+	for (int j = 0; j < num_jobs; j++)
+		nx_work_ref(req);
+	req->priority = NX_THREAD_POOL_PRIORITY_HIGH;
+	JSValue promise = nx_queue_async(ctx, req, nx_decode_image_batch_do, nx_decode_image_batch_cb);
+
+	for (int j = 0; j < num_jobs; j++)
+	{
+		b->jobs[j].fn = decode_batch_job;
+		b->jobs[j].arg = b;
+		if (nx_thread_pool_add_work(nx_ctx->thpool, &b->jobs[j], NX_THREAD_POOL_PRIORITY_HIGH))
+			nx_work_unref(req);
+	}
+	return promise;
+
+fail:
+	for (uint32_t j = 0; j < count && j <= i; j++)
+	{
+		JS_FreeValue(ctx, items[j].image_val);
+		JS_FreeValue(ctx, items[j].buffer_val);
+	}
+	free(items);
+	free(b);
+	return JS_EXCEPTION;
+}
+
+/**
+ * Incremental decoder, which is written to chunk by chunk as the encoded
+ * image arrives (i.e. from a `fetch()` response body). Every chunk is
+ * decoded on the thread pool as far as the data allows, so the encoded
+ * image never needs to be buffered in full, and the decoded rows can be
+ * drawn before the rest of the image has arrived.
+ *
+ * Once the size of the image is known, the pixels are shared with the
+ * `Image` (through the reference counted cairo surface, which owns them),
+ * so a decoder which is still writing rows after the `Image` has moved on
+ * to another source never writes into freed memory.
+ */
+static JSClassID nx_image_decoder_class_id;
+
+static const cairo_user_data_key_t decoder_pixels_key;
+
+enum decoder_jpeg_stage
+{
+	JPEG_HEADER,
+	JPEG_START,
+	JPEG_SCANLINES,
+	JPEG_FINISH
+};
+
+typedef struct
+{
+	JSValue image_val;
+	nx_image_t *image;
+	enum ImageFormat format;
+
+	// Encoded bytes which have been received but not decoded yet. Used to
+	// identify the format, to wait for the WebP header, and as JPEG input.
+	uint8_t *pending;
+	size_t pending_size;
+	size_t pending_capacity;
+
+	// Set on the thread pool once the size of the image is known
+	u32 width;
+	u32 height;
+	uint8_t *data;
+	cairo_surface_t *surface;
+	bool has_alpha;
+	// Alpha is premultiplied once the whole image has been decoded,
+	// so the rows can not be drawn before then (interlaced PNGs)
+	bool straight_alpha;
+	bool done;
+	const char *err_str;
+	char message[JMSG_LENGTH_MAX];
+
+	// Only accessed on the JS thread
+	bool busy;
+	bool closed;
+	bool published;
+
+	png_structp png;
+	png_infop png_info;
+
+	struct jpeg_decompress_struct jpeg;
+	struct jpeg_source_mgr jpeg_source;
+	struct jpeg_error_mgr jpeg_error;
+	jmp_buf jpeg_jmp;
+	bool jpeg_created;
+	enum decoder_jpeg_stage jpeg_stage;
+	// Bytes which libjpeg has asked to skip, but have not been received yet
+	size_t jpeg_skip;
+
+	WebPIDecoder *webp;
+} nx_image_decoder_t;
+
+typedef struct
+{
+	nx_image_decoder_t *decoder;
+	JSValue decoder_val;
+	JSValue buffer_val;
+	uint8_t *input;
+	size_t input_size;
+} nx_image_decoder_write_async_t;
+
+static nx_image_decoder_t *nx_get_image_decoder(JSContext *ctx, JSValueConst obj)
+{
+	return JS_GetOpaque2(ctx, obj, nx_image_decoder_class_id);
+}
+
+static bool append_pending(nx_image_decoder_t *decoder, const uint8_t *input, size_t size)
+{
+	if (size == 0)
+	{
+		return true;
+	}
+	if (decoder->pending_size + size > decoder->pending_capacity)
+	{
+		size_t capacity = decoder->pending_capacity * 2;
+		if (capacity < decoder->pending_size + size)
+		{
+			capacity = decoder->pending_size + size;
+		}
+		uint8_t *pending = realloc(decoder->pending, capacity);
+		if (!pending)
+		{
+			return false;
+		}
+		decoder->pending = pending;
+		decoder->pending_capacity = capacity;
+	}
+	memcpy(decoder->pending + decoder->pending_size, input, size);
+	decoder->pending_size += size;
+	return true;
+}
+
+// Allocates the pixels (transparent until they are decoded) and the surface which owns them
+static bool alloc_decoder_pixels(nx_image_decoder_t *decoder, u32 width, u32 height)
+{
+	uint8_t *data = calloc(height, (size_t)width * 4);
+	if (!data)
+	{
+		return false;
+	}
+	cairo_surface_t *surface = cairo_image_surface_create_for_data(
+		data, CAIRO_FORMAT_ARGB32, width, height, width * 4);
+	if (cairo_surface_set_user_data(surface, &decoder_pixels_key, data, free) != CAIRO_STATUS_SUCCESS)
+	{
+		cairo_surface_destroy(surface);
+		free(data);
+		return false;
+	}
+	decoder->width = width;
+	decoder->height = height;
+	decoder->data = data;
+	decoder->surface = surface;
+	return true;
+}
+
+static void decoder_png_error(png_structp png, png_const_charp message)
+{
+	nx_image_decoder_t *decoder = png_get_error_ptr(png);
+	snprintf(decoder->message, sizeof(decoder->message), "%s", message);
+	png_longjmp(png, 1);
+}
+
+static void decoder_png_warning(png_structp png, png_const_charp message)
+{
+}
+
+static void decoder_png_info(png_structp png, png_infop info)
+{
+	nx_image_decoder_t *decoder = png_get_progressive_ptr(png);
+	decoder->has_alpha = (png_get_color_type(png, info) & PNG_COLOR_MASK_ALPHA) ||
+						 png_get_valid(png, info, PNG_INFO_tRNS);
+
+	png_set_expand(png);
+	png_set_strip_16(png);
+	png_set_gray_to_rgb(png);
+	png_set_bgr(png);
+	png_set_add_alpha(png, 0xff, PNG_FILLER_AFTER);
+	int passes = png_set_interlace_handling(png);
+	png_read_update_info(png, info);
+
+	// Rows of later passes are combined with the rows of earlier passes,
+	// which must not be premultiplied yet
+	decoder->straight_alpha = decoder->has_alpha && passes > 1;
+
+	if (!alloc_decoder_pixels(decoder, png_get_image_width(png, info), png_get_image_height(png, info)))
+	{
+		png_error(png, "Failed to allocate image");
+	}
+}
+
+static void decoder_png_row(png_structp png, png_bytep new_row, png_uint_32 row_num, int pass)
+{
+	nx_image_decoder_t *decoder = png_get_progressive_ptr(png);
+	if (!new_row)
+	{
+		// Row is unchanged in this pass
+		return;
+	}
+	uint8_t *row = decoder->data + (size_t)row_num * decoder->width * 4;
+	png_progressive_combine_row(png, row, new_row);
+	if (decoder->has_alpha && !decoder->straight_alpha)
+	{
+		nx_premultiply(row, decoder->width);
+	}
+}
+
+static void decoder_png_end(png_structp png, png_infop info)
+{
+	nx_image_decoder_t *decoder = png_get_progressive_ptr(png);
+	if (decoder->straight_alpha)
+	{
+		nx_premultiply(decoder->data, (size_t)decoder->width * decoder->height);
+	}
+	decoder->done = true;
+}
+
+static bool decoder_png_write(nx_image_decoder_t *decoder, uint8_t *input, size_t size)
+{
+	if (setjmp(png_jmpbuf(decoder->png)))
+	{
+		decoder->err_str = decoder->message;
+		return false;
+	}
+	if (decoder->pending_size)
+	{
+		png_process_data(decoder->png, decoder->png_info, decoder->pending, decoder->pending_size);
+		decoder->pending_size = 0;
+	}
+	if (size && !decoder->done)
+	{
+		png_process_data(decoder->png, decoder->png_info, input, size);
+	}
+	return true;
+}
+
+static void decoder_jpeg_error_exit(j_common_ptr cinfo)
+{
+	nx_image_decoder_t *decoder = cinfo->client_data;
+	(*cinfo->err->format_message)(cinfo, decoder->message);
+	longjmp(decoder->jpeg_jmp, 1);
+}
+
+static void decoder_jpeg_output_message(j_common_ptr cinfo)
+{
+}
+
+static void decoder_jpeg_source_noop(j_decompress_ptr cinfo)
+{
+}
+
+// Suspends decoding until the next chunk has been written
+static boolean decoder_jpeg_fill_input_buffer(j_decompress_ptr cinfo)
+{
+	return FALSE;
+}
+
+static void decoder_jpeg_skip_input_data(j_decompress_ptr cinfo, long num_bytes)
+{
+	nx_image_decoder_t *decoder = cinfo->client_data;
+	struct jpeg_source_mgr *src = cinfo->src;
+	if (num_bytes <= 0)
+	{
+		return;
+	}
+	if ((size_t)num_bytes > src->bytes_in_buffer)
+	{
+		decoder->jpeg_skip += num_bytes - src->bytes_in_buffer;
+		num_bytes = src->bytes_in_buffer;
+	}
+	src->next_input_byte += num_bytes;
+	src->bytes_in_buffer -= num_bytes;
+}
+
+static bool decoder_jpeg_write(nx_image_decoder_t *decoder, uint8_t *input, size_t size)
+{
+	// Drop the bytes which libjpeg has consumed, and append the new ones
+	struct jpeg_source_mgr *src = &decoder->jpeg_source;
+	size_t remaining = src->bytes_in_buffer;
+	memmove(decoder->pending, src->next_input_byte, remaining);
+	decoder->pending_size = remaining;
+	bool appended = true;
+	if (size)
+	{
+		size_t skip = decoder->jpeg_skip < size ? decoder->jpeg_skip : size;
+		decoder->jpeg_skip -= skip;
+		appended = append_pending(decoder, input + skip, size - skip);
+	}
+	src->next_input_byte = decoder->pending;
+	src->bytes_in_buffer = decoder->pending_size;
+	if (!appended)
+	{
+		decoder->err_str = "Failed to allocate image data";
+		return false;
+	}
+
+	if (setjmp(decoder->jpeg_jmp))
+	{
+		decoder->err_str = decoder->message;
+		return false;
+	}
+	switch (decoder->jpeg_stage)
+	{
+	case JPEG_HEADER:
+		if (jpeg_read_header(&decoder->jpeg, TRUE) == JPEG_SUSPENDED)
+		{
+			return true;
+		}
+		// Same output as `tjDecompress2()` with `TJPF_BGRA` and `TJFLAG_FASTDCT`
+		decoder->jpeg.out_color_space = JCS_EXT_BGRA;
+		decoder->jpeg.dct_method = JDCT_IFAST;
+		if (!alloc_decoder_pixels(decoder, decoder->jpeg.image_width, decoder->jpeg.image_height))
+		{
+			decoder->err_str = "Failed to allocate image";
+			return false;
+		}
+		decoder->jpeg_stage = JPEG_START;
+		// fall through
+	case JPEG_START:
+		// Progressive JPEGs suspend here until all of their scans have been received
+		if (!jpeg_start_decompress(&decoder->jpeg))
+		{
+			return true;
+		}
+		decoder->jpeg_stage = JPEG_SCANLINES;
+		// fall through
+	case JPEG_SCANLINES:
+		while (decoder->jpeg.output_scanline < decoder->jpeg.output_height)
+		{
+			JSAMPROW row = decoder->data + (size_t)decoder->jpeg.output_scanline * decoder->width * 4;
+			if (jpeg_read_scanlines(&decoder->jpeg, &row, 1) == 0)
+			{
+				return true;
+			}
+		}
+		decoder->jpeg_stage = JPEG_FINISH;
+		// fall through
+	case JPEG_FINISH:
+		if (!jpeg_finish_decompress(&decoder->jpeg))
+		{
+			return true;
+		}
+		decoder->done = true;
+	}
+	return true;
+}
+
+static bool decoder_webp_write(nx_image_decoder_t *decoder, uint8_t *input, size_t size)
+{
+	if (!decoder->webp)
+	{
+		// The pixels can only be allocated once the header has been received
+		WebPBitstreamFeatures features;
+		if (!append_pending(decoder, input, size))
+		{
+			decoder->err_str = "Failed to allocate image data";
+			return false;
+		}
+		VP8StatusCode status = WebPGetFeatures(decoder->pending, decoder->pending_size, &features);
+		if (status == VP8_STATUS_NOT_ENOUGH_DATA)
+		{
+			return true;
+		}
+		if (status != VP8_STATUS_OK)
+		{
+			decoder->err_str = "Invalid WebP image data";
+			return false;
+		}
+		if (!alloc_decoder_pixels(decoder, features.width, features.height))
+		{
+			decoder->err_str = "Failed to allocate image";
+			return false;
+		}
+		// Decode straight into premultiplied BGRA, which is the layout of cairo's ARGB32
+		decoder->webp = WebPINewRGB(MODE_bgrA, decoder->data,
+									(size_t)decoder->width * decoder->height * 4, decoder->width * 4);
+		if (!decoder->webp)
+		{
+			decoder->err_str = "Failed to allocate image";
+			return false;
+		}
+		input = decoder->pending;
+		size = decoder->pending_size;
+	}
+	// libwebp keeps its own copy of the data which it has not decoded yet
+	VP8StatusCode status = WebPIAppend(decoder->webp, input, size);
+	decoder->pending_size = 0;
+	if (status == VP8_STATUS_OK)
+	{
+		decoder->done = true;
+	}
+	else if (status != VP8_STATUS_SUSPENDED)
+	{
+		decoder->err_str = "Invalid WebP image data";
+		return false;
+	}
+	return true;
+}
+
+static bool init_decoder(nx_image_decoder_t *decoder)
+{
+	if (decoder->format == FORMAT_PNG)
+	{
+		decoder->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, decoder, decoder_png_error, decoder_png_warning);
+		decoder->png_info = decoder->png ? png_create_info_struct(decoder->png) : NULL;
+		if (!decoder->png_info)
+		{
+			decoder->err_str = "Failed to initialize PNG decoder";
+			return false;
+		}
+		png_set_progressive_read_fn(decoder->png, decoder, decoder_png_info, decoder_png_row, decoder_png_end);
+	}
+	else if (decoder->format == FORMAT_JPEG)
+	{
+		decoder->jpeg.err = jpeg_std_error(&decoder->jpeg_error);
+		decoder->jpeg_error.error_exit = decoder_jpeg_error_exit;
+		decoder->jpeg_error.output_message = decoder_jpeg_output_message;
+		decoder->jpeg.client_data = decoder;
+		if (setjmp(decoder->jpeg_jmp))
+		{
+			decoder->err_str = decoder->message;
+			return false;
+		}
+		jpeg_create_decompress(&decoder->jpeg);
+		decoder->jpeg_created = true;
+		decoder->jpeg_source.init_source = decoder_jpeg_source_noop;
+		decoder->jpeg_source.fill_input_buffer = decoder_jpeg_fill_input_buffer;
+		decoder->jpeg_source.skip_input_data = decoder_jpeg_skip_input_data;
+		decoder->jpeg_source.resync_to_restart = jpeg_resync_to_restart;
+		decoder->jpeg_source.term_source = decoder_jpeg_source_noop;
+		decoder->jpeg_source.next_input_byte = decoder->pending;
+		decoder->jpeg_source.bytes_in_buffer = decoder->pending_size;
+		decoder->jpeg.src = &decoder->jpeg_source;
+	}
+	return true;
+}
+
+static void free_decoder_state(nx_image_decoder_t *decoder)
+{
+	if (decoder->png)
+	{
+		png_destroy_read_struct(&decoder->png, &decoder->png_info, NULL);
+	}
+	if (decoder->jpeg_created)
+	{
+		jpeg_destroy_decompress(&decoder->jpeg);
+		decoder->jpeg_created = false;
+	}
+	if (decoder->webp)
+	{
+		WebPIDelete(decoder->webp);
+		decoder->webp = NULL;
+	}
+	free(decoder->pending);
+	decoder->pending = NULL;
+	decoder->pending_size = decoder->pending_capacity = 0;
+	if (decoder->surface)
+	{
+		// The `Image` holds its own reference once the pixels have been published
+		cairo_surface_destroy(decoder->surface);
+		decoder->surface = NULL;
+		decoder->data = NULL;
+	}
+}
+
+static void nx_image_decoder_write_do(nx_work_t *req)
+{
+	nx_image_decoder_write_async_t *data = (nx_image_decoder_write_async_t *)req->data;
+	nx_image_decoder_t *decoder = data->decoder;
+	uint8_t *input = data->input;
+	size_t size = data->input_size;
+
+	// Trailing data after the end of the image is ignored
+	if (decoder->done || decoder->err_str)
+	{
+		return;
+	}
+
+	if (decoder->format == FORMAT_UNKNOWN)
+	{
+		if (!append_pending(decoder, input, size))
+		{
+			decoder->err_str = "Failed to allocate image data";
+			return;
+		}
+		decoder->format = identify_image_format(decoder->pending, decoder->pending_size);
+		if (decoder->format == FORMAT_UNKNOWN)
+		{
+			// The longest signature (WebP) is 12 bytes
+			if (decoder->pending_size >= 12)
+			{
+				decoder->err_str = "Unsupported image format";
+			}
+			return;
+		}
+		if (!init_decoder(decoder))
+		{
+			return;
+		}
+		// Everything received so far is pending
+		input = NULL;
+		size = 0;
+	}
+
+	if (decoder->format == FORMAT_PNG)
+	{
+		decoder_png_write(decoder, input, size);
+	}
+	else if (decoder->format == FORMAT_JPEG)
+	{
+		decoder_jpeg_write(decoder, input, size);
+	}
+	else
+	{
+		decoder_webp_write(decoder, input, size);
+	}
+}
+
+// Makes the rows decoded so far visible to the `Image`
+static void publish_decoded_rows(JSContext *ctx, nx_image_decoder_t *decoder)
+{
+	if (!decoder->surface || (decoder->straight_alpha && !decoder->done))
+	{
+		return;
+	}
+	if (!decoder->published)
+	{
+		nx_image_set_surface(JS_GetRuntime(ctx), decoder->image, decoder->surface, decoder->format);
+		decoder->published = true;
+	}
+	cairo_surface_mark_dirty(decoder->surface);
+}
+
+static JSValue nx_image_decoder_write_cb(JSContext *ctx, nx_work_t *req)
+{
+	nx_image_decoder_write_async_t *data = (nx_image_decoder_write_async_t *)req->data;
+	nx_image_decoder_t *decoder = data->decoder;
+	JSValue ret = JS_UNDEFINED;
+
+	decoder->busy = false;
+	if (decoder->closed)
+	{
+		// Closed while this chunk was being decoded
+		free_decoder_state(decoder);
+	}
+	else if (decoder->err_str)
+	{
+		JSValue err = JS_NewError(ctx);
+		JS_DefinePropertyValueStr(ctx, err, "message", JS_NewString(ctx, decoder->err_str), JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE);
+		ret = JS_Throw(ctx, err);
+	}
+	else
+	{
+		publish_decoded_rows(ctx, decoder);
+	}
+
+	JS_FreeValue(ctx, data->buffer_val);
+	JS_FreeValue(ctx, data->decoder_val);
+	return ret;
+}
+
+static JSValue nx_image_decoder_new(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_image_t *image = nx_get_image(ctx, argv[0]);
+	if (!image)
+	{
+		return JS_EXCEPTION;
+	}
+	JSValue obj = JS_NewObjectClass(ctx, nx_image_decoder_class_id);
+	if (JS_IsException(obj))
+	{
+		return obj;
+	}
+	nx_image_decoder_t *decoder = js_mallocz(ctx, sizeof(nx_image_decoder_t));
+	if (!decoder)
+	{
+		JS_FreeValue(ctx, obj);
+		return JS_EXCEPTION;
+	}
+	decoder->image_val = JS_DupValue(ctx, argv[0]);
+	decoder->image = image;
+	decoder->format = FORMAT_UNKNOWN;
+	JS_SetOpaque(obj, decoder);
+	return obj;
+}
+
+static JSValue nx_image_decoder_write(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_image_decoder_t *decoder = nx_get_image_decoder(ctx, argv[0]);
+	if (!decoder)
+	{
+		return JS_EXCEPTION;
+	}
+	if (decoder->closed)
+	{
+		return JS_ThrowTypeError(ctx, "Image decoder is closed");
+	}
+	if (decoder->busy)
+	{
+		return JS_ThrowTypeError(ctx, "Image decoder is already decoding a chunk");
+	}
+	size_t size;
+	uint8_t *buffer = JS_GetArrayBuffer(ctx, &size, argv[1]);
+	if (!buffer)
+	{
+		return JS_EXCEPTION;
+	}
+	uint32_t offset, length;
+	if (JS_ToUint32(ctx, &offset, argv[2]) || JS_ToUint32(ctx, &length, argv[3]))
+	{
+		return JS_EXCEPTION;
+	}
+	if (offset > size || length > size - offset)
+	{
+		return JS_ThrowRangeError(ctx, "Chunk is out of bounds");
+	}
+
+	NX_INIT_WORK_T(nx_image_decoder_write_async_t);
+	data->decoder = decoder;
+	data->decoder_val = JS_DupValue(ctx, argv[0]);
+	data->buffer_val = JS_DupValue(ctx, argv[1]);
+	data->input = buffer + offset;
+	data->input_size = length;
+	decoder->busy = true;
+
+	req->priority = NX_THREAD_POOL_PRIORITY_HIGH;
+	return nx_queue_async(ctx, req, nx_image_decoder_write_do, nx_image_decoder_write_cb);
+}
+
+// Returns `true` if the whole image was decoded
+static JSValue nx_image_decoder_close(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_image_decoder_t *decoder = nx_get_image_decoder(ctx, argv[0]);
+	if (!decoder)
+	{
+		return JS_EXCEPTION;
+	}
+	decoder->closed = true;
+	if (decoder->busy)
+	{
+		// Freed once the chunk which is being decoded is done
+		return JS_FALSE;
+	}
+	bool done = decoder->done && !decoder->err_str;
+	free_decoder_state(decoder);
+	return JS_NewBool(ctx, done);
+}
+
+static void finalizer_image_decoder(JSRuntime *rt, JSValue val)
+{
+	nx_image_decoder_t *decoder = JS_GetOpaque(val, nx_image_decoder_class_id);
+	if (decoder)
+	{
+		free_decoder_state(decoder);
+		JS_FreeValueRT(rt, decoder->image_val);
+		js_free_rt(rt, decoder);
+	}
+}
+
 JSValue nx_image_new(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
 {
 	JSValue img = JS_NewObjectClass(ctx, nx_image_class_id);
@@ -347,7 +1393,11 @@ static const JSCFunctionListEntry function_list[] = {
 	JS_CFUNC_DEF("imageInit", 0, nx_image_init_class),
 	JS_CFUNC_DEF("imageNew", 0, nx_image_new),
 	JS_CFUNC_DEF("imageDecode", 0, nx_image_decode),
+	JS_CFUNC_DEF("imageDecodeBatch", 0, nx_image_decode_batch),
 	JS_CFUNC_DEF("imageClose", 0, nx_image_close),
+	JS_CFUNC_DEF("imageDecoderNew", 0, nx_image_decoder_new),
+	JS_CFUNC_DEF("imageDecoderWrite", 0, nx_image_decoder_write),
+	JS_CFUNC_DEF("imageDecoderClose", 0, nx_image_decoder_close),
 };
 
 void nx_init_image(JSContext *ctx, JSValueConst init_obj)
@@ -361,5 +1411,12 @@ void nx_init_image(JSContext *ctx, JSValueConst init_obj)
 	};
 	JS_NewClass(rt, nx_image_class_id, &image_class);
 
+	JS_NewClassID(rt, &nx_image_decoder_class_id);
+	JSClassDef image_decoder_class = {
+		"ImageDecoder",
+		.finalizer = finalizer_image_decoder,
+	};
+	JS_NewClass(rt, nx_image_decoder_class_id, &image_decoder_class);
+
 	JS_SetPropertyFunctionList(ctx, init_obj, function_list, countof(function_list));
 }
@@ -19,10 +19,16 @@ typedef struct
 	u32 height;
 	u8 *data;
 	bool data_needs_js_free;
+	// `data` is freed along with `surface` (i.e. when it is shared with an incremental decoder)
+	bool data_owned_by_surface;
 	cairo_surface_t *surface;
 	enum ImageFormat format;
 } nx_image_t;
 
 nx_image_t *nx_get_image(JSContext *ctx, JSValueConst obj);
 
+// Replaces the pixels of `image` with a reference to `surface`,
+// which must own its pixels (so they can be shared between images)
+void nx_image_set_surface(JSRuntime *rt, nx_image_t *image, cairo_surface_t *surface, enum ImageFormat format);
+
 void nx_init_image(JSContext *ctx, JSValueConst init_obj);
@@ -19,28 +19,58 @@
 #include "dommatrix.h"
 #include "error.h"
 #include "font.h"
+#include "frame-timing.h"
+#include "glyph-atlas.h"
+#include "glyph-cache.h"
 #include "fs.h"
 #include "fsdev.h"
 #include "irs.h"
 #include "nifm.h"
 #include "ns.h"
+#include "path2d.h"
 #include "software-keyboard.h"
 #include "wasm.h"
 #include "image.h"
+#include "image-cache.h"
 #include "tcp.h"
+#include "timers.h"
 #include "tls.h"
 #include "url.h"
 #include "poll.h"
+#include "pixels.h"
 
 #define LOG_FILENAME "nxjs-debug.log"
 
+// Target duration of a single frame (60 FPS)
+#define FRAME_INTERVAL_NS (1000000000ULL / 60)
+
+// Default time budget for draining async completions and for draining
+// Promise jobs in each iteration of the main loop, and the minimum allowed
+#define DRAIN_BUDGET_NS 8000000ULL
+#define MIN_DRAIN_NS 1000000ULL
+
+#define NX_THREAD_POOL_DEFAULT_SIZE 4
+#define NX_THREAD_POOL_MAX_SIZE 16
+
+// Number of display buffers used by the canvas renderer
+#define NX_FRAMEBUFFER_COUNT 2
+
 // Text renderer
 static PrintConsole *print_console = NULL;
 
 // Framebuffer renderer
 static NWindow *win = NULL;
 static Framebuffer *framebuffer = NULL;
-static uint8_t *js_framebuffer = NULL;
+static nx_canvas_t *js_framebuffer = NULL;
+
+// Regions of each display buffer which are out of date with the JS framebuffer
+static nx_damage_t framebuffer_damage[NX_FRAMEBUFFER_COUNT];
+
+// Canvas which is composited over the JS framebuffer when presenting,
+// without modifying the JS framebuffer (used for the performance overlay)
+static nx_canvas_t *overlay = NULL;
+static nx_rect_t overlay_rect;
+static uint8_t *overlay_scratch = NULL;
 
 void nx_console_exit()
 {
@@ -71,16 +101,26 @@ static JSValue nx_framebuffer_init(JSContext *ctx, JSValueConst this_val, int ar
 		return JS_EXCEPTION;
 	width = canvas->width;
 	height = canvas->height;
-	js_framebuffer = canvas->data;
+	js_framebuffer = canvas;
 	framebuffer = malloc(sizeof(Framebuffer));
-	framebufferCreate(framebuffer, win, width, height, PIXEL_FORMAT_BGRA_8888, 2);
-	framebufferMakeLinear(framebuffer);
+	framebufferCreate(framebuffer, win, width, height, PIXEL_FORMAT_BGRA_8888, NX_FRAMEBUFFER_COUNT);
+
+	// The new display buffers' contents are undefined, so present the whole canvas
+	nx_rect_t all = {0, 0, width, height};
+	for (int i = 0; i < NX_FRAMEBUFFER_COUNT; i++)
+	{
+		framebuffer_damage[i].count = 0;
+		nx_damage_add(&framebuffer_damage[i], &all);
+	}
 	nx_ctx->rendering_mode = NX_RENDERING_MODE_CANVAS;
 	return JS_UNDEFINED;
 }
 
 void nx_framebuffer_exit()
 {
+	free(overlay_scratch);
+	overlay_scratch = NULL;
+	overlay = NULL;
 	if (framebuffer != NULL)
 	{
 		framebufferClose(framebuffer);
@@ -90,6 +130,109 @@ void nx_framebuffer_exit()
 	}
 }
 
+/**
+ * Copies the damaged regions of the JS framebuffer directly into the
+ * current display buffer, converting to the GPU's block linear layout
+ * on the way, and sends it to the display. Nothing is presented when
+ * nothing has been drawn since the previous frame.
+ *
+ * The display buffers are used in turn, so each one is brought up to
+ * date with everything drawn since it was last presented (i.e. the
+ * damage of the previous frame is copied forward as well).
+ *
+ * Returns `false` when no frame was sent to the display.
+ */
+static bool nx_framebuffer_present()
+{
+	nx_canvas_t *canvas = js_framebuffer;
+	bool overlay_damaged = overlay && overlay->damage.count;
+	if (!canvas->damage.count && !overlay_damaged)
+		return false;
+	if (overlay)
+		overlay->damage.count = 0;
+
+	for (int i = 0; i < NX_FRAMEBUFFER_COUNT; i++)
+	{
+		for (u32 j = 0; j < canvas->damage.count; j++)
+			nx_damage_add(&framebuffer_damage[i], &canvas->damage.rects[j]);
+	}
+	canvas->damage.count = 0;
+
+	u32 stride;
+	u8 *framebuf = (u8 *)framebufferBegin(framebuffer, &stride);
+	if (!framebuf)
+		return false;
+
+	u32 slot = (framebuf - (u8 *)framebuffer->buf) / framebuffer->fb_size;
+	nx_damage_t *damage = &framebuffer_damage[slot];
+	for (u32 i = 0; i < damage->count; i++)
+	{
+		nx_rect_t *r = &damage->rects[i];
+		nx_copy_to_block_linear(
+			framebuf, stride, NX_BLOCK_HEIGHT_LOG2,
+			canvas->data + (r->y1 * canvas->width + r->x1) * 4, canvas->width * 4,
+			r->x1, r->y1, r->x2, r->y2);
+	}
+	damage->count = 0;
+
+	if (overlay)
+	{
+		// The overlay is drawn into every presented buffer, so the
+		// region under it is always redrawn from the JS framebuffer
+		nx_rect_t *r = &overlay_rect;
+		u32 width = r->x2 - r->x1;
+		u8 *dst = overlay_scratch;
+		for (int32_t y = r->y1; y < r->y2; y++)
+		{
+			memcpy(dst, canvas->data + (y * canvas->width + r->x1) * 4, width * 4);
+			nx_blend_over(dst, overlay->data + (y - r->y1) * overlay->width * 4, width);
+			dst += width * 4;
+		}
+		nx_copy_to_block_linear(
+			framebuf, stride, NX_BLOCK_HEIGHT_LOG2,
+			overlay_scratch, width * 4,
+			r->x1, r->y1, r->x2, r->y2);
+	}
+
+	// Flushes the data cache for the buffer and queues it for display
+	framebufferEnd(framebuffer);
+	return true;
+}
+
+static JSValue nx_framebuffer_set_overlay(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	if (overlay && js_framebuffer)
+	{
+		// Erase the previous overlay from the display buffers
+		nx_rect_t *r = &overlay_rect;
+		nx_canvas_damage(js_framebuffer, r->x1, r->y1, r->x2 - r->x1, r->y2 - r->y1);
+	}
+	free(overlay_scratch);
+	overlay_scratch = NULL;
+	overlay = NULL;
+	if (JS_IsNull(argv[0]))
+		return JS_UNDEFINED;
+
+	// The JS side must keep a reference to the overlay canvas
+	// until it has been unset, since only its pointer is stored
+	nx_canvas_t *canvas = nx_get_canvas(ctx, argv[0]);
+	if (!canvas || !js_framebuffer)
+		return JS_EXCEPTION;
+	int32_t x, y;
+	if (JS_ToInt32(ctx, &x, argv[1]) || JS_ToInt32(ctx, &y, argv[2]))
+		return JS_EXCEPTION;
+	if (x < 0 || y < 0 || x + canvas->width > js_framebuffer->width || y + canvas->height > js_framebuffer->height)
+		return JS_ThrowRangeError(ctx, "Overlay must be within the screen");
+
+	overlay_scratch = malloc(canvas->width * canvas->height * 4);
+	if (!overlay_scratch)
+		return JS_ThrowOutOfMemory(ctx);
+	overlay = canvas;
+	overlay_rect = (nx_rect_t){x, y, x + canvas->width, y + canvas->height};
+	nx_canvas_damage(overlay, 0, 0, canvas->width, canvas->height);
+	return JS_UNDEFINED;
+}
+
 uint8_t *read_file(const char *filename, size_t *out_size)
 {
 	FILE *file = fopen(filename, "rb");
@@ -440,7 +583,53 @@ int nx_module_set_import_meta(JSContext *ctx, JSValueConst func_val,
 	return 0;
 }
 
-void nx_process_pending_jobs(JSRuntime *rt)
+// Deserializes QuickJS bytecode that was produced by the `bytecode`
+// script of the `nxjs-runtime` package. When the bytecode represents
+// an ES module, then the module's imports are resolved as well.
+static JSValue nx_read_bytecode(JSContext *ctx, const uint8_t *buf, size_t buf_size)
+{
+	JSValue obj = JS_ReadObject(ctx, buf, buf_size, JS_READ_OBJ_BYTECODE);
+	if (JS_IsException(obj))
+	{
+		return obj;
+	}
+	if (JS_VALUE_GET_TAG(obj) == JS_TAG_MODULE && JS_ResolveModule(ctx, obj) < 0)
+	{
+		JS_FreeValue(ctx, obj);
+		return JS_EXCEPTION;
+	}
+	return obj;
+}
+
+// Reads the source code of the app: `main.js` on the RomFS, or else the
+// `.js` file with the matching name as the `.nro` file on the SD card.
+// `js_path` is set to the path that was read (or that failed to be read),
+// and `js_path_needs_free` is set when it needs to be freed.
+static char *read_user_code(int argc, char *argv[], char **js_path, bool *js_path_needs_free, size_t *size)
+{
+	char *user_code = (char *)read_file(*js_path, size);
+	if (user_code == NULL && errno == ENOENT && argc > 0)
+	{
+		// If no `main.js`, then try the `.js file with the
+		// matching name as the `.nro` file on the SD card
+		*js_path_needs_free = true;
+		*js_path = strdup(argv[0]);
+		size_t js_path_len = strlen(*js_path);
+		char *dot_nro = strstr(*js_path, ".nro");
+		if (dot_nro != NULL && (dot_nro - *js_path) == js_path_len - 4)
+		{
+			strcpy(dot_nro, ".js");
+		}
+
+		user_code = (char *)read_file(*js_path, size);
+	}
+	return user_code;
+}
+
+// Runs pending Promise jobs until there are none left, or until
+// `deadline` has passed, in which case the rest of the jobs are
+// run on the next iteration of the main loop
+void nx_process_pending_jobs(JSRuntime *rt, u64 deadline)
 {
 	JSContext *ctx;
 	int err;
@@ -455,7 +644,80 @@ void nx_process_pending_jobs(JSRuntime *rt)
 			}
 			break;
 		}
+		if (nx_timers_now() >= deadline)
+			break;
+	}
+}
+
+// Computes when draining async completions and Promise jobs should stop
+// for this iteration of the main loop: once the time budget has been used
+// up, or sooner when the next frame is due, so that the frame handler is
+// not delayed. Some minimum amount of draining is always allowed so that
+// the queues still make progress while frames are overrunning.
+static u64 nx_drain_deadline(nx_context_t *nx_ctx, u64 next_frame)
+{
+	if (nx_ctx->drain_budget == 0)
+		return UINT64_MAX;
+	u64 now = nx_timers_now();
+	u64 deadline = now + nx_ctx->drain_budget;
+	if (next_frame < deadline)
+		deadline = next_frame;
+	if (deadline < now + MIN_DRAIN_NS)
+		deadline = now + MIN_DRAIN_NS;
+	return deadline;
+}
+
+// Computes how long (in milliseconds) the main loop may block waiting for
+// file descriptor activity before there is other work to do: either the
+// next frame, the next timer, or pending Promise jobs / async completions
+// left over from the previous iteration. Thread pool
+// completions interrupt the wait through `nx_poll_wakeup()`.
+static int nx_poll_timeout(JSRuntime *rt, nx_context_t *nx_ctx, u64 next_frame)
+{
+	if (JS_IsJobPending(rt) || nx_ctx->ready_work)
+		return 0;
+
+	u64 now = nx_timers_now();
+	if (next_frame <= now)
+		return 0;
+
+	// Round down for the frame deadline so that the wait never
+	// causes the frame handler to miss the display's vsync
+	u64 timeout = (next_frame - now) / 1000000;
+
+	// Round up for timers, since they may not fire early
+	if (nx_ctx->timers_used > 0)
+	{
+		u64 deadline = nx_ctx->timers[0]->deadline;
+		if (deadline <= now)
+			return 0;
+		u64 timer_timeout = (deadline - now + 999999) / 1000000;
+		if (timer_timeout < timeout)
+			timeout = timer_timeout;
+	}
+
+	return timeout;
+}
+
+// Number of worker threads for the async thread pool. The
+// `NXJS_THREAD_POOL_SIZE` env var takes precedence, otherwise one
+// thread is created for each CPU core the application may run on.
+static int nx_thread_pool_size()
+{
+	const char *size_str = getenv("NXJS_THREAD_POOL_SIZE");
+	if (size_str)
+	{
+		int size = atoi(size_str);
+		if (size > 0 && size <= NX_THREAD_POOL_MAX_SIZE)
+			return size;
 	}
+
+	u64 core_mask = 0;
+	Result rc = svcGetInfo(&core_mask, InfoType_CoreMask, CUR_PROCESS_HANDLE, 0);
+	if (R_SUCCEEDED(rc) && core_mask)
+		return __builtin_popcountll(core_mask);
+
+	return NX_THREAD_POOL_DEFAULT_SIZE;
 }
 
 // Main program entrypoint
@@ -492,48 +754,43 @@ int main(int argc, char *argv[])
 	PadState pad;
 	padInitializeDefault(&pad);
 
+	// Monotonic time at which the frame handler should next be invoked
+	u64 next_frame = 0;
+
 	JSRuntime *rt = JS_NewRuntime();
 	JSContext *ctx = JS_NewContext(rt);
 
 	nx_context_t *nx_ctx = malloc(sizeof(nx_context_t));
 	memset(nx_ctx, 0, sizeof(nx_context_t));
 	nx_ctx->rendering_mode = NX_RENDERING_MODE_CONSOLE;
-	nx_ctx->thpool = thpool_init(4);
+	nx_ctx->thpool = nx_thread_pool_init(nx_thread_pool_size());
+	nx_ctx->frame_interval = FRAME_INTERVAL_NS;
+	nx_ctx->drain_budget = DRAIN_BUDGET_NS;
 	nx_ctx->frame_handler = JS_UNDEFINED;
+	nx_ctx->timer_handler = JS_UNDEFINED;
 	nx_ctx->exit_handler = JS_UNDEFINED;
 	nx_ctx->error_handler = JS_UNDEFINED;
 	nx_ctx->unhandled_rejection_handler = JS_UNDEFINED;
-	pthread_mutex_init(&(nx_ctx->async_done_mutex), NULL);
+	atomic_init(&nx_ctx->completed_work, NULL);
+	nx_poll_init(&nx_ctx->poll);
 	JS_SetContextOpaque(ctx, nx_ctx);
 	JS_SetHostPromiseRejectionTracker(rt, nx_promise_rejection_handler, ctx);
 
-	// First try the `main.js` file on the RomFS
+	// First try the precompiled `main.jsbc` bytecode file on the RomFS,
+	// and then the `main.js` source file
 	size_t user_code_size;
 	bool js_path_needs_free = false;
 	char *js_path = "romfs:/main.js";
-	char *user_code = (char *)read_file(js_path, &user_code_size);
-	if (user_code == NULL && errno == ENOENT && argc > 0)
+	char *user_code = NULL;
+	size_t user_bytecode_size;
+	uint8_t *user_bytecode = read_file("romfs:/main.jsbc", &user_bytecode_size);
+	if (user_bytecode == NULL)
 	{
-		// If no `main.js`, then try the `.js file with the
-		// matching name as the `.nro` file on the SD card
-		js_path_needs_free = true;
-		js_path = strdup(argv[0]);
-		size_t js_path_len = strlen(js_path);
-		char *dot_nro = strstr(js_path, ".nro");
-		if (dot_nro != NULL && (dot_nro - js_path) == js_path_len - 4)
-		{
-			strcpy(dot_nro, ".js");
-		}
-
-		user_code = (char *)read_file(js_path, &user_code_size);
+		user_code = read_user_code(argc, argv, &js_path, &js_path_needs_free, &user_code_size);
 	}
-	if (user_code == NULL)
+	if (user_code == NULL && user_bytecode == NULL)
 	{
 		printf("%s: %s\n", strerror(errno), js_path);
-		if (js_path_needs_free)
-		{
-			free(js_path);
-		}
 		nx_ctx->had_error = 1;
 		goto main_loop;
 	}
@@ -544,6 +801,7 @@ int main(int argc, char *argv[])
 	nx_init_account(ctx, nx_ctx->init_obj);
 	nx_init_album(ctx, nx_ctx->init_obj);
 	nx_init_applet(ctx, nx_ctx->init_obj);
+	nx_init_async(ctx, nx_ctx->init_obj);
 	nx_init_battery(ctx, nx_ctx->init_obj);
 	nx_init_canvas(ctx, nx_ctx->init_obj);
 	nx_init_crypto(ctx, nx_ctx->init_obj);
@@ -553,11 +811,17 @@ int main(int argc, char *argv[])
 	nx_init_font(ctx, nx_ctx->init_obj);
 	nx_init_fs(ctx, nx_ctx->init_obj);
 	nx_init_fsdev(ctx, nx_ctx->init_obj);
+	nx_init_frame_timing(ctx, nx_ctx->init_obj);
+	nx_init_glyph_atlas(ctx, nx_ctx->init_obj);
+	nx_init_glyph_cache(ctx, nx_ctx->init_obj);
 	nx_init_image(ctx, nx_ctx->init_obj);
+	nx_init_image_cache(ctx, nx_ctx->init_obj);
 	nx_init_irs(ctx, nx_ctx->init_obj);
 	nx_init_nifm(ctx, nx_ctx->init_obj);
 	nx_init_ns(ctx, nx_ctx->init_obj);
+	nx_init_path2d(ctx, nx_ctx->init_obj);
 	nx_init_tcp(ctx, nx_ctx->init_obj);
+	nx_init_timers(ctx, nx_ctx->init_obj);
 	nx_init_tls(ctx, nx_ctx->init_obj);
 	nx_init_url(ctx, nx_ctx->init_obj);
 	nx_init_swkbd(ctx, nx_ctx->init_obj);
@@ -583,6 +847,7 @@ int main(int argc, char *argv[])
 
 		// framebuffer renderer
 		JS_CFUNC_DEF("framebufferInit", 1, nx_framebuffer_init),
+		JS_CFUNC_DEF("framebufferSetOverlay", 3, nx_framebuffer_set_overlay),
 
 		// hid
 		JS_CFUNC_DEF("hidInitializeKeyboard", 0, js_hid_initialize_keyboard),
@@ -622,31 +887,89 @@ int main(int argc, char *argv[])
 
 	JS_SetPropertyStr(ctx, global_obj, "$", nx_ctx->init_obj);
 
+	// Prefer the precompiled runtime bytecode, if present. If the bytecode
+	// could not be loaded (i.e. it was compiled by a different version of
+	// QuickJS), then fall back to evaluating the runtime source code.
+	JSValue runtime_init_result = JS_UNINITIALIZED;
 	size_t runtime_buffer_size;
-	char *runtime_path = "romfs:/runtime.js";
-	char *runtime_buffer = (char *)read_file(runtime_path, &runtime_buffer_size);
-	if (runtime_buffer == NULL)
+	char *runtime_bytecode_path = "romfs:/runtime.jsbc";
+	uint8_t *runtime_bytecode = read_file(runtime_bytecode_path, &runtime_buffer_size);
+	if (runtime_bytecode != NULL)
 	{
-		printf("%s: %s\n", strerror(errno), runtime_path);
-		nx_ctx->had_error = 1;
-		goto main_loop;
+		runtime_init_result = nx_read_bytecode(ctx, runtime_bytecode, runtime_buffer_size);
+		free(runtime_bytecode);
+		if (JS_IsException(runtime_init_result))
+		{
+			JSValue exception = JS_GetException(ctx);
+			const char *str = JS_ToCString(ctx, exception);
+			fprintf(stderr, "Failed to load %s: %s\n", runtime_bytecode_path, str);
+			JS_FreeCString(ctx, str);
+			JS_FreeValue(ctx, exception);
+			runtime_init_result = JS_UNINITIALIZED;
+		}
+		else
+		{
+			runtime_init_result = JS_EvalFunction(ctx, runtime_init_result);
+		}
+	}
+
+	if (JS_IsUninitialized(runtime_init_result))
+	{
+		char *runtime_path = "romfs:/runtime.js";
+		char *runtime_buffer = (char *)read_file(runtime_path, &runtime_buffer_size);
+		if (runtime_buffer == NULL)
+		{
+			printf("%s: %s\n", strerror(errno), runtime_path);
+			nx_ctx->had_error = 1;
+			goto main_loop;
+		}
+		runtime_init_result = JS_Eval(ctx, runtime_buffer, runtime_buffer_size, runtime_path, JS_EVAL_TYPE_GLOBAL);
+		free(runtime_buffer);
 	}
 
-	JSValue runtime_init_result = JS_Eval(ctx, runtime_buffer, runtime_buffer_size, runtime_path, JS_EVAL_TYPE_GLOBAL);
 	if (JS_IsException(runtime_init_result))
 	{
 		print_js_error(ctx);
 		nx_ctx->had_error = 1;
 	}
 	JS_FreeValue(ctx, runtime_init_result);
-	free(runtime_buffer);
 	if (nx_ctx->had_error)
 	{
 		goto main_loop;
 	}
 
-	// Run the user code
-	JSValue user_code_result = JS_Eval(ctx, user_code, user_code_size, js_path, JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+	// Run the user code. As with the runtime, fall back to the source
+	// code when the precompiled bytecode could not be loaded.
+	JSValue user_code_result = JS_UNINITIALIZED;
+	if (user_bytecode)
+	{
+		user_code_result = nx_read_bytecode(ctx, user_bytecode, user_bytecode_size);
+		free(user_bytecode);
+		user_bytecode = NULL;
+		if (JS_IsException(user_code_result))
+		{
+			JSValue exception = JS_GetException(ctx);
+			const char *str = JS_ToCString(ctx, exception);
+			fprintf(stderr, "Failed to load %s: %s\n", "romfs:/main.jsbc", str);
+			JS_FreeCString(ctx, str);
+			JS_FreeValue(ctx, exception);
+			user_code_result = JS_UNINITIALIZED;
+
+			user_code = read_user_code(argc, argv, &js_path, &js_path_needs_free, &user_code_size);
+			if (user_code == NULL)
+			{
+				printf("%s: %s\n", strerror(errno), js_path);
+				nx_ctx->had_error = 1;
+				goto main_loop;
+			}
+		}
+	}
+	if (JS_IsUninitialized(user_code_result))
+	{
+		user_code_result = JS_Eval(ctx, user_code, user_code_size, js_path, JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+		free(user_code);
+		user_code = NULL;
+	}
 	if (JS_IsException(user_code_result))
 	{
 		nx_emit_error_event(ctx);
@@ -661,28 +984,54 @@ int main(int argc, char *argv[])
 		}
 	}
 	JS_FreeValue(ctx, user_code_result);
+
+main_loop:
+	// Not used anymore, or left over from an initialization error
+	free(user_bytecode);
 	free(user_code);
 	if (js_path_needs_free)
 	{
 		free(js_path);
 	}
 
-main_loop:
 	while (appletMainLoop())
 	{
+		nx_frame_timing_t *timing = &nx_ctx->frame_timing;
+
 		if (!nx_ctx->had_error)
 		{
-			// Check if any file descriptors have reported activity
-			nx_poll(&nx_ctx->poll);
+			// Check if any file descriptors have reported activity,
+			// blocking until the next deadline when there is no other work
+			nx_poll(&nx_ctx->poll, nx_poll_timeout(rt, nx_ctx, next_frame));
 		}
+		nx_frame_timing_mark(timing, NX_FRAME_PHASE_POLL);
+
+		// Invoke any timers that are due
+		if (!nx_ctx->had_error)
+			nx_process_timers(ctx, nx_ctx);
+		nx_frame_timing_mark(timing, NX_FRAME_PHASE_TIMERS);
 
 		// Check if any thread pool tasks have completed
 		if (!nx_ctx->had_error)
-			nx_process_async(ctx, nx_ctx);
+			nx_process_async(ctx, nx_ctx, nx_drain_deadline(nx_ctx, next_frame));
+		nx_frame_timing_mark(timing, NX_FRAME_PHASE_ASYNC);
 
 		// Process any Promises that need to be fulfilled
 		if (!nx_ctx->had_error)
-			nx_process_pending_jobs(rt);
+			nx_process_pending_jobs(rt, nx_drain_deadline(nx_ctx, next_frame));
+		nx_frame_timing_mark(timing, NX_FRAME_PHASE_JOBS);
+
+		// The loop may have been woken early by I/O or a timer,
+		// in which case the frame is not due yet
+		u64 now = nx_timers_now();
+		if (!nx_ctx->had_error && now < next_frame)
+			continue;
+
+		// Schedule the next frame relative to this one's deadline so that
+		// the frame rate is stable, unless the loop has fallen behind
+		next_frame += nx_ctx->frame_interval;
+		if (next_frame < now)
+			next_frame = now + nx_ctx->frame_interval;
 
 		padUpdate(&pad);
 		u64 kDown = padGetButtons(&pad);
@@ -715,6 +1064,7 @@ main_loop:
 				break;
 			}
 		}
+		nx_frame_timing_mark(timing, NX_FRAME_PHASE_HANDLER);
 
 		if (nx_ctx->rendering_mode == NX_RENDERING_MODE_CONSOLE)
 		{
@@ -723,18 +1073,21 @@ main_loop:
 		}
 		else if (nx_ctx->rendering_mode == NX_RENDERING_MODE_CANVAS)
 		{
-			// Copy the JS framebuffer to the current Switch buffer
-			u32 stride;
-			u8 *framebuf = (u8 *)framebufferBegin(framebuffer, &stride);
-			memcpy(framebuf, js_framebuffer, 1280 * 720 * 4);
-			framebufferEnd(framebuffer);
+			// Copy what was drawn to the JS framebuffer to the Switch framebuffer.
+			// Without a frame rate cap, the loop is paced by waiting for a free
+			// display buffer, which only happens when a frame is presented, so
+			// idle frames wait for the next display refresh instead
+			if (!nx_framebuffer_present() && !nx_ctx->frame_interval)
+				next_frame = nx_timers_now() + FRAME_INTERVAL_NS;
 		}
+		nx_frame_timing_mark(timing, NX_FRAME_PHASE_PRESENT);
+		nx_frame_timing_commit(timing);
 	}
 
-	// XXX: Ideally we wouldn't `thpool_wait()` here,
+	// XXX: Ideally we wouldn't `nx_thread_pool_wait()` here,
 	// but the app seems to crash without it
-	thpool_wait(nx_ctx->thpool);
-	thpool_destroy(nx_ctx->thpool);
+	nx_thread_pool_wait(nx_ctx->thpool);
+	nx_thread_pool_destroy(nx_ctx->thpool);
 
 	// Call exit handler
 	JSValue ret_val = JS_Call(ctx, nx_ctx->exit_handler, JS_NULL, 0, NULL);
@@ -754,12 +1107,14 @@ main_loop:
 
 	JS_FreeValue(ctx, global_obj);
 	JS_FreeValue(ctx, nx_ctx->frame_handler);
+	JS_FreeValue(ctx, nx_ctx->timer_handler);
 	JS_FreeValue(ctx, nx_ctx->exit_handler);
 	JS_FreeValue(ctx, nx_ctx->error_handler);
 	JS_FreeValue(ctx, nx_ctx->unhandled_rejection_handler);
 
 	JS_FreeContext(ctx);
 	JS_FreeRuntime(rt);
+	nx_image_cache_destroy();
 
 	if (nx_ctx->wasm_env)
 	{
@@ -769,6 +1124,8 @@ main_loop:
 	{
 		FT_Done_FreeType(nx_ctx->ft_library);
 	}
+	free(nx_ctx->timers);
+	nx_work_pool_destroy(nx_ctx);
 
 	free(nx_ctx);
 
@@ -0,0 +1,599 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "canvas.h"
+#include "dommatrix.h"
+#include "path2d.h"
+
+static JSClassID nx_path2d_class_id;
+
+// Scratch context which holds the segments of the path being built
+static cairo_surface_t *builder_surface;
+static cairo_t *builder;
+static nx_path2d_t *builder_owner;
+
+nx_path2d_t *nx_get_path2d(JSContext *ctx, JSValueConst obj)
+{
+	return JS_GetOpaque2(ctx, obj, nx_path2d_class_id);
+}
+
+// Copies the segments in the scratch context out into the path they belong to
+static void flush_builder(void)
+{
+	if (builder_owner && !builder_owner->path)
+		builder_owner->path = cairo_copy_path(builder);
+}
+
+cairo_t *nx_path2d_begin_edit(nx_path2d_t *path)
+{
+	if (builder && cairo_status(builder) != CAIRO_STATUS_SUCCESS)
+	{
+		// An invalid operation (i.e. a non-invertible transform) leaves cairo
+		// contexts in an error state forever, so start over with a fresh one
+		flush_builder();
+		cairo_destroy(builder);
+		builder = NULL;
+	}
+	if (!builder)
+	{
+		if (!builder_surface)
+			builder_surface = cairo_image_surface_create(CAIRO_FORMAT_A8, 1, 1);
+		builder = cairo_create(builder_surface);
+
+		// Arcs are converted to Bézier curves in the path's own coordinate
+		// space rather than in device space, so use a lower tolerance than the
+		// default to keep them accurate when the path is drawn scaled up
+		cairo_set_tolerance(builder, 0.01);
+		builder_owner = NULL;
+	}
+	if (builder_owner != path)
+	{
+		flush_builder();
+		cairo_new_path(builder);
+		if (path->path && path->path->status == CAIRO_STATUS_SUCCESS)
+			cairo_append_path(builder, path->path);
+		builder_owner = path;
+	}
+	if (path->path)
+	{
+		cairo_path_destroy(path->path);
+		path->path = NULL;
+	}
+	return builder;
+}
+
+cairo_path_t *nx_path2d_get_path(nx_path2d_t *path)
+{
+	if (!path->path)
+		path->path = cairo_copy_path(builder);
+	return path->path;
+}
+
+/**
+ * SVG path data parsing.
+ *
+ * Modified from: https://github.com/nilzona/path2d-polyfill
+ * MIT License
+ *
+ * https://www.w3.org/TR/SVG/paths.html#PathDataGeneralInformation
+ */
+
+typedef struct
+{
+	// Current point
+	double x;
+	double y;
+	// Last control point of the previous cubic Bézier command
+	double cpx;
+	double cpy;
+	bool has_cp;
+	// Last control point of the previous quadratic Bézier command
+	double qcpx;
+	double qcpy;
+	bool has_qcp;
+	// Start of the current subpath
+	double start_x;
+	double start_y;
+	bool has_start;
+} svg_state_t;
+
+static inline bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static bool is_svg_command(char c)
+{
+	return c && strchr("AaCcHhLlMmQqSsTtVvZz", c);
+}
+
+// Number of arguments of an SVG path command
+static int svg_arg_count(char command)
+{
+	switch (command | 0x20)
+	{
+	case 'a':
+		return 7;
+	case 'c':
+		return 6;
+	case 'q':
+	case 's':
+		return 4;
+	case 'l':
+	case 'm':
+	case 't':
+		return 2;
+	case 'h':
+	case 'v':
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Finds the next number in `*p` to `end`, skipping anything which is not a
+ * number. Numbers match `-?[0-9]*\.?[0-9]+(e[-+]?[0-9]+)?` (case-insensitive).
+ */
+static bool svg_next_number(const char **p, const char *end, double *value)
+{
+	for (const char *s = *p; s < end; s++)
+	{
+		const char *i = s;
+		if (*i == '-')
+			i++;
+		const char *digits = i;
+		while (i < end && is_digit(*i))
+			i++;
+		if (i + 1 < end && *i == '.' && is_digit(i[1]))
+		{
+			i++;
+			while (i < end && is_digit(*i))
+				i++;
+		}
+		else if (i == digits)
+		{
+			continue;
+		}
+		if (i < end && (*i == 'e' || *i == 'E'))
+		{
+			const char *e = i + 1;
+			if (e < end && (*e == '-' || *e == '+'))
+				e++;
+			if (e < end && is_digit(*e))
+			{
+				while (e < end && is_digit(*e))
+					e++;
+				i = e;
+			}
+		}
+
+		// Copy, since `strtod()` also accepts forms (i.e. hex) that are not matched here
+		char buf[64];
+		size_t length = i - s;
+		if (length < sizeof(buf))
+		{
+			memcpy(buf, s, length);
+			buf[length] = '\0';
+			*value = strtod(buf, NULL);
+		}
+		else
+		{
+			*value = strtod(s, NULL);
+		}
+		*p = i;
+		return true;
+	}
+	*p = end;
+	return false;
+}
+
+static void rotate_point(double *x, double *y, double angle)
+{
+	double nx = *x * cos(angle) - *y * sin(angle);
+	double ny = *y * cos(angle) + *x * sin(angle);
+	*x = nx;
+	*y = ny;
+}
+
+// Endpoint to center parameterization of an elliptical arc
+// https://www.w3.org/TR/SVG/implnote.html#ArcImplementationNotes
+static void svg_arc(cairo_t *cr, double x1, double y1, double x2, double y2,
+					double rx, double ry, double angle, bool large_arc, bool sweep)
+{
+	rx = fabs(rx);
+	ry = fabs(ry);
+	if (x1 == x2 && y1 == y2)
+		return;
+	if (rx == 0 || ry == 0)
+	{
+		cairo_line_to(cr, x2, y2);
+		return;
+	}
+
+	double mx = (x1 - x2) / 2;
+	double my = (y1 - y2) / 2;
+	rotate_point(&mx, &my, -angle);
+
+	// Radius correction
+	double lambda = (mx * mx) / (rx * rx) + (my * my) / (ry * ry);
+	if (lambda > 1)
+	{
+		lambda = sqrt(lambda);
+		rx *= lambda;
+		ry *= lambda;
+	}
+
+	double cx = (rx * my) / ry;
+	double cy = -(ry * mx) / rx;
+	double t1 = rx * rx * ry * ry;
+	double t2 = rx * rx * my * my + ry * ry * mx * mx;
+	double f = sqrt((t1 - t2) / t2);
+	if (isnan(f))
+		f = 0;
+	if (sweep == large_arc)
+		f = -f;
+	cx *= f;
+	cy *= f;
+
+	double start_angle = atan2((my - cy) / ry, (mx - cx) / rx);
+	double end_angle = atan2(-(my + cy) / ry, -(mx + cx) / rx);
+
+	rotate_point(&cx, &cy, angle);
+	cx += (x2 + x1) / 2;
+	cy += (y2 + y1) / 2;
+
+	cairo_save(cr);
+	cairo_translate(cr, cx, cy);
+	cairo_rotate(cr, angle);
+	cairo_scale(cr, rx, ry);
+	if (sweep)
+		cairo_arc(cr, 0, 0, 1, start_angle, end_angle);
+	else
+		cairo_arc_negative(cr, 0, 0, 1, start_angle, end_angle);
+	cairo_restore(cr);
+}
+
+static void svg_quadratic_to(cairo_t *cr, double x0, double y0, double x1, double y1, double x2, double y2)
+{
+	cairo_curve_to(cr,
+				   x0 + 2.0 / 3.0 * (x1 - x0), y0 + 2.0 / 3.0 * (y1 - y0),
+				   x2 + 2.0 / 3.0 * (x1 - x2), y2 + 2.0 / 3.0 * (y1 - y2),
+				   x2, y2);
+}
+
+static void svg_command(cairo_t *cr, svg_state_t *s, char command, const double *a)
+{
+	// Reset control points if the command is not the same kind of curve
+	if ((command | 0x20) != 'c' && (command | 0x20) != 's')
+		s->has_cp = false;
+	if ((command | 0x20) != 'q' && (command | 0x20) != 't')
+		s->has_qcp = false;
+
+	double x0 = s->x;
+	double y0 = s->y;
+	switch (command)
+	{
+	case 'm':
+	case 'M':
+		if (command == 'm')
+		{
+			s->x += a[0];
+			s->y += a[1];
+		}
+		else
+		{
+			s->x = a[0];
+			s->y = a[1];
+		}
+		if (command == 'M' || !s->has_start)
+		{
+			s->start_x = s->x;
+			s->start_y = s->y;
+			s->has_start = true;
+		}
+		cairo_move_to(cr, s->x, s->y);
+		break;
+	case 'l':
+		s->x += a[0];
+		s->y += a[1];
+		cairo_line_to(cr, s->x, s->y);
+		break;
+	case 'L':
+		s->x = a[0];
+		s->y = a[1];
+		cairo_line_to(cr, s->x, s->y);
+		break;
+	case 'H':
+		s->x = a[0];
+		cairo_line_to(cr, s->x, s->y);
+		break;
+	case 'h':
+		s->x += a[0];
+		cairo_line_to(cr, s->x, s->y);
+		break;
+	case 'V':
+		s->y = a[0];
+		cairo_line_to(cr, s->x, s->y);
+		break;
+	case 'v':
+		s->y += a[0];
+		cairo_line_to(cr, s->x, s->y);
+		break;
+	case 'a':
+	case 'A':
+		if (command == 'a')
+		{
+			s->x += a[5];
+			s->y += a[6];
+		}
+		else
+		{
+			s->x = a[5];
+			s->y = a[6];
+		}
+		svg_arc(cr, x0, y0, s->x, s->y, a[0], a[1], a[2] * M_PI / 180, a[3] != 0, a[4] != 0);
+		break;
+	case 'C':
+		s->cpx = a[2];
+		s->cpy = a[3];
+		s->x = a[4];
+		s->y = a[5];
+		s->has_cp = true;
+		cairo_curve_to(cr, a[0], a[1], s->cpx, s->cpy, s->x, s->y);
+		break;
+	case 'c':
+		cairo_curve_to(cr, a[0] + x0, a[1] + y0, a[2] + x0, a[3] + y0, a[4] + x0, a[5] + y0);
+		s->cpx = a[2] + x0;
+		s->cpy = a[3] + y0;
+		s->x += a[4];
+		s->y += a[5];
+		s->has_cp = true;
+		break;
+	case 'S':
+	case 's':
+	{
+		if (!s->has_cp)
+		{
+			s->cpx = x0;
+			s->cpy = y0;
+		}
+		double ox = command == 's' ? x0 : 0;
+		double oy = command == 's' ? y0 : 0;
+		cairo_curve_to(cr, 2 * x0 - s->cpx, 2 * y0 - s->cpy, a[0] + ox, a[1] + oy, a[2] + ox, a[3] + oy);
+		s->cpx = a[0] + ox;
+		s->cpy = a[1] + oy;
+		s->x = a[2] + ox;
+		s->y = a[3] + oy;
+		s->has_cp = true;
+		break;
+	}
+	case 'Q':
+	case 'q':
+	{
+		double ox = command == 'q' ? x0 : 0;
+		double oy = command == 'q' ? y0 : 0;
+		s->qcpx = a[0] + ox;
+		s->qcpy = a[1] + oy;
+		s->x = a[2] + ox;
+		s->y = a[3] + oy;
+		s->has_qcp = true;
+		svg_quadratic_to(cr, x0, y0, s->qcpx, s->qcpy, s->x, s->y);
+		break;
+	}
+	case 'T':
+	case 't':
+		if (!s->has_qcp)
+		{
+			s->qcpx = x0;
+			s->qcpy = y0;
+		}
+		s->qcpx = 2 * x0 - s->qcpx;
+		s->qcpy = 2 * y0 - s->qcpy;
+		if (command == 't')
+		{
+			s->x += a[0];
+			s->y += a[1];
+		}
+		else
+		{
+			s->x = a[0];
+			s->y = a[1];
+		}
+		s->has_qcp = true;
+		svg_quadratic_to(cr, x0, y0, s->qcpx, s->qcpy, s->x, s->y);
+		break;
+	case 'z':
+	case 'Z':
+		if (s->has_start)
+		{
+			s->x = s->start_x;
+			s->y = s->start_y;
+		}
+		s->has_start = false;
+		cairo_close_path(cr);
+		break;
+	}
+}
+
+// Adds the segments of the SVG path data `d` to `cr`
+static void svg_path(cairo_t *cr, const char *d, size_t length)
+{
+	const char *p = d;
+	const char *end = d + length;
+	while (p < end && (*p == ' ' || (*p >= '\t' && *p <= '\r')))
+		p++;
+
+	// A path data segment (if there is one) must begin with a "moveto" command
+	if (p == end || (*p != 'M' && *p != 'm'))
+		return;
+
+	svg_state_t state = {0};
+	while (p < end)
+	{
+		char command = *p++;
+		const char *args_end = p;
+		while (args_end < end && !is_svg_command(*args_end))
+			args_end++;
+
+		// The command letter can be eliminated on subsequent commands if the
+		// same command is used multiple times in a row (e.g., you can drop the
+		// second "L" in "M 100 200 L 200 100 L -100 -200" and use
+		// "M 100 200 L 200 100 -100 -200" instead). Commands with too few
+		// arguments are ignored.
+		int n = svg_arg_count(command);
+		for (;;)
+		{
+			double args[7];
+			int i = 0;
+			while (i < n && svg_next_number(&p, args_end, &args[i]))
+				i++;
+			if (i < n)
+				break;
+			svg_command(cr, &state, command, args);
+			if (n == 0)
+				break;
+
+			// Overloaded moveTo
+			if (command == 'm')
+				command = 'l';
+			else if (command == 'M')
+				command = 'L';
+		}
+		p = args_end;
+	}
+}
+
+static JSValue nx_path2d_new(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_path2d_t *path = js_mallocz(ctx, sizeof(nx_path2d_t));
+	if (!path)
+		return JS_EXCEPTION;
+
+	JSValue obj = JS_NewObjectClass(ctx, nx_path2d_class_id);
+	if (JS_IsException(obj))
+	{
+		js_free(ctx, path);
+		return obj;
+	}
+	JS_SetOpaque(obj, path);
+
+	if (argc > 0 && JS_ToBool(ctx, argv[0]))
+	{
+		nx_path2d_t *other = JS_GetOpaque(argv[0], nx_path2d_class_id);
+		if (other)
+		{
+			cairo_path_t *segments = nx_path2d_get_path(other);
+			cairo_t *cr = nx_path2d_begin_edit(path);
+			if (segments->status == CAIRO_STATUS_SUCCESS)
+				cairo_append_path(cr, segments);
+		}
+		else
+		{
+			size_t length;
+			const char *d = JS_ToCStringLen(ctx, &length, argv[0]);
+			if (!d)
+			{
+				JS_FreeValue(ctx, obj);
+				return JS_EXCEPTION;
+			}
+			svg_path(nx_path2d_begin_edit(path), d, length);
+			JS_FreeCString(ctx, d);
+		}
+	}
+	else
+	{
+		nx_path2d_begin_edit(path);
+	}
+
+	return obj;
+}
+
+static JSValue nx_path2d_add_path(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_path2d_t *path = nx_get_path2d(ctx, this_val);
+	if (!path)
+		return JS_EXCEPTION;
+	nx_path2d_t *other = nx_get_path2d(ctx, argv[0]);
+	if (!other)
+		return JS_EXCEPTION;
+
+	nx_dommatrix_t transform = {0};
+	transform.is_2d = true;
+	transform.values.m11 = transform.values.m22 = transform.values.m33 = transform.values.m44 = 1.;
+	if (argc > 1 && nx_dommatrix_init(ctx, argv[1], &transform))
+		return JS_EXCEPTION;
+
+	// A non-invertible transform collapses the path, so there is nothing to add
+	cairo_matrix_t inverse = transform.cr_matrix;
+	if (cairo_matrix_invert(&inverse) != CAIRO_STATUS_SUCCESS)
+		return JS_UNDEFINED;
+
+	// When adding a path to itself, copy the segments since
+	// editing the path invalidates its `cairo_path_t`
+	cairo_t *cr;
+	cairo_path_t *segments;
+	if (other == path)
+	{
+		cr = nx_path2d_begin_edit(path);
+		segments = cairo_copy_path(cr);
+	}
+	else
+	{
+		segments = nx_path2d_get_path(other);
+		cr = nx_path2d_begin_edit(path);
+	}
+	if (segments->status == CAIRO_STATUS_SUCCESS)
+	{
+		cairo_save(cr);
+		cairo_transform(cr, &transform.cr_matrix);
+		cairo_append_path(cr, segments);
+		cairo_restore(cr);
+	}
+	if (other == path)
+		cairo_path_destroy(segments);
+	return JS_UNDEFINED;
+}
+
+static JSValue nx_path2d_init_class(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	JSAtom atom;
+	JSValue proto = JS_GetPropertyStr(ctx, argv[0], "prototype");
+	NX_DEF_FUNC(proto, "addPath", nx_path2d_add_path, 1);
+	nx_canvas_path_init_proto(ctx, proto);
+	JS_FreeValue(ctx, proto);
+	return JS_UNDEFINED;
+}
+
+static void finalizer_path2d(JSRuntime *rt, JSValue val)
+{
+	nx_path2d_t *path = JS_GetOpaque(val, nx_path2d_class_id);
+	if (path)
+	{
+		if (builder_owner == path)
+			builder_owner = NULL;
+		if (path->path)
+			cairo_path_destroy(path->path);
+		js_free_rt(rt, path);
+	}
+}
+
+static const JSCFunctionListEntry function_list[] = {
+	JS_CFUNC_DEF("path2dNew", 0, nx_path2d_new),
+	JS_CFUNC_DEF("path2dInitClass", 0, nx_path2d_init_class),
+};
+
+void nx_init_path2d(JSContext *ctx, JSValueConst init_obj)
+{
+	JSRuntime *rt = JS_GetRuntime(ctx);
+
+	JS_NewClassID(rt, &nx_path2d_class_id);
+	JSClassDef path2d_class = {
+		"Path2D",
+		.finalizer = finalizer_path2d,
+	};
+	JS_NewClass(rt, nx_path2d_class_id, &path2d_class);
+
+	JS_SetPropertyFunctionList(ctx, init_obj, function_list, countof(function_list));
+}
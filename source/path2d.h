@@ -0,0 +1,29 @@
+#pragma once
+#include <cairo.h>
+#include "types.h"
+
+/**
+ * `Path2D`
+ *
+ * Path segments are built in a scratch cairo context which is shared by
+ * every `Path2D` instance. Once a path is used (or another path is being
+ * built), its segments are copied out of the scratch context into a
+ * `cairo_path_t`, which is kept until the path is modified again. Using a
+ * path on a canvas context is then a single `cairo_append_path()`.
+ */
+typedef struct
+{
+	// Segments of the path, or `NULL` while they are only in the scratch context
+	cairo_path_t *path;
+} nx_path2d_t;
+
+nx_path2d_t *nx_get_path2d(JSContext *ctx, JSValueConst obj);
+
+// Returns the context to add segments of `path` to. The
+// returned context is only valid until another path is used.
+cairo_t *nx_path2d_begin_edit(nx_path2d_t *path);
+
+// Returns the segments of `path`, in the path's coordinate space
+cairo_path_t *nx_path2d_get_path(nx_path2d_t *path);
+
+void nx_init_path2d(JSContext *ctx, JSValueConst init_obj);
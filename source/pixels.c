@@ -0,0 +1,624 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pixels.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NX_PIXELS_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define NX_PIXELS_SSE2
+#endif
+
+/**
+ * Premultiplying uses the exact rounded division by 255 (the same method
+ * that pixman uses), which only needs 16-bit lanes:
+ *
+ *    t = c * a + 128
+ *    c' = (t + (t >> 8)) >> 8
+ *
+ * which is equal to `(c * a + 127) / 255` for every color and alpha.
+ *
+ * Un-premultiplying avoids a division per channel by multiplying by a
+ * 16-bit fixed point reciprocal from a lookup table:
+ *
+ *    c' = min(255, ((c << 8) * unpremultiply_table[a]) >> 16)
+ *
+ * where `unpremultiply_table[a] = ceil(255 * 256 / a)`. For valid
+ * premultiplied input (c <= a) the result is always less than 1 away
+ * from `c * 255 / a`, and exact for opaque pixels.
+ */
+
+static const uint16_t unpremultiply_table[256] = {
+	0, 65280, 32640, 21760, 16320, 13056, 10880, 9326, 8160, 7254, 6528, 5935, 5440, 5022, 4663, 4352,
+	4080, 3840, 3627, 3436, 3264, 3109, 2968, 2839, 2720, 2612, 2511, 2418, 2332, 2252, 2176, 2106,
+	2040, 1979, 1920, 1866, 1814, 1765, 1718, 1674, 1632, 1593, 1555, 1519, 1484, 1451, 1420, 1389,
+	1360, 1333, 1306, 1280, 1256, 1232, 1209, 1187, 1166, 1146, 1126, 1107, 1088, 1071, 1053, 1037,
+	1020, 1005, 990, 975, 960, 947, 933, 920, 907, 895, 883, 871, 859, 848, 837, 827,
+	816, 806, 797, 787, 778, 768, 760, 751, 742, 734, 726, 718, 710, 702, 695, 688,
+	680, 673, 667, 660, 653, 647, 640, 634, 628, 622, 616, 611, 605, 599, 594, 589,
+	583, 578, 573, 568, 563, 558, 554, 549, 544, 540, 536, 531, 527, 523, 519, 515,
+	510, 507, 503, 499, 495, 491, 488, 484, 480, 477, 474, 470, 467, 463, 460, 457,
+	454, 451, 448, 445, 442, 439, 436, 433, 430, 427, 424, 422, 419, 416, 414, 411,
+	408, 406, 403, 401, 399, 396, 394, 391, 389, 387, 384, 382, 380, 378, 376, 374,
+	371, 369, 367, 365, 363, 361, 359, 357, 355, 353, 351, 350, 348, 346, 344, 342,
+	340, 339, 337, 335, 334, 332, 330, 329, 327, 325, 324, 322, 320, 319, 317, 316,
+	314, 313, 311, 310, 308, 307, 306, 304, 303, 301, 300, 299, 297, 296, 295, 293,
+	292, 291, 289, 288, 287, 286, 284, 283, 282, 281, 279, 278, 277, 276, 275, 274,
+	272, 271, 270, 269, 268, 267, 266, 265, 264, 263, 262, 261, 260, 259, 258, 256,
+};
+
+static inline uint8_t premultiply(uint8_t c, uint8_t a)
+{
+	uint32_t t = c * a + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+static inline uint8_t unpremultiply(uint8_t c, uint16_t k)
+{
+	uint32_t v = ((uint32_t)c << 8) * k >> 16;
+	return v > 255 ? 255 : v;
+}
+
+void nx_rgba_to_bgra_premultiplied_scalar(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint8_t r = src[0];
+		uint8_t g = src[1];
+		uint8_t b = src[2];
+		uint8_t a = src[3];
+		dst[0] = premultiply(b, a);
+		dst[1] = premultiply(g, a);
+		dst[2] = premultiply(r, a);
+		dst[3] = a;
+		src += 4;
+		dst += 4;
+	}
+}
+
+void nx_premultiply_scalar(uint8_t *pixels, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint8_t a = pixels[3];
+		if (a != 255)
+		{
+			pixels[0] = premultiply(pixels[0], a);
+			pixels[1] = premultiply(pixels[1], a);
+			pixels[2] = premultiply(pixels[2], a);
+		}
+		pixels += 4;
+	}
+}
+
+void nx_bgra_premultiplied_to_rgba_scalar(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint8_t b = src[0];
+		uint8_t g = src[1];
+		uint8_t r = src[2];
+		uint8_t a = src[3];
+		uint16_t k = unpremultiply_table[a];
+		dst[0] = unpremultiply(r, k);
+		dst[1] = unpremultiply(g, k);
+		dst[2] = unpremultiply(b, k);
+		dst[3] = a;
+		src += 4;
+		dst += 4;
+	}
+}
+
+#if defined(NX_PIXELS_NEON)
+
+static inline uint8x8_t premultiply_neon(uint8x8_t c, uint8x8_t a)
+{
+	// (t + ((t + 128) >> 8) + 128) >> 8, which is the same as `premultiply()`
+	uint16x8_t t = vmull_u8(c, a);
+	return vraddhn_u16(t, vrshrq_n_u16(t, 8));
+}
+
+static inline uint8x8_t unpremultiply_neon(uint8x8_t c, uint16x8_t k)
+{
+	uint16x8_t c8 = vshll_n_u8(c, 8);
+	uint32x4_t lo = vmull_u16(vget_low_u16(c8), vget_low_u16(k));
+	uint32x4_t hi = vmull_u16(vget_high_u16(c8), vget_high_u16(k));
+	return vqmovn_u16(vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16)));
+}
+
+void nx_rgba_to_bgra_premultiplied(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		uint8x8x4_t px = vld4_u8(src);
+		uint8x8_t a = px.val[3];
+		uint8x8x4_t out;
+		if (vminv_u8(a) == 255)
+		{
+			// Fully opaque, so only the channels need to be swapped
+			out.val[0] = px.val[2];
+			out.val[1] = px.val[1];
+			out.val[2] = px.val[0];
+		}
+		else
+		{
+			out.val[0] = premultiply_neon(px.val[2], a);
+			out.val[1] = premultiply_neon(px.val[1], a);
+			out.val[2] = premultiply_neon(px.val[0], a);
+		}
+		out.val[3] = a;
+		vst4_u8(dst, out);
+		src += 32;
+		dst += 32;
+	}
+	nx_rgba_to_bgra_premultiplied_scalar(dst, src, count - i);
+}
+
+void nx_premultiply(uint8_t *pixels, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		uint8x8x4_t px = vld4_u8(pixels);
+		uint8x8_t a = px.val[3];
+		// Opaque pixels are unchanged
+		if (vminv_u8(a) != 255)
+		{
+			px.val[0] = premultiply_neon(px.val[0], a);
+			px.val[1] = premultiply_neon(px.val[1], a);
+			px.val[2] = premultiply_neon(px.val[2], a);
+			vst4_u8(pixels, px);
+		}
+		pixels += 32;
+	}
+	nx_premultiply_scalar(pixels, count - i);
+}
+
+void nx_bgra_premultiplied_to_rgba(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		uint8x8x4_t px = vld4_u8(src);
+		uint8x8_t a = px.val[3];
+		uint8x8x4_t out;
+		if (vminv_u8(a) == 255)
+		{
+			out.val[0] = px.val[2];
+			out.val[1] = px.val[1];
+			out.val[2] = px.val[0];
+		}
+		else
+		{
+			uint16_t k[8];
+			for (int j = 0; j < 8; j++)
+				k[j] = unpremultiply_table[src[j * 4 + 3]];
+			uint16x8_t kv = vld1q_u16(k);
+			out.val[0] = unpremultiply_neon(px.val[2], kv);
+			out.val[1] = unpremultiply_neon(px.val[1], kv);
+			out.val[2] = unpremultiply_neon(px.val[0], kv);
+		}
+		out.val[3] = a;
+		vst4_u8(dst, out);
+		src += 32;
+		dst += 32;
+	}
+	nx_bgra_premultiplied_to_rgba_scalar(dst, src, count - i);
+}
+
+// Source-over of 8 pixels of each channel, with `ia` being 255 - source alpha
+static inline uint8x8_t blend_over_neon(uint8x8_t s, uint8x8_t d, uint8x8_t ia)
+{
+	return vadd_u8(s, premultiply_neon(d, ia));
+}
+
+void nx_blend_over(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		uint8x8x4_t s = vld4_u8(src);
+		uint8x8_t a = s.val[3];
+		if (vminv_u8(a) == 255)
+		{
+			// Fully opaque, so the source pixels replace the destination
+			vst4_u8(dst, s);
+		}
+		else if (vmaxv_u8(a) != 0)
+		{
+			uint8x8x4_t d = vld4_u8(dst);
+			uint8x8_t ia = vmvn_u8(a);
+			// Destination pixels under fully transparent source pixels are left as-is
+			uint8x8_t keep = vceq_u8(a, vdup_n_u8(0));
+			uint8x8x4_t out;
+			for (int c = 0; c < 4; c++)
+				out.val[c] = vbsl_u8(keep, d.val[c], blend_over_neon(s.val[c], d.val[c], ia));
+			vst4_u8(dst, out);
+		}
+		src += 32;
+		dst += 32;
+	}
+	nx_blend_over_scalar(dst, src, count - i);
+}
+
+#elif defined(NX_PIXELS_SSE2)
+
+// Swaps the first and third bytes of each 32-bit pixel
+static inline __m128i swap_red_blue_sse2(__m128i px)
+{
+	__m128i ag = _mm_and_si128(px, _mm_set1_epi32(0xFF00FF00));
+	__m128i rb = _mm_and_si128(px, _mm_set1_epi32(0x00FF00FF));
+	rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+	return _mm_or_si128(ag, rb);
+}
+
+// `px` contains two pixels as 16-bit lanes, with alpha last
+static inline __m128i premultiply_in_place_sse2(__m128i px)
+{
+	// Broadcast alpha to every channel, except that the alpha
+	// channel itself is multiplied by 255 so that it is unchanged
+	__m128i a = _mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3));
+	a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+	a = _mm_or_si128(a, _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0));
+
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(px, a), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// `px` contains two RGBA pixels as 16-bit lanes
+static inline __m128i premultiply_sse2(__m128i px)
+{
+	px = _mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 0, 1, 2));
+	px = _mm_shufflehi_epi16(px, _MM_SHUFFLE(3, 0, 1, 2));
+	return premultiply_in_place_sse2(px);
+}
+
+// `px` contains two BGRA pixels as 16-bit lanes
+static inline __m128i unpremultiply_sse2(__m128i px, const uint8_t *src)
+{
+	px = _mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 0, 1, 2));
+	px = _mm_shufflehi_epi16(px, _MM_SHUFFLE(3, 0, 1, 2));
+
+	// The alpha channel is multiplied by 256, so that it is unchanged
+	uint16_t k0 = unpremultiply_table[src[3]];
+	uint16_t k1 = unpremultiply_table[src[7]];
+	__m128i k = _mm_set_epi16(256, k1, k1, k1, 256, k0, k0, k0);
+
+	__m128i v = _mm_mulhi_epu16(_mm_slli_epi16(px, 8), k);
+
+	// min(v, 255)
+	return _mm_sub_epi16(v, _mm_subs_epu16(v, _mm_set1_epi16(255)));
+}
+
+void nx_rgba_to_bgra_premultiplied(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i opaque = _mm_set1_epi32(0xFF000000);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i px = _mm_loadu_si128((const __m128i *)src);
+		__m128i out;
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(px, opaque), opaque)) == 0xFFFF)
+		{
+			// Fully opaque, so only the channels need to be swapped
+			out = swap_red_blue_sse2(px);
+		}
+		else
+		{
+			__m128i lo = premultiply_sse2(_mm_unpacklo_epi8(px, zero));
+			__m128i hi = premultiply_sse2(_mm_unpackhi_epi8(px, zero));
+			out = _mm_packus_epi16(lo, hi);
+		}
+		_mm_storeu_si128((__m128i *)dst, out);
+		src += 16;
+		dst += 16;
+	}
+	nx_rgba_to_bgra_premultiplied_scalar(dst, src, count - i);
+}
+
+void nx_premultiply(uint8_t *pixels, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i opaque = _mm_set1_epi32(0xFF000000);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i px = _mm_loadu_si128((const __m128i *)pixels);
+		// Opaque pixels are unchanged
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(px, opaque), opaque)) != 0xFFFF)
+		{
+			__m128i lo = premultiply_in_place_sse2(_mm_unpacklo_epi8(px, zero));
+			__m128i hi = premultiply_in_place_sse2(_mm_unpackhi_epi8(px, zero));
+			_mm_storeu_si128((__m128i *)pixels, _mm_packus_epi16(lo, hi));
+		}
+		pixels += 16;
+	}
+	nx_premultiply_scalar(pixels, count - i);
+}
+
+void nx_bgra_premultiplied_to_rgba(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i opaque = _mm_set1_epi32(0xFF000000);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i px = _mm_loadu_si128((const __m128i *)src);
+		__m128i out;
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(px, opaque), opaque)) == 0xFFFF)
+		{
+			out = swap_red_blue_sse2(px);
+		}
+		else
+		{
+			__m128i lo = unpremultiply_sse2(_mm_unpacklo_epi8(px, zero), src);
+			__m128i hi = unpremultiply_sse2(_mm_unpackhi_epi8(px, zero), src + 8);
+			out = _mm_packus_epi16(lo, hi);
+		}
+		_mm_storeu_si128((__m128i *)dst, out);
+		src += 16;
+		dst += 16;
+	}
+	nx_bgra_premultiplied_to_rgba_scalar(dst, src, count - i);
+}
+
+// `s` and `d` contain two BGRA pixels as 16-bit lanes
+static inline __m128i blend_over_sse2(__m128i s, __m128i d)
+{
+	// Broadcast 255 - source alpha to every channel
+	__m128i ia = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+	ia = _mm_shufflehi_epi16(ia, _MM_SHUFFLE(3, 3, 3, 3));
+	ia = _mm_xor_si128(ia, _mm_set1_epi16(255));
+
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(d, ia), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+void nx_blend_over(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i opaque = _mm_set1_epi32(0xFF000000);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i *)src);
+		__m128i a = _mm_and_si128(s, opaque);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, opaque)) == 0xFFFF)
+		{
+			// Fully opaque, so the source pixels replace the destination
+			_mm_storeu_si128((__m128i *)dst, s);
+		}
+		else if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, zero)) != 0xFFFF)
+		{
+			__m128i d = _mm_loadu_si128((const __m128i *)dst);
+			__m128i lo = blend_over_sse2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+			__m128i hi = blend_over_sse2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+			__m128i out = _mm_add_epi8(s, _mm_packus_epi16(lo, hi));
+
+			// Destination pixels under fully transparent source pixels are left as-is
+			__m128i keep = _mm_cmpeq_epi32(a, zero);
+			out = _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, out));
+			_mm_storeu_si128((__m128i *)dst, out);
+		}
+		src += 16;
+		dst += 16;
+	}
+	nx_blend_over_scalar(dst, src, count - i);
+}
+
+#else
+
+void nx_rgba_to_bgra_premultiplied(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	nx_rgba_to_bgra_premultiplied_scalar(dst, src, count);
+}
+
+void nx_premultiply(uint8_t *pixels, size_t count)
+{
+	nx_premultiply_scalar(pixels, count);
+}
+
+void nx_bgra_premultiplied_to_rgba(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	nx_bgra_premultiplied_to_rgba_scalar(dst, src, count);
+}
+
+void nx_blend_over(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	nx_blend_over_scalar(dst, src, count);
+}
+
+#endif
+
+/**
+ * Within a GOB, the bits of the byte offset are made up from the
+ * x (byte) and y (row) coordinates like so:
+ *
+ *    x5 y2 y1 x4 y0 x3 x2 x1 x0
+ *
+ * so each run of 16 bytes within a row is contiguous in memory.
+ */
+static inline uint32_t gob_x_offset(uint32_t bx)
+{
+	return ((bx & 32) << 3) | ((bx & 16) << 1) | (bx & 15);
+}
+
+static inline uint32_t gob_y_offset(uint32_t y)
+{
+	return ((y & 6) << 5) | ((y & 1) << 4);
+}
+
+void nx_blend_over_scalar(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	for (size_t i = 0; i < count; i++, dst += 4, src += 4)
+	{
+		uint8_t a = src[3];
+		if (a == 255)
+		{
+			memcpy(dst, src, 4);
+		}
+		else if (a)
+		{
+			for (int c = 0; c < 4; c++)
+				dst[c] = src[c] + premultiply(dst[c], 255 - a);
+		}
+	}
+}
+
+void nx_blend_mask_solid(uint8_t *dst, const uint8_t *mask, size_t count, const uint8_t color[4])
+{
+	size_t i = 0;
+	while (i < count)
+	{
+		// Glyph masks are mostly empty, so skip over runs of transparent coverage
+		if (i + 4 <= count)
+		{
+			uint32_t m4;
+			memcpy(&m4, mask + i, 4);
+			if (m4 == 0)
+			{
+				i += 4;
+				continue;
+			}
+		}
+
+		uint8_t m = mask[i];
+		uint8_t *d = dst + i * 4;
+		if (m == 255 && color[3] == 255)
+		{
+			memcpy(d, color, 4);
+		}
+		else if (m)
+		{
+			uint8_t a = premultiply(color[3], m);
+			for (int c = 0; c < 4; c++)
+				d[c] = premultiply(color[c], m) + premultiply(d[c], 255 - a);
+		}
+		i++;
+	}
+}
+
+void nx_copy_to_block_linear(uint8_t *dst, uint32_t dst_stride, uint32_t block_height_log2,
+							 const uint8_t *src, uint32_t src_stride,
+							 uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
+{
+	uint32_t block_size = 512 << block_height_log2;
+	uint32_t block_row_size = block_size * (dst_stride / 64);
+	uint32_t gob_mask = (1 << block_height_log2) - 1;
+	uint32_t bx1 = x1 * 4;
+	uint32_t bx2 = x2 * 4;
+	for (uint32_t y = y1; y < y2; y++)
+	{
+		const uint8_t *row = src + (y - y1) * src_stride;
+		uint8_t *block_row = dst +
+							 (y >> (3 + block_height_log2)) * block_row_size +
+							 ((y >> 3) & gob_mask) * 512 +
+							 gob_y_offset(y);
+		uint32_t bx = bx1;
+
+		// Unaligned start of the row
+		if (bx & 15)
+		{
+			uint32_t n = 16 - (bx & 15);
+			if (n > bx2 - bx)
+				n = bx2 - bx;
+			memcpy(block_row + (bx >> 6) * block_size + gob_x_offset(bx), row + (bx - bx1), n);
+			bx += n;
+		}
+
+		// Aligned runs of 16 bytes (4 pixels)
+		for (; bx + 16 <= bx2; bx += 16)
+		{
+			memcpy(block_row + (bx >> 6) * block_size + gob_x_offset(bx), row + (bx - bx1), 16);
+		}
+
+		// Unaligned end of the row
+		if (bx < bx2)
+		{
+			memcpy(block_row + (bx >> 6) * block_size + gob_x_offset(bx), row + (bx - bx1), bx2 - bx);
+		}
+	}
+}
+
+int nx_downscaler_init(nx_downscaler_t *s, uint8_t *dst, uint32_t dst_width, uint32_t dst_height,
+					   uint32_t src_width, uint32_t src_height)
+{
+	memset(s, 0, sizeof(nx_downscaler_t));
+	if (dst_width == 0 || dst_height == 0 || dst_width > src_width || dst_height > src_height)
+		return -1;
+	s->columns = calloc(dst_width, sizeof(uint32_t));
+	s->sums = calloc(dst_width * 4, sizeof(uint64_t));
+	if (!s->columns || !s->sums)
+	{
+		nx_downscaler_free(s);
+		return -1;
+	}
+	s->dst = dst;
+	s->dst_width = dst_width;
+	s->dst_height = dst_height;
+	s->src_width = src_width;
+	s->src_height = src_height;
+	for (uint32_t x = 0; x < src_width; x++)
+		s->columns[(uint64_t)x * dst_width / src_width]++;
+	return 0;
+}
+
+void nx_downscaler_push_row(nx_downscaler_t *s, const uint8_t *row)
+{
+	if (s->src_y >= s->src_height)
+		return;
+
+	uint64_t *sum = s->sums;
+	for (uint32_t x = 0; x < s->dst_width; x++, sum += 4)
+	{
+		for (uint32_t n = s->columns[x]; n > 0; n--, row += 4)
+		{
+			sum[0] += row[0];
+			sum[1] += row[1];
+			sum[2] += row[2];
+			sum[3] += row[3];
+		}
+	}
+	s->rows++;
+
+	// Write out the destination row once the next source row belongs to another one
+	uint32_t dst_y = (uint64_t)s->src_y * s->dst_height / s->src_height;
+	s->src_y++;
+	if (s->src_y < s->src_height &&
+		(uint64_t)s->src_y * s->dst_height / s->src_height == dst_y)
+		return;
+
+	uint8_t *dst = s->dst + (size_t)dst_y * s->dst_width * 4;
+	sum = s->sums;
+	for (uint32_t x = 0; x < s->dst_width; x++, sum += 4, dst += 4)
+	{
+		uint64_t count = (uint64_t)s->columns[x] * s->rows;
+		for (int c = 0; c < 4; c++)
+			dst[c] = (sum[c] + count / 2) / count;
+	}
+	memset(s->sums, 0, s->dst_width * 4 * sizeof(uint64_t));
+	s->rows = 0;
+}
+
+void nx_downscaler_free(nx_downscaler_t *s)
+{
+	free(s->columns);
+	free(s->sums);
+	s->columns = NULL;
+	s->sums = NULL;
+}
+
+int nx_downscale(uint8_t *dst, uint32_t dst_width, uint32_t dst_height,
+				 const uint8_t *src, uint32_t src_width, uint32_t src_height, size_t src_stride)
+{
+	nx_downscaler_t s;
+	if (nx_downscaler_init(&s, dst, dst_width, dst_height, src_width, src_height))
+		return -1;
+	for (uint32_t y = 0; y < src_height; y++)
+		nx_downscaler_push_row(&s, src + y * src_stride);
+	nx_downscaler_free(&s);
+	return 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Pixel format conversions between the `ImageData` layout (RGBA bytes,
+ * straight alpha) and the layout of cairo's `CAIRO_FORMAT_ARGB32` surfaces
+ * (native-endian ARGB, so BGRA bytes on the Switch, premultiplied alpha).
+ *
+ * The SIMD implementations (NEON on the Switch, SSE2 on x86 hosts) produce
+ * exactly the same output as the scalar reference implementations.
+ */
+
+// Converts `count` RGBA pixels into premultiplied BGRA pixels
+void nx_rgba_to_bgra_premultiplied(uint8_t *dst, const uint8_t *src, size_t count);
+
+// Converts `count` premultiplied BGRA pixels into RGBA pixels
+void nx_bgra_premultiplied_to_rgba(uint8_t *dst, const uint8_t *src, size_t count);
+
+// Premultiplies `count` straight alpha pixels in place (for any channel order
+// with alpha last). Blocks of pixels which are all opaque are not written.
+void nx_premultiply(uint8_t *pixels, size_t count);
+
+// Composites `count` premultiplied pixels of `src` over `dst` (source-over)
+void nx_blend_over(uint8_t *dst, const uint8_t *src, size_t count);
+
+// Composites the solid premultiplied pixel `color`, with the coverage of each of
+// the `count` pixels given by the 8-bit `mask`, over `dst` (source-over)
+void nx_blend_mask_solid(uint8_t *dst, const uint8_t *mask, size_t count, const uint8_t color[4]);
+
+// Portable reference implementations. These are also
+// used for the pixels at the end of each row.
+void nx_rgba_to_bgra_premultiplied_scalar(uint8_t *dst, const uint8_t *src, size_t count);
+void nx_bgra_premultiplied_to_rgba_scalar(uint8_t *dst, const uint8_t *src, size_t count);
+void nx_premultiply_scalar(uint8_t *pixels, size_t count);
+void nx_blend_over_scalar(uint8_t *dst, const uint8_t *src, size_t count);
+
+// Height (log2, in GOBs) of the blocks in the Switch's display framebuffers
+#define NX_BLOCK_HEIGHT_LOG2 4
+
+/**
+ * Copies the rectangle `x1` <= x < `x2`, `y1` <= y < `y2` of 32-bit pixels
+ * from a linear buffer into a buffer in the GPU's "block linear" layout,
+ * which is the layout of the Switch's display framebuffers. `src` points
+ * to the pixel at (`x1`, `y1`) of the linear buffer.
+ *
+ * The block linear buffer is made of 512 byte GOBs (64 bytes x 8 rows),
+ * arranged into blocks that are one GOB wide and `1 << block_height_log2`
+ * GOBs tall. `dst_stride` is the width in bytes of the block linear buffer,
+ * and must be a multiple of 64.
+ */
+void nx_copy_to_block_linear(uint8_t *dst, uint32_t dst_stride, uint32_t block_height_log2,
+							 const uint8_t *src, uint32_t src_stride,
+							 uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2);
+
+/**
+ * Area averaging (box filter) downscaler for 32-bit premultiplied pixels.
+ * Every source pixel contributes to exactly one destination pixel.
+ *
+ * Source rows are pushed one at a time, from top to bottom, so that an
+ * image can be reduced while it is being decoded without ever being held
+ * in memory at full size. Each destination row is written to `dst` (with a
+ * stride of `dst_width * 4`) as soon as all of its source rows have been
+ * pushed.
+ */
+typedef struct
+{
+	uint8_t *dst;
+	uint32_t dst_width;
+	uint32_t dst_height;
+	uint32_t src_width;
+	uint32_t src_height;
+	// Next source row to be pushed
+	uint32_t src_y;
+	// Number of source rows summed so far for the current destination row
+	uint32_t rows;
+	// Number of source columns for each destination column
+	uint32_t *columns;
+	// Sum of each channel of each pixel of the current destination row
+	uint64_t *sums;
+} nx_downscaler_t;
+
+// Returns -1 if the destination is larger than the source, or on allocation failure
+int nx_downscaler_init(nx_downscaler_t *s, uint8_t *dst, uint32_t dst_width, uint32_t dst_height,
+					   uint32_t src_width, uint32_t src_height);
+void nx_downscaler_push_row(nx_downscaler_t *s, const uint8_t *row);
+void nx_downscaler_free(nx_downscaler_t *s);
+
+// Downscales a whole image with `nx_downscaler_t`
+int nx_downscale(uint8_t *dst, uint32_t dst_width, uint32_t dst_height,
+				 const uint8_t *src, uint32_t src_width, uint32_t src_height, size_t src_stride);
@@ -7,6 +7,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
 #include <arpa/inet.h>
 #include "poll.h"
 
@@ -27,118 +28,186 @@ int set_nonblocking(int fd)
 	return 0;
 }
 
-int nx_add_watcher(nx_poll_t *p, nx_watcher_t *req)
+static int nx_poll_reserve_fd(nx_poll_t *p, int fd)
 {
-	// Insert watcher into linked list
-	SLIST_INSERT_HEAD(&p->watchers_head, req, next);
+	if (fd < p->fds_size)
+		return 0;
 
-	if (p->poll_fds == NULL)
+	int size = p->fds_size ? p->fds_size : 64;
+	while (size <= fd)
 	{
-		p->poll_fds_size = 20;
-		size_t s = p->poll_fds_size * sizeof(struct pollfd);
-		p->poll_fds = malloc(s);
-		if (p->poll_fds == NULL)
-		{
-			// out of memory
-			return -1;
-		}
-		memset(p->poll_fds, 0, s);
+		size *= 2;
 	}
-	else if (p->poll_fds_used == p->poll_fds_size)
+	nx_poll_fd_t *new_fds = realloc(p->fds, size * sizeof(nx_poll_fd_t));
+	if (new_fds == NULL)
 	{
-		// Double the size of the array
-		p->poll_fds_size *= 2;
-		size_t s = p->poll_fds_size * sizeof(struct pollfd);
-		struct pollfd *new_poll_fds = realloc(p->poll_fds, s);
-		if (new_poll_fds == NULL)
-		{
-			// out of memory
-			return -1;
-		}
-		// Assign the new array to poll_fds
-		p->poll_fds = new_poll_fds;
+		// out of memory
+		return -1;
 	}
+	for (int i = 0; i < p->fds_size; i++)
+	{
+		// The list heads have moved, so update the back
+		// pointer of the first watcher in each list
+		nx_watcher_t *first = LIST_FIRST(&new_fds[i].watchers);
+		if (first)
+			first->next.le_prev = &LIST_FIRST(&new_fds[i].watchers);
+	}
+	for (int i = p->fds_size; i < size; i++)
+	{
+		new_fds[i].poll_index = -1;
+		LIST_INIT(&new_fds[i].watchers);
+	}
+	p->fds = new_fds;
+	p->fds_size = size;
+	return 0;
+}
+
+static int nx_poll_reserve_poll_fd(nx_poll_t *p)
+{
+	if (p->poll_fds_used < p->poll_fds_size)
+		return 0;
 
-	int index = 0;
-	for (; index < p->poll_fds_used; index++)
+	// Double the size of the arrays
+	nfds_t size = p->poll_fds_size ? p->poll_fds_size * 2 : 20;
+	struct pollfd *new_poll_fds = realloc(p->poll_fds, size * sizeof(struct pollfd));
+	if (new_poll_fds == NULL)
 	{
-		if (p->poll_fds[index].fd == req->fd)
-			break;
+		// out of memory
+		return -1;
+	}
+	p->poll_fds = new_poll_fds;
+
+	struct pollfd *new_ready_fds = realloc(p->ready_fds, size * sizeof(struct pollfd));
+	if (new_ready_fds == NULL)
+	{
+		// out of memory
+		return -1;
 	}
+	p->ready_fds = new_ready_fds;
 
-	p->poll_fds[index].fd = req->fd;
-	p->poll_fds[index].events |= req->events;
-	p->poll_fds[index].revents = 0;
+	p->poll_fds_size = size;
+	return 0;
+}
 
-	if (index == p->poll_fds_used)
+int nx_add_watcher(nx_poll_t *p, nx_watcher_t *req)
+{
+	if (req->fd < 0 || nx_poll_reserve_fd(p, req->fd) || nx_poll_reserve_poll_fd(p))
 	{
-		p->poll_fds_used = index + 1;
+		return -1;
 	}
 
+	nx_poll_fd_t *entry = &p->fds[req->fd];
+	if (entry->poll_index < 0)
+	{
+		// First watcher for this fd, so append it to `poll_fds`
+		entry->poll_index = p->poll_fds_used++;
+		p->poll_fds[entry->poll_index].fd = req->fd;
+		p->poll_fds[entry->poll_index].events = 0;
+		p->poll_fds[entry->poll_index].revents = 0;
+	}
+	p->poll_fds[entry->poll_index].events |= req->events;
+
+	LIST_INSERT_HEAD(&entry->watchers, req, next);
+
 	return 0;
 }
 
 int nx_remove_watcher(nx_poll_t *p, nx_watcher_t *req)
 {
-	// Modify the `poll_fds` array to remove the `req->fd` value,
-	// but only if no other watchers are watching with the same fd
-	int fd_count = 0;
-	nx_watcher_t *watcher;
-	SLIST_FOREACH(watcher, &p->watchers_head, next)
+	// Not currently being watched
+	if (req->next.le_prev == NULL)
+		return 0;
+
+	LIST_REMOVE(req, next);
+	req->next.le_prev = NULL;
+
+	nx_poll_fd_t *entry = &p->fds[req->fd];
+	int index = entry->poll_index;
+	if (LIST_EMPTY(&entry->watchers))
 	{
-		if (watcher->fd == req->fd)
+		// No other watchers are watching the same fd, so swap
+		// the last entry of `poll_fds` into the vacated slot
+		nfds_t last = --p->poll_fds_used;
+		if (index != last)
 		{
-			fd_count++;
-			if (fd_count > 1)
-				break;
+			p->poll_fds[index] = p->poll_fds[last];
+			p->fds[p->poll_fds[index].fd].poll_index = index;
 		}
+		entry->poll_index = -1;
 	}
-
-	if (fd_count == 1)
+	else
 	{
-		for (int i = 0; i < p->poll_fds_used; i++)
+		// Recompute the events of interest from the remaining watchers
+		nx_watcher_t *watcher;
+		short events = 0;
+		LIST_FOREACH(watcher, &entry->watchers, next)
 		{
-			if (p->poll_fds[i].fd == req->fd)
-			{
-				// Shift all elements down one
-				for (int j = i; j < p->poll_fds_used - 1; j++)
-				{
-					p->poll_fds[j] = p->poll_fds[j + 1];
-				}
-				p->poll_fds_used--;
-				break;
-			}
+			events |= watcher->events;
 		}
+		p->poll_fds[index].events = events;
 	}
 
-	// Remove the watcher from the linked list of watchers
-	SLIST_REMOVE(&p->watchers_head, req, nx_watcher_s, next);
-
 	return 0;
 }
 
-void nx_poll(nx_poll_t *p)
+void nx_remove_watchers(nx_poll_t *p, int fd)
 {
-	if (p->poll_fds_used == 0 || SLIST_EMPTY(&p->watchers_head))
+	if (fd < 0 || fd >= p->fds_size)
 		return;
 
 	nx_watcher_t *watcher;
+	nx_watcher_t *twatcher;
+	LIST_FOREACH_SAFE(watcher, &p->fds[fd].watchers, next, twatcher)
+	{
+		nx_remove_watcher(p, watcher);
+	}
+}
+
+/**
+ * Waits for up to `timeout` milliseconds for any of the watched file
+ * descriptors to report activity, or for another thread to interrupt
+ * the wait via `nx_poll_wakeup()`. A `timeout` of 0 returns immediately.
+ */
+void nx_poll(nx_poll_t *p, int timeout)
+{
+	if (p->poll_fds_used == 0)
+	{
+		if (timeout > 0)
+			usleep(timeout * 1000);
+		return;
+	}
 
-	int ready_fds = poll(p->poll_fds, p->poll_fds_used, 0);
+	nx_watcher_t *watcher;
+	nx_watcher_t *twatcher;
+
+	int ready_fds = poll(p->poll_fds, p->poll_fds_used, timeout);
 	if (ready_fds < 0)
 	{
 		printf("poll() error: %s\n", strerror(errno));
 	}
 	else if (ready_fds > 0)
 	{
+		/* Snapshot the ready file descriptors first, since the callbacks
+		 * may add or remove watchers, which reorders `poll_fds` */
+		int num_ready = 0;
+		for (int i = 0; i < p->poll_fds_used && num_ready < ready_fds; i++)
+		{
+			if (p->poll_fds[i].revents)
+			{
+				p->ready_fds[num_ready++] = p->poll_fds[i];
+			}
+		}
+
 		/* One or more file descriptors are ready, handle them */
-		for (int i = 0; i < p->poll_fds_used; i++)
+		for (int i = 0; i < num_ready; i++)
 		{
-			SLIST_FOREACH(watcher, &p->watchers_head, next)
+			int fd = p->ready_fds[i].fd;
+			int revents = p->ready_fds[i].revents;
+			LIST_FOREACH_SAFE(watcher, &p->fds[fd].watchers, next, twatcher)
 			{
-				if (p->poll_fds[i].fd == watcher->fd && p->poll_fds[i].revents & watcher->events)
+				if (revents & watcher->events)
 				{
-					watcher->watcher_callback(p, watcher, p->poll_fds[i].revents);
+					watcher->watcher_callback(p, watcher, revents);
 				}
 			}
 		}
@@ -331,12 +400,75 @@ int nx_write(nx_poll_t *p, nx_write_t *req, int fd, const uint8_t *data, size_t
 	return 0;
 }
 
+void nx_poll_wakeup_cb(nx_poll_t *p, nx_watcher_t *watcher, int revents)
+{
+	// Clear the flag before draining, so that a wakeup
+	// which races with the drain is not lost
+	atomic_store(&p->wakeup_pending, false);
+	char buf[64];
+	while (recv(watcher->fd, buf, sizeof(buf), 0) > 0)
+	{
+	}
+}
+
+/**
+ * Interrupts a blocking `nx_poll()` call. Safe to call from any thread.
+ */
+void nx_poll_wakeup(nx_poll_t *p)
+{
+	if (p->wakeup_fd < 0 || atomic_exchange(&p->wakeup_pending, true))
+		return;
+	send(p->wakeup_fd, "", 1, 0);
+}
+
+int nx_poll_wakeup_init(nx_poll_t *p)
+{
+	// There are no pipes on the Switch, so use
+	// a UDP socket which is connected to itself
+	int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sockfd < 0)
+	{
+		printf("socket() err: %s\n", strerror(errno));
+		return -1;
+	}
+
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = 0,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t addr_len = sizeof(addr);
+
+	if (set_nonblocking(sockfd) == -1 ||
+		bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+		getsockname(sockfd, (struct sockaddr *)&addr, &addr_len) < 0 ||
+		connect(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		printf("wakeup socket err: %s\n", strerror(errno));
+		close(sockfd);
+		return -1;
+	}
+
+	p->wakeup_fd = sockfd;
+	p->wakeup_watcher.fd = sockfd;
+	p->wakeup_watcher.events = POLLIN;
+	p->wakeup_watcher.watcher_callback = nx_poll_wakeup_cb;
+	nx_add_watcher(p, &p->wakeup_watcher);
+
+	return 0;
+}
+
 void nx_poll_init(nx_poll_t *p)
 {
 	p->poll_fds = NULL;
 	p->poll_fds_size = 0;
 	p->poll_fds_used = 0;
-	SLIST_INIT(&p->watchers_head);
+	p->ready_fds = NULL;
+	p->fds = NULL;
+	p->fds_size = 0;
+	p->wakeup_fd = -1;
+	atomic_init(&p->wakeup_pending, false);
+	nx_poll_wakeup_init(p);
 }
 
 void nx_tcp_server_cb(nx_poll_t *p, nx_watcher_t *watcher, int revents)
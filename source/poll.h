@@ -1,4 +1,6 @@
 #pragma once
+#include <stdbool.h>
+#include <stdatomic.h>
 #include "queue.h"
 
 typedef struct nx_poll_s nx_poll_t;
@@ -20,7 +22,7 @@ typedef void (*nx_server_cb)(nx_poll_t *p, nx_server_t *req, int client_fd);
 	int err;                        \
 	nx_watcher_cb watcher_callback; \
 	void *opaque;                   \
-	SLIST_ENTRY(nx_watcher_s)       \
+	LIST_ENTRY(nx_watcher_s)        \
 	next;
 
 struct nx_watcher_s
@@ -58,13 +60,35 @@ struct nx_server_s
 	nx_server_cb callback;
 };
 
+// Per file descriptor state, indexed by the fd number
+typedef struct
+{
+	// Index of the fd within `poll_fds`, or -1 when it is not being polled
+	int poll_index;
+	LIST_HEAD(nx_watcher_list, nx_watcher_s)
+	watchers;
+} nx_poll_fd_t;
+
 struct nx_poll_s
 {
+	// Densely packed array passed to `poll()`. Entries are swap-removed
+	// so that adding and removing a file descriptor is O(1).
 	struct pollfd *poll_fds;
 	nfds_t poll_fds_used;
 	nfds_t poll_fds_size;
-	SLIST_HEAD(slisthead, nx_watcher_s)
-	watchers_head;
+
+	// Snapshot of the descriptors reported as ready by `poll()`
+	struct pollfd *ready_fds;
+
+	// Watchers for each file descriptor, indexed by fd
+	nx_poll_fd_t *fds;
+	int fds_size;
+
+	// Loopback socket pair used by other threads to interrupt
+	// a blocking `nx_poll()` call (see `nx_poll_wakeup()`)
+	int wakeup_fd;
+	nx_watcher_t wakeup_watcher;
+	atomic_bool wakeup_pending;
 };
 
 // High-level API
@@ -76,5 +100,7 @@ int nx_write(nx_poll_t *p, nx_write_t *req, int fd, const uint8_t *data, size_t
 // Low-level API
 int nx_add_watcher(nx_poll_t *p, nx_watcher_t *req);
 int nx_remove_watcher(nx_poll_t *p, nx_watcher_t *req);
+void nx_remove_watchers(nx_poll_t *p, int fd);
 void nx_poll_init(nx_poll_t *p);
-void nx_poll(nx_poll_t *p);
+void nx_poll(nx_poll_t *p, int timeout);
+void nx_poll_wakeup(nx_poll_t *p);
@@ -186,15 +186,8 @@ JSValue nx_js_tcp_close(JSContext *ctx, JSValueConst this_val, int argc, JSValue
 	}
 
 	nx_context_t* nx_ctx = JS_GetContextOpaque(ctx);
-	nx_watcher_t *watcher;
-	nx_watcher_t *twatcher;
-	SLIST_FOREACH_SAFE(watcher, &nx_ctx->poll.watchers_head, next, twatcher)
-	{
-		if (watcher->fd == fd) {
-			// TODO: reject promise for this watcher?
-			nx_remove_watcher(&nx_ctx->poll, watcher);
-		}
-	}
+	// TODO: reject promise for the removed watchers?
+	nx_remove_watchers(&nx_ctx->poll, fd);
 
 	if (close(fd))
 	{
@@ -0,0 +1,331 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "thread-pool.h"
+
+#define DEQUE_INITIAL_CAPACITY 256
+
+/* ========================== CHASE-LEV DEQUE ======================== */
+
+/*
+ * Based on "Correct and Efficient Work-Stealing for Weak Memory Models"
+ * (Lê, Pop, Cohen, Zappa Nardelli - PPoPP 2013). Only the owner pushes
+ * to the bottom, and any thread may steal from the top. The owner never
+ * pops from the bottom, so each deque is consumed in FIFO order.
+ */
+
+typedef struct deque_array_s
+{
+	struct deque_array_s *retired; // previous (smaller) array
+	size_t capacity;
+	_Atomic(nx_thread_pool_job_t *) buffer[];
+} deque_array_t;
+
+typedef struct
+{
+	atomic_size_t top;
+	atomic_size_t bottom;
+	_Atomic(deque_array_t *) array;
+} deque_t;
+
+static deque_array_t *deque_array_new(size_t capacity)
+{
+	deque_array_t *a = malloc(sizeof(deque_array_t) + capacity * sizeof(nx_thread_pool_job_t *));
+	if (a == NULL)
+		return NULL;
+	a->retired = NULL;
+	a->capacity = capacity;
+	return a;
+}
+
+static int deque_init(deque_t *q)
+{
+	deque_array_t *a = deque_array_new(DEQUE_INITIAL_CAPACITY);
+	if (a == NULL)
+		return -1;
+	atomic_init(&q->top, 0);
+	atomic_init(&q->bottom, 0);
+	atomic_init(&q->array, a);
+	return 0;
+}
+
+static void deque_destroy(deque_t *q)
+{
+	// Thieves may still have been reading from smaller arrays when the
+	// deque was grown, so those are only freed once the pool is destroyed
+	deque_array_t *a = atomic_load(&q->array);
+	while (a)
+	{
+		deque_array_t *retired = a->retired;
+		free(a);
+		a = retired;
+	}
+}
+
+// Owner only
+static int deque_push(deque_t *q, nx_thread_pool_job_t *job)
+{
+	size_t b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+	size_t t = atomic_load_explicit(&q->top, memory_order_acquire);
+	deque_array_t *a = atomic_load_explicit(&q->array, memory_order_relaxed);
+	if (b - t > a->capacity - 1)
+	{
+		// Full, so double the size of the array
+		deque_array_t *grown = deque_array_new(a->capacity * 2);
+		if (grown == NULL)
+			return -1;
+		for (size_t i = t; i < b; i++)
+		{
+			atomic_store_explicit(&grown->buffer[i % grown->capacity],
+								  atomic_load_explicit(&a->buffer[i % a->capacity], memory_order_relaxed),
+								  memory_order_relaxed);
+		}
+		grown->retired = a;
+		atomic_store_explicit(&q->array, grown, memory_order_release);
+		a = grown;
+	}
+	atomic_store_explicit(&a->buffer[b % a->capacity], job, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+	return 0;
+}
+
+// Any thread. Sets `*contended` when the deque was not empty,
+// but another thief won the race for the top item.
+static nx_thread_pool_job_t *deque_steal(deque_t *q, bool *contended)
+{
+	size_t t = atomic_load_explicit(&q->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	size_t b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+	if (t >= b)
+		return NULL;
+
+	deque_array_t *a = atomic_load_explicit(&q->array, memory_order_acquire);
+	nx_thread_pool_job_t *job = atomic_load_explicit(&a->buffer[t % a->capacity], memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+												 memory_order_seq_cst, memory_order_relaxed))
+	{
+		*contended = true;
+		return NULL;
+	}
+	return job;
+}
+
+/* ========================== THREAD POOL ============================ */
+
+typedef struct
+{
+	int id;
+	bool started;
+	pthread_t pthread;
+	nx_thread_pool_t *pool;
+	deque_t lanes[NX_THREAD_POOL_PRIORITY_COUNT];
+} worker_t;
+
+struct nx_thread_pool_s
+{
+	worker_t *workers;
+	int num_threads;
+	int next_worker; // round-robin index, only used by the owner thread
+	atomic_bool keepalive;
+
+	// Number of jobs sitting in deques, used to decide when to sleep
+	atomic_int queued;
+	// Number of jobs submitted and not yet completed, for `nx_thread_pool_wait()`
+	atomic_int outstanding;
+	atomic_int sleeping;
+
+	pthread_mutex_t lock;
+	pthread_cond_t has_jobs;
+	pthread_cond_t all_done;
+};
+
+static nx_thread_pool_job_t *worker_take(worker_t *w, bool *contended)
+{
+	nx_thread_pool_t *pool = w->pool;
+	for (int lane = NX_THREAD_POOL_PRIORITY_COUNT - 1; lane >= 0; lane--)
+	{
+		// Own deque first, then steal from the other workers
+		for (int i = 0; i < pool->num_threads; i++)
+		{
+			worker_t *victim = &pool->workers[(w->id + i) % pool->num_threads];
+			nx_thread_pool_job_t *job = deque_steal(&victim->lanes[lane], contended);
+			if (job)
+				return job;
+		}
+	}
+	return NULL;
+}
+
+static void *worker_do(void *arg)
+{
+	worker_t *w = arg;
+	nx_thread_pool_t *pool = w->pool;
+
+	while (atomic_load(&pool->keepalive))
+	{
+		bool contended = false;
+		nx_thread_pool_job_t *job = worker_take(w, &contended);
+		if (job)
+		{
+			atomic_fetch_sub(&pool->queued, 1);
+			job->fn(job->arg);
+			if (atomic_fetch_sub(&pool->outstanding, 1) == 1)
+			{
+				pthread_mutex_lock(&pool->lock);
+				pthread_cond_broadcast(&pool->all_done);
+				pthread_mutex_unlock(&pool->lock);
+			}
+			continue;
+		}
+		if (contended)
+			continue;
+
+		// Nothing to do, so sleep until more work is added
+		pthread_mutex_lock(&pool->lock);
+		atomic_fetch_add(&pool->sleeping, 1);
+		while (atomic_load(&pool->queued) == 0 && atomic_load(&pool->keepalive))
+		{
+			pthread_cond_wait(&pool->has_jobs, &pool->lock);
+		}
+		atomic_fetch_sub(&pool->sleeping, 1);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return NULL;
+}
+
+nx_thread_pool_t *nx_thread_pool_init(int num_threads)
+{
+	if (num_threads < 1)
+		num_threads = 1;
+
+	nx_thread_pool_t *pool = calloc(1, sizeof(nx_thread_pool_t));
+	if (pool == NULL)
+		return NULL;
+
+	pool->workers = calloc(num_threads, sizeof(worker_t));
+	if (pool->workers == NULL)
+	{
+		free(pool);
+		return NULL;
+	}
+
+	atomic_init(&pool->keepalive, true);
+	atomic_init(&pool->queued, 0);
+	atomic_init(&pool->outstanding, 0);
+	atomic_init(&pool->sleeping, 0);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->has_jobs, NULL);
+	pthread_cond_init(&pool->all_done, NULL);
+
+	// All deques must exist before any worker starts stealing
+	pool->num_threads = num_threads;
+	for (int i = 0; i < num_threads; i++)
+	{
+		worker_t *w = &pool->workers[i];
+		w->id = i;
+		w->pool = pool;
+		for (int lane = 0; lane < NX_THREAD_POOL_PRIORITY_COUNT; lane++)
+		{
+			if (deque_init(&w->lanes[lane]))
+			{
+				nx_thread_pool_destroy(pool);
+				return NULL;
+			}
+		}
+	}
+
+	// If a thread fails to start, its deques are still
+	// drained by the other workers stealing from them
+	int started = 0;
+	for (int i = 0; i < num_threads; i++)
+	{
+		worker_t *w = &pool->workers[i];
+		if (pthread_create(&w->pthread, NULL, worker_do, w) == 0)
+		{
+			w->started = true;
+			started++;
+		}
+	}
+
+	if (started == 0)
+	{
+		nx_thread_pool_destroy(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+int nx_thread_pool_add_work(nx_thread_pool_t *pool, nx_thread_pool_job_t *job, enum nx_thread_pool_priority priority)
+{
+	worker_t *w = &pool->workers[pool->next_worker];
+	pool->next_worker = (pool->next_worker + 1) % pool->num_threads;
+
+	atomic_fetch_add(&pool->outstanding, 1);
+	if (deque_push(&w->lanes[priority], job))
+	{
+		atomic_fetch_sub(&pool->outstanding, 1);
+		return -1;
+	}
+	atomic_fetch_add(&pool->queued, 1);
+
+	// Only take the lock when there is a worker that needs to be woken up
+	if (atomic_load(&pool->sleeping) > 0)
+	{
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_signal(&pool->has_jobs);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return 0;
+}
+
+void nx_thread_pool_wait(nx_thread_pool_t *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	while (atomic_load(&pool->outstanding) > 0)
+	{
+		pthread_cond_wait(&pool->all_done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void nx_thread_pool_destroy(nx_thread_pool_t *pool)
+{
+	if (pool == NULL)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	atomic_store(&pool->keepalive, false);
+	pthread_cond_broadcast(&pool->has_jobs);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 0; i < pool->num_threads; i++)
+	{
+		if (pool->workers[i].started)
+			pthread_join(pool->workers[i].pthread, NULL);
+	}
+
+	for (int i = 0; i < pool->num_threads; i++)
+	{
+		for (int lane = 0; lane < NX_THREAD_POOL_PRIORITY_COUNT; lane++)
+		{
+			deque_destroy(&pool->workers[i].lanes[lane]);
+		}
+	}
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->has_jobs);
+	pthread_cond_destroy(&pool->all_done);
+	free(pool->workers);
+	free(pool);
+}
+
+int nx_thread_pool_num_threads(nx_thread_pool_t *pool)
+{
+	return pool->num_threads;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+/**
+ * Work-stealing thread pool.
+ *
+ * Each worker thread owns one Chase-Lev deque per priority lane. Work is
+ * distributed round-robin across the workers' deques, and a worker that
+ * runs out of work steals from the other workers' deques. Workers always
+ * drain every high priority deque before looking at normal priority work,
+ * so latency sensitive jobs are not stuck behind bulk jobs.
+ *
+ * Jobs are intrusive: the caller embeds a `nx_thread_pool_job_t` in its
+ * own structure, so submitting a job does not allocate any memory.
+ *
+ * `nx_thread_pool_add_work()` must always be called from the same thread
+ * (the JS thread), since that thread is the owner of every deque.
+ */
+
+enum nx_thread_pool_priority
+{
+	NX_THREAD_POOL_PRIORITY_NORMAL,
+	NX_THREAD_POOL_PRIORITY_HIGH,
+	NX_THREAD_POOL_PRIORITY_COUNT
+};
+
+typedef struct nx_thread_pool_s nx_thread_pool_t;
+typedef struct nx_thread_pool_job_s nx_thread_pool_job_t;
+
+struct nx_thread_pool_job_s
+{
+	void (*fn)(void *arg);
+	void *arg;
+};
+
+nx_thread_pool_t *nx_thread_pool_init(int num_threads);
+int nx_thread_pool_add_work(nx_thread_pool_t *pool, nx_thread_pool_job_t *job, enum nx_thread_pool_priority priority);
+void nx_thread_pool_wait(nx_thread_pool_t *pool);
+void nx_thread_pool_destroy(nx_thread_pool_t *pool);
+int nx_thread_pool_num_threads(nx_thread_pool_t *pool);
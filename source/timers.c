@@ -0,0 +1,244 @@
+#include <stdlib.h>
+#include <math.h>
+#include "timers.h"
+#include "error.h"
+
+/**
+ * Pending timers are stored in a binary min-heap ordered by deadline
+ * (ties are broken by ID, so that timers with the same deadline fire
+ * in the order they were created). Scheduling and clearing a timer
+ * is O(log n), and checking for due timers on each iteration of the
+ * main loop is O(1) when nothing is due.
+ */
+
+static JSClassID nx_timer_class_id;
+
+// Interval timers fire at most once per millisecond, so that
+// `setInterval(fn, 0)` can not starve the rest of the event loop
+#define MIN_INTERVAL_NS 1000000ULL
+
+u64 nx_timers_now()
+{
+	return armTicksToNs(armGetSystemTick());
+}
+
+static bool timer_before(nx_timer_t *a, nx_timer_t *b)
+{
+	if (a->deadline != b->deadline)
+		return a->deadline < b->deadline;
+	return a->id < b->id;
+}
+
+static void heap_set(nx_context_t *nx_ctx, size_t index, nx_timer_t *timer)
+{
+	nx_ctx->timers[index] = timer;
+	timer->heap_index = index;
+}
+
+static void heap_sift_up(nx_context_t *nx_ctx, size_t index)
+{
+	nx_timer_t *timer = nx_ctx->timers[index];
+	while (index > 0)
+	{
+		size_t parent = (index - 1) / 2;
+		if (!timer_before(timer, nx_ctx->timers[parent]))
+			break;
+		heap_set(nx_ctx, index, nx_ctx->timers[parent]);
+		index = parent;
+	}
+	heap_set(nx_ctx, index, timer);
+}
+
+static void heap_sift_down(nx_context_t *nx_ctx, size_t index)
+{
+	nx_timer_t *timer = nx_ctx->timers[index];
+	for (;;)
+	{
+		size_t child = index * 2 + 1;
+		if (child >= nx_ctx->timers_used)
+			break;
+		if (child + 1 < nx_ctx->timers_used &&
+			timer_before(nx_ctx->timers[child + 1], nx_ctx->timers[child]))
+			child++;
+		if (!timer_before(nx_ctx->timers[child], timer))
+			break;
+		heap_set(nx_ctx, index, nx_ctx->timers[child]);
+		index = child;
+	}
+	heap_set(nx_ctx, index, timer);
+}
+
+static int timer_schedule(nx_context_t *nx_ctx, nx_timer_t *timer)
+{
+	if (nx_ctx->timers_used == nx_ctx->timers_size)
+	{
+		// Double the size of the array
+		size_t size = nx_ctx->timers_size ? nx_ctx->timers_size * 2 : 20;
+		nx_timer_t **timers = realloc(nx_ctx->timers, size * sizeof(nx_timer_t *));
+		if (timers == NULL)
+		{
+			// out of memory
+			return -1;
+		}
+		nx_ctx->timers = timers;
+		nx_ctx->timers_size = size;
+	}
+	size_t index = nx_ctx->timers_used++;
+	heap_set(nx_ctx, index, timer);
+	heap_sift_up(nx_ctx, index);
+	return 0;
+}
+
+static void timer_unschedule(nx_context_t *nx_ctx, nx_timer_t *timer)
+{
+	if (timer->heap_index < 0)
+		return;
+
+	// Move the last timer into the vacated slot and restore the heap order
+	size_t index = timer->heap_index;
+	timer->heap_index = -1;
+	nx_timer_t *last = nx_ctx->timers[--nx_ctx->timers_used];
+	if (last == timer)
+		return;
+	heap_set(nx_ctx, index, last);
+	if (index > 0 && timer_before(last, nx_ctx->timers[(index - 1) / 2]))
+	{
+		heap_sift_up(nx_ctx, index);
+	}
+	else
+	{
+		heap_sift_down(nx_ctx, index);
+	}
+}
+
+void nx_process_timers(JSContext *ctx, nx_context_t *nx_ctx)
+{
+	u64 now = nx_timers_now();
+	while (nx_ctx->timers_used > 0)
+	{
+		nx_timer_t *timer = nx_ctx->timers[0];
+		if (timer->deadline > now)
+			break;
+
+		if (timer->interval)
+		{
+			timer->deadline = now + timer->interval;
+			heap_sift_down(nx_ctx, 0);
+		}
+		else
+		{
+			timer_unschedule(nx_ctx, timer);
+		}
+
+		// The timer may be garbage collected during the callback,
+		// so it must not be accessed after this point
+		JSValueConst args[] = {JS_NewUint32(ctx, timer->id)};
+		JSValue ret_val = JS_Call(ctx, nx_ctx->timer_handler, JS_NULL, 1, args);
+		if (JS_IsException(ret_val))
+		{
+			nx_emit_error_event(ctx);
+		}
+		JS_FreeValue(ctx, ret_val);
+
+		// If the callback threw a fatal error
+		// then don't process any more timers
+		if (nx_ctx->had_error)
+			break;
+	}
+}
+
+static JSValue nx_timer_new(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_context_t *nx_ctx = JS_GetContextOpaque(ctx);
+	u32 id;
+	double timeout;
+	int repeat = JS_ToBool(ctx, argv[2]);
+	if (JS_ToUint32(ctx, &id, argv[0]) || JS_ToFloat64(ctx, &timeout, argv[1]) || repeat < 0)
+	{
+		return JS_EXCEPTION;
+	}
+	if (!isfinite(timeout) || timeout < 0)
+	{
+		timeout = 0;
+	}
+
+	JSValue obj = JS_NewObjectClass(ctx, nx_timer_class_id);
+	if (JS_IsException(obj))
+	{
+		return obj;
+	}
+	nx_timer_t *timer = js_mallocz(ctx, sizeof(nx_timer_t));
+	if (!timer)
+	{
+		JS_FreeValue(ctx, obj);
+		return JS_EXCEPTION;
+	}
+	JS_SetOpaque(obj, timer);
+
+	u64 timeout_ns = (u64)(timeout * 1000000.0);
+	timer->id = id;
+	timer->heap_index = -1;
+	timer->nx_ctx = nx_ctx;
+	timer->deadline = nx_timers_now() + timeout_ns;
+	if (repeat)
+	{
+		timer->interval = timeout_ns < MIN_INTERVAL_NS ? MIN_INTERVAL_NS : timeout_ns;
+	}
+
+	if (timer_schedule(nx_ctx, timer))
+	{
+		JS_FreeValue(ctx, obj);
+		JS_ThrowOutOfMemory(ctx);
+		return JS_EXCEPTION;
+	}
+
+	return obj;
+}
+
+static JSValue nx_timer_clear(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_timer_t *timer = JS_GetOpaque2(ctx, argv[0], nx_timer_class_id);
+	if (!timer)
+	{
+		return JS_EXCEPTION;
+	}
+	timer_unschedule(timer->nx_ctx, timer);
+	return JS_UNDEFINED;
+}
+
+static JSValue nx_set_timer_handler(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+	nx_context_t *nx_ctx = JS_GetContextOpaque(ctx);
+	nx_ctx->timer_handler = JS_DupValue(ctx, argv[0]);
+	return JS_UNDEFINED;
+}
+
+static void finalizer_timer(JSRuntime *rt, JSValue val)
+{
+	nx_timer_t *timer = JS_GetOpaque(val, nx_timer_class_id);
+	if (timer)
+	{
+		timer_unschedule(timer->nx_ctx, timer);
+		js_free_rt(rt, timer);
+	}
+}
+
+static const JSCFunctionListEntry function_list[] = {
+	JS_CFUNC_DEF("onTimer", 1, nx_set_timer_handler),
+	JS_CFUNC_DEF("timerNew", 3, nx_timer_new),
+	JS_CFUNC_DEF("timerClear", 1, nx_timer_clear),
+};
+
+void nx_init_timers(JSContext *ctx, JSValueConst init_obj)
+{
+	JSRuntime *rt = JS_GetRuntime(ctx);
+
+	JS_NewClassID(rt, &nx_timer_class_id);
+	JSClassDef timer_class = {
+		"Timer",
+		.finalizer = finalizer_timer,
+	};
+	JS_NewClass(rt, nx_timer_class_id, &timer_class);
+
+	JS_SetPropertyFunctionList(ctx, init_obj, function_list, countof(function_list));
+}
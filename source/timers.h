@@ -0,0 +1,6 @@
+#pragma once
+#include "types.h"
+
+void nx_init_timers(JSContext *ctx, JSValueConst init_obj);
+void nx_process_timers(JSContext *ctx, nx_context_t *nx_ctx);
+u64 nx_timers_now();
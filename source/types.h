@@ -1,5 +1,7 @@
 #pragma once
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <wasm3.h>
 #include <pthread.h>
 #include <quickjs.h>
@@ -9,8 +11,9 @@
 #include <switch.h>
 #include <mbedtls/entropy.h>
 #include <mbedtls/ctr_drbg.h>
-#include "thpool.h"
+#include "thread-pool.h"
 #include "poll.h"
+#include "frame-timing.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -46,6 +49,13 @@ typedef struct
 	JSValue buffer;
 } nx_js_callback_t;
 
+// Size of the inline payload storage in `nx_work_t`. Payloads that are
+// larger than this are allocated separately (see `NX_INIT_WORK_T`).
+#define NX_WORK_DATA_SIZE 192
+
+// Number of `nx_work_t` allocated at a time by the work pool
+#define NX_WORK_SLAB_SIZE 64
+
 typedef struct nx_work_s nx_work_t;
 typedef void (*nx_work_cb)(nx_work_t *req);
 typedef JSValue (*nx_after_work_cb)(JSContext *ctx, nx_work_t *req);
@@ -53,15 +63,47 @@ typedef JSValue (*nx_after_work_cb)(JSContext *ctx, nx_work_t *req);
 struct nx_work_s
 {
 	nx_work_t *next;
-	int done;
 	JSValue resolve;
 	JSValue reject;
 	nx_work_cb work_cb;
 	nx_after_work_cb after_work_cb;
-	pthread_mutex_t *async_done_mutex;
+	struct nx_context_s *nx_ctx;
+	nx_thread_pool_job_t job;
+	enum nx_thread_pool_priority priority;
+
+	// Set by `$.asyncCancel()`. Work that is cancelled before it starts
+	// is skipped, and long running work may check it periodically.
+	atomic_bool cancelled;
+
+	// Held by the work callback and by any other jobs working on the
+	// request (see `nx_work_ref()`). The request completes once the
+	// last reference is dropped.
+	atomic_int refs;
+
+	// Handle object which is stored on the Promise returned to JS, so that
+	// `$.asyncCancel()` can find the request without searching for it.
+	// It stops pointing to the request once the request has completed.
+	JSValue handle;
+
 	void *data;
+	_Alignas(max_align_t) uint8_t data_storage[NX_WORK_DATA_SIZE];
 };
 
+typedef struct nx_work_slab_s
+{
+	struct nx_work_slab_s *next;
+	nx_work_t work[NX_WORK_SLAB_SIZE];
+} nx_work_slab_t;
+
+typedef struct nx_timer_s
+{
+	u32 id;
+	int heap_index; // -1 when not scheduled
+	u64 deadline;	// monotonic time in nanoseconds
+	u64 interval;	// 0 for `setTimeout()`
+	struct nx_context_s *nx_ctx;
+} nx_timer_t;
+
 enum nx_rendering_mode
 {
 	NX_RENDERING_MODE_CONSOLE,
@@ -73,9 +115,34 @@ typedef struct nx_context_s
 	int had_error;
 	enum nx_rendering_mode rendering_mode;
 	nx_poll_t poll;
-	threadpool thpool;
-	pthread_mutex_t async_done_mutex;
-	nx_work_t *work_queue;
+	nx_thread_pool_t *thpool;
+
+	// Lock-free stack of completed thread pool work. Pushed to by
+	// the worker threads and drained by the JS thread.
+	_Atomic(nx_work_t *) completed_work;
+
+	// Completed work which has been taken from `completed_work` but not
+	// resolved yet (because the time budget ran out), in completion order
+	nx_work_t *ready_work;
+	nx_work_t *ready_work_tail;
+
+	// Pool of unused `nx_work_t`, only accessed by the JS thread
+	nx_work_t *free_work;
+	nx_work_slab_t *work_slabs;
+
+	// Min-heap of pending timers, ordered by deadline
+	nx_timer_t **timers;
+	size_t timers_used;
+	size_t timers_size;
+	JSValue timer_handler;
+
+	// Minimum time between invocations of the frame handler (0 is uncapped)
+	u64 frame_interval;
+	// Maximum time spent resolving async work, and running Promise
+	// jobs, in each iteration of the main loop (0 is unlimited)
+	u64 drain_budget;
+	nx_frame_timing_t frame_timing;
+
 	FT_Library ft_library;
 	HidVibrationDeviceHandle vibration_device_handles[2];
 	IM3Environment wasm_env;